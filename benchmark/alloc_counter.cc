@@ -0,0 +1,68 @@
+#include "alloc_counter.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace order_book_v1 {
+namespace {
+thread_local AllocStats thread_stats;
+}  // namespace
+
+bool AllocCountingEnabled() {
+#ifdef ORDERBOOK_COUNT_ALLOCS
+  return true;
+#else
+  return false;
+#endif
+}
+
+AllocStats ThreadAllocStats() { return thread_stats; }
+}  // namespace order_book_v1
+
+#ifdef ORDERBOOK_COUNT_ALLOCS
+namespace {
+void* CountedAlloc(std::size_t size, std::size_t alignment) {
+  ++order_book_v1::thread_stats.allocs;
+  order_book_v1::thread_stats.bytes += size;
+
+  if (size == 0) size = 1;
+  void* ptr = nullptr;
+  if (alignment <= alignof(std::max_align_t)) {
+    ptr = std::malloc(size);
+  } else {
+    // aligned_alloc needs size to be a multiple of the alignment
+    ptr = std::aligned_alloc(alignment,
+                             (size + alignment - 1) / alignment * alignment);
+  }
+  if (ptr == nullptr) throw std::bad_alloc();
+  return ptr;
+}
+}  // namespace
+
+void* operator new(std::size_t size) {
+  return CountedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new[](std::size_t size) {
+  return CountedAlloc(size, alignof(std::max_align_t));
+}
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<std::size_t>(alignment));
+}
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+  return CountedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+#endif
@@ -0,0 +1,22 @@
+#ifndef BENCHMARK_ALLOC_COUNTER_H_
+#define BENCHMARK_ALLOC_COUNTER_H_
+
+#include <cstdint>
+
+namespace order_book_v1 {
+struct AllocStats {
+  uint64_t allocs = 0;
+  uint64_t bytes = 0;
+};
+
+// True when the binary was built with -DORDERBOOK_COUNT_ALLOCS=ON, which
+// replaces the global operator new with a counting one. Counts are kept per
+// thread, so a benchmark's numbers exclude helper threads.
+bool AllocCountingEnabled();
+
+// Allocations made by the calling thread since it started. Always zero when
+// counting is disabled.
+AllocStats ThreadAllocStats();
+}  // namespace order_book_v1
+
+#endif
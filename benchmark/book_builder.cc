@@ -0,0 +1,74 @@
+#include "book_builder.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include "order_message.h"
+#include "perf_region.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+class CaptureSink : public OrderMessageSink {
+ public:
+  void OnOrderMessage(const OrderMessage& message) override {
+    messages.emplace_back(message);
+  }
+
+  std::vector<OrderMessage> messages;
+};
+
+// Records the feed produced by a mixed limit/market/cancel workload.
+std::vector<OrderMessage> RecordFeed(std::size_t steps) {
+  OrderBook ob;
+  CaptureSink sink;
+  ob.SetOrderMessageSink(&sink);
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<Underlying> price_rn(80, 120);
+  std::uniform_int_distribution<Underlying> qty_rn(1, 50);
+  std::uniform_int_distribution<int> action_rn(0, 9);
+  std::vector<OrderId> ids;
+
+  for (std::size_t i = 0; i < steps; ++i) {
+    OrderSide side = rng() % 2 == 0 ? OrderSide::kBuy : OrderSide::kSell;
+    int action = action_rn(rng);
+    if (action < 6) {
+      auto r = ob.AddLimit(UserId{1}, side, Price{price_rn(rng)},
+                           Quantity{qty_rn(rng)}, TimeInForce::kGoodTillCancel);
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (action < 7) {
+      auto r = ob.AddMarket(UserId{2}, side, Quantity{qty_rn(rng)});
+      benchmark::DoNotOptimize(r);
+    } else if (!ids.empty()) {
+      ob.Cancel(ids[rng() % ids.size()]);
+    }
+  }
+  return sink.messages;
+}
+}  // namespace
+
+static void BM_BookBuilder_ApplyFeed(benchmark::State& st) {
+  const auto feed = RecordFeed(static_cast<std::size_t>(st.range(0)));
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    BookBuilder builder;
+    builder.Reserve(feed.size(), feed.size());
+    for (const auto& message : feed) {
+      builder.Apply(message);
+    }
+    benchmark::DoNotOptimize(builder.OrderCount());
+  }
+
+  st.SetItemsProcessed(st.iterations() * static_cast<int64_t>(feed.size()));
+  perf.Report(st, static_cast<double>(st.iterations()) *
+                      static_cast<double>(feed.size()));
+}
+
+BENCHMARK(BM_BookBuilder_ApplyFeed)->Arg(100000)->Arg(1000000);
+}  // namespace order_book_v1
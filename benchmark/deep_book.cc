@@ -0,0 +1,287 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "orderbook.h"
+#include "perf_region.h"
+#include "types.h"
+
+// Scaling suites for books far deeper than the micro-cases: up to 1M resting
+// asks across up to 100k price levels. Arguments are {orders, levels,
+// distribution}. Like limit_market_cancel.cc, every case restores the book's
+// shape within the iteration, so one seeded book serves the whole run; it is
+// cached between the runs Google Benchmark makes of the same instance. Pass
+// --benchmark_out=scaling.csv --benchmark_out_format=csv to keep the results.
+
+namespace order_book_v1 {
+namespace {
+constexpr Underlying kMid = 1'000'000;
+constexpr Quantity kOrderQty{10};
+constexpr TimeInForce kGtc = TimeInForce::kGoodTillCancel;
+// Orders taken by one market sweep, spread over as many levels as that needs
+constexpr std::size_t kSweepOrders = 100;
+
+enum class Distribution : int64_t {
+  kUniform = 0,  // Same number of orders on every level
+  kTouchHeavy,   // Orders per level fall off as 1/depth from the touch
+  kSparse,       // Uniform counts, but levels 1-8 ticks apart
+};
+
+const char* DistributionName(Distribution distribution) {
+  switch (distribution) {
+    case Distribution::kUniform:
+      return "uniform";
+    case Distribution::kTouchHeavy:
+      return "touch_heavy";
+    case Distribution::kSparse:
+      return "sparse";
+  }
+  return "unknown";
+}
+
+struct DeepBookLevel {
+  Price price;
+  // Resting order ids, oldest first as of seeding. Cancels replace entries in
+  // place, so the ids stay valid but their queue order does not.
+  std::vector<OrderId> ids;
+};
+
+struct DeepBook {
+  int64_t orders = 0;
+  int64_t levels = 0;
+  Distribution distribution = Distribution::kUniform;
+  OrderBook book;
+  std::vector<DeepBookLevel> asks;
+  // Cleared by cases that consume orders without tracking the new ids
+  bool ids_valid = true;
+};
+
+std::vector<std::size_t> OrdersPerLevel(std::size_t orders, std::size_t levels,
+                                        Distribution distribution) {
+  std::vector<std::size_t> counts(levels, 1);
+  std::size_t remaining = orders - levels;
+  if (distribution == Distribution::kTouchHeavy) {
+    double total_weight = 0;
+    for (std::size_t i = 0; i < levels; ++i) {
+      total_weight += 1.0 / static_cast<double>(i + 1);
+    }
+    std::size_t assigned = 0;
+    for (std::size_t i = 0; i < levels; ++i) {
+      auto share = static_cast<std::size_t>(static_cast<double>(remaining) /
+                                            static_cast<double>(i + 1) /
+                                            total_weight);
+      counts[i] += share;
+      assigned += share;
+    }
+    counts[0] += remaining - assigned;
+  } else {
+    for (std::size_t i = 0; i < levels; ++i) {
+      counts[i] += remaining / levels + (i < remaining % levels ? 1 : 0);
+    }
+  }
+  return counts;
+}
+
+std::unique_ptr<DeepBook> BuildDeepBook(int64_t orders, int64_t levels,
+                                        Distribution distribution) {
+  auto deep = std::make_unique<DeepBook>();
+  deep->orders = orders;
+  deep->levels = levels;
+  deep->distribution = distribution;
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<Underlying> gap_rn(1, 8);
+  auto counts = OrdersPerLevel(static_cast<std::size_t>(orders),
+                               static_cast<std::size_t>(levels), distribution);
+
+  Underlying price = kMid;
+  deep->asks.reserve(counts.size());
+  for (std::size_t count : counts) {
+    price += distribution == Distribution::kSparse ? gap_rn(rng) : 1;
+    DeepBookLevel level{.price = Price{price}, .ids = {}};
+    level.ids.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      auto add = deep->book.AddLimit(UserId{1}, OrderSide::kSell, level.price,
+                                     kOrderQty, kGtc);
+      if (add.has_value()) level.ids.emplace_back(add->order_id);
+    }
+    deep->asks.emplace_back(std::move(level));
+  }
+  return deep;
+}
+
+// Seeding a million orders takes long enough that rebuilding for every run of
+// the same instance would dominate the suite
+DeepBook& GetDeepBook(benchmark::State& st) {
+  static std::unique_ptr<DeepBook> cached;
+  const auto distribution = static_cast<Distribution>(st.range(2));
+  if (!cached || !cached->ids_valid || cached->orders != st.range(0) ||
+      cached->levels != st.range(1) || cached->distribution != distribution) {
+    cached.reset();
+    cached = BuildDeepBook(st.range(0), st.range(1), distribution);
+  }
+  st.SetLabel(DistributionName(distribution));
+  st.counters["orders"] = static_cast<double>(st.range(0));
+  st.counters["levels"] = static_cast<double>(st.range(1));
+  return *cached;
+}
+
+void SetPerOp(benchmark::State& st, double calls_per_iteration,
+              PerfRegion& perf) {
+  const double calls =
+      static_cast<double>(st.iterations()) * calls_per_iteration;
+  st.SetItemsProcessed(static_cast<int64_t>(calls));
+  st.counters["per_op"] = benchmark::Counter(
+      calls, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  perf.Report(st, calls);
+}
+
+// Cancels the ids of one level round-robin, replacing each with a new order
+// at the back of the same level
+void CancelAndReplace(benchmark::State& st, DeepBook& deep,
+                      DeepBookLevel& level) {
+  std::size_t next = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    bool ok = deep.book.Cancel(level.ids[next]);
+    benchmark::DoNotOptimize(ok);
+    auto add = deep.book.AddLimit(UserId{2}, OrderSide::kSell, level.price,
+                                  kOrderQty, kGtc);
+    if (add.has_value()) level.ids[next] = add->order_id;
+    if (++next == level.ids.size()) next = 0;
+  }
+  SetPerOp(st, 2, perf);
+}
+}  // namespace
+
+// Joins the back of a randomly chosen existing level, then cancels
+static void BM_DeepBook_AddCancel(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+  std::mt19937 rng(11);
+  std::vector<Price> prices(4096);
+  for (auto& price : prices) price = deep.asks[rng() % deep.asks.size()].price;
+  std::size_t next = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    auto add = deep.book.AddLimit(UserId{2}, OrderSide::kSell, prices[next],
+                                  kOrderQty, kGtc);
+    benchmark::DoNotOptimize(add);
+    if (add.has_value()) deep.book.Cancel(add->order_id);
+    next = (next + 1) % prices.size();
+  }
+  SetPerOp(st, 2, perf);
+}
+
+static void BM_DeepBook_CancelNearTouch(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+  CancelAndReplace(st, deep, deep.asks.front());
+}
+
+static void BM_DeepBook_CancelFarFromTouch(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+  CancelAndReplace(st, deep, deep.asks.back());
+}
+
+// Buys kSweepOrders orders off the touch with one market order, then rests
+// the same orders again level by level
+static void BM_DeepBook_MarketSweep(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+
+  // The sweep always removes the same number of orders from the same levels
+  // because every order has the same quantity and refills restore the counts
+  std::vector<std::pair<Price, std::size_t>> refills;
+  std::size_t planned = 0;
+  for (const auto& level : deep.asks) {
+    if (planned == kSweepOrders) break;
+    std::size_t take = std::min(level.ids.size(), kSweepOrders - planned);
+    refills.emplace_back(level.price, take);
+    planned += take;
+  }
+  const Quantity sweep_qty{static_cast<Underlying>(planned * kOrderQty.v)};
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    auto sweep = deep.book.AddMarket(UserId{3}, OrderSide::kBuy, sweep_qty);
+    benchmark::DoNotOptimize(sweep);
+    for (const auto& [price, count] : refills) {
+      for (std::size_t i = 0; i < count; ++i) {
+        auto add = deep.book.AddLimit(UserId{1}, OrderSide::kSell, price,
+                                      kOrderQty, kGtc);
+        benchmark::DoNotOptimize(add);
+      }
+    }
+  }
+  deep.ids_valid = false;
+
+  SetPerOp(st, static_cast<double>(1 + planned), perf);
+  st.counters["levels_swept"] = static_cast<double>(refills.size());
+}
+
+static void BM_DeepBook_ToHash(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    benchmark::DoNotOptimize(deep.book.ToHash());
+  }
+  SetPerOp(st, 1, perf);
+}
+
+// MemoryStats() is O(1); the interesting output is the footprint counters
+static void BM_DeepBook_MemoryStats(benchmark::State& st) {
+  DeepBook& deep = GetDeepBook(st);
+
+  BookMemoryStats stats;
+  for (auto _ : st) {
+    stats = deep.book.MemoryStats();
+    benchmark::DoNotOptimize(stats);
+  }
+  st.counters["level_bytes"] = static_cast<double>(stats.level_node_bytes);
+  st.counters["order_bytes"] = static_cast<double>(stats.order_node_bytes);
+  st.counters["index_bytes"] = static_cast<double>(stats.index_node_bytes +
+                                                   stats.index_bucket_bytes);
+  st.counters["total_bytes"] = static_cast<double>(stats.total_bytes());
+  st.counters["bytes_per_order"] = stats.bytes_per_order();
+}
+
+namespace {
+void ScalingArgs(benchmark::internal::Benchmark* b) {
+  for (int64_t distribution : {0, 1, 2}) {
+    for (int64_t orders : {1'000, 10'000, 100'000, 1'000'000}) {
+      for (int64_t levels : {10, 1'000, 100'000}) {
+        if (levels > orders) continue;
+        b->Args({orders, levels, distribution});
+      }
+    }
+  }
+  b->ArgNames({"orders", "levels", "dist"});
+}
+
+// Footprint depends on the order and level counts, not on how orders are
+// spread over the levels
+void MemoryArgs(benchmark::internal::Benchmark* b) {
+  for (int64_t orders : {10'000, 100'000, 1'000'000}) {
+    for (int64_t levels : {10, 1'000, 100'000}) {
+      if (levels > orders) continue;
+      b->Args({orders, levels, 0});
+    }
+  }
+  b->ArgNames({"orders", "levels", "dist"});
+}
+}  // namespace
+
+BENCHMARK(BM_DeepBook_AddCancel)->Apply(ScalingArgs);
+BENCHMARK(BM_DeepBook_CancelNearTouch)->Apply(ScalingArgs);
+BENCHMARK(BM_DeepBook_CancelFarFromTouch)->Apply(ScalingArgs);
+BENCHMARK(BM_DeepBook_MarketSweep)->Apply(ScalingArgs);
+BENCHMARK(BM_DeepBook_ToHash)->Apply(ScalingArgs);
+BENCHMARK(BM_DeepBook_MemoryStats)->Apply(MemoryArgs);
+}  // namespace order_book_v1
@@ -6,8 +6,16 @@
 #include <vector>
 
 #include "orderbook.h"
+#include "perf_region.h"
 #include "types.h"
 
+// Every case seeds one book up front and then runs its operation against it in
+// steady state. Operations that consume liquidity are paired with the add that
+// restores it, so the book has the same shape at the start of every iteration
+// and nothing is paused, rebuilt or destroyed inside the timed loop. The
+// per_op counter is wall time divided by engine calls, so a pair reports the
+// mean of its two calls.
+
 namespace order_book_v1 {
 namespace {
 constexpr Price kMid{100};
@@ -27,16 +35,19 @@ class NullStream : public std::ostream {
   NullBuffer buffer_;
 };
 
+Price MakerPrice(OrderSide maker_side, std::size_t level) {
+  return maker_side == OrderSide::kSell
+             ? Price{static_cast<Underlying>(kMid.v + 1 + level)}
+             : Price{static_cast<Underlying>(kMid.v - 1 - level)};
+}
+
 void SeedOpposingBook(OrderBook& ob, OrderSide taker_side, std::size_t levels,
                       std::size_t orders_per_level, Quantity qty_per_order) {
   const OrderSide maker_side =
       taker_side == OrderSide::kBuy ? OrderSide::kSell : OrderSide::kBuy;
 
   for (std::size_t level = 0; level < levels; ++level) {
-    Price level_price =
-        maker_side == OrderSide::kSell
-            ? Price{static_cast<Underlying>(kMid.v + 1 + level)}
-            : Price{static_cast<Underlying>(kMid.v - 1 - level)};
+    Price level_price = MakerPrice(maker_side, level);
     for (std::size_t i = 0; i < orders_per_level; ++i) {
       auto add =
           ob.AddLimit(UserId{static_cast<Underlying>(1000 + level * 100 + i)},
@@ -62,104 +73,225 @@ std::vector<OrderId> SeedCancelableOrders(OrderBook& ob, std::size_t levels,
   }
   return ids;
 }
+
+void SetPerOp(benchmark::State& st, std::size_t calls_per_iteration,
+              PerfRegion& perf) {
+  const auto calls = static_cast<double>(st.iterations() * calls_per_iteration);
+  st.SetItemsProcessed(static_cast<int64_t>(calls));
+  st.counters["per_op"] = benchmark::Counter(
+      calls, benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+  perf.Report(st, calls);
+}
 }  // namespace
 
-static void BM_AddLimit_Resting(benchmark::State& st) {
+// Add a resting bid below the opposing book, then cancel it
+static void BM_AddCancel_Resting(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
+                   static_cast<std::size_t>(st.range(1)), kLevelQty);
   std::size_t total_rejects = 0;
-  std::size_t total_trades = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
-                     static_cast<std::size_t>(st.range(1)), kLevelQty);
-    st.ResumeTiming();
-
     auto add = ob.AddLimit(UserId{1}, OrderSide::kBuy, Price{kMid.v - 1},
                            Quantity{5}, kGtc);
     benchmark::DoNotOptimize(add);
-
     if (add.has_value()) {
-      total_trades += add->immediate_trades.size();
+      bool ok = ob.Cancel(add->order_id);
+      benchmark::DoNotOptimize(ok);
     } else {
       ++total_rejects;
     }
   }
 
-  st.counters["trades_per_op"] = benchmark::Counter(
-      static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
+  SetPerOp(st, 2, perf);
   st.counters["reject_rate"] = benchmark::Counter(
       static_cast<double>(total_rejects), benchmark::Counter::kAvgIterations);
 }
 
+// A crossing limit takes exactly one maker order off the best ask, then the
+// maker is re-added at the back of the same level
 static void BM_AddLimit_CrossingImmediateFill(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
+                   static_cast<std::size_t>(st.range(1)), kLevelQty);
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
   std::size_t total_trades = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
-                     static_cast<std::size_t>(st.range(1)), kLevelQty);
-    st.ResumeTiming();
-
     auto add = ob.AddLimit(UserId{2}, OrderSide::kBuy, Price{kMid.v + 10},
-                           Quantity{5}, kGtc);
+                           kLevelQty, kGtc);
     benchmark::DoNotOptimize(add);
     if (add.has_value()) total_trades += add->immediate_trades.size();
+
+    auto refill =
+        ob.AddLimit(UserId{1000}, OrderSide::kSell, best_ask, kLevelQty, kGtc);
+    benchmark::DoNotOptimize(refill);
   }
 
+  SetPerOp(st, 2, perf);
   st.counters["trades_per_op"] = benchmark::Counter(
       static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
 }
 
 static void BM_AddMarket_FullFill(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
+                   static_cast<std::size_t>(st.range(1)), kLevelQty);
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
   std::size_t total_trades = 0;
   std::size_t total_rejects = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    SeedOpposingBook(ob, OrderSide::kBuy, static_cast<std::size_t>(st.range(0)),
-                     static_cast<std::size_t>(st.range(1)), kLevelQty);
-    st.ResumeTiming();
-
-    auto add = ob.AddMarket(UserId{3}, OrderSide::kBuy, Quantity{5});
+    auto add = ob.AddMarket(UserId{3}, OrderSide::kBuy, kLevelQty);
     benchmark::DoNotOptimize(add);
     if (add.has_value()) {
       total_trades += add->immediate_trades.size();
     } else {
       ++total_rejects;
     }
+
+    auto refill =
+        ob.AddLimit(UserId{1000}, OrderSide::kSell, best_ask, kLevelQty, kGtc);
+    benchmark::DoNotOptimize(refill);
   }
 
+  SetPerOp(st, 2, perf);
   st.counters["trades_per_op"] = benchmark::Counter(
       static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
   st.counters["reject_rate"] = benchmark::Counter(
       static_cast<double>(total_rejects), benchmark::Counter::kAvgIterations);
 }
 
+// BM_AddMarket_FullFill on a 5x10 book with self-trade prevention set to
+// SelfTradePrevention{range(0)}. The taker never meets its own orders, so
+// this is the cost of the check alone.
+static void BM_AddMarket_FullFillSelfTradeCheck(benchmark::State& st) {
+  NullStream sink;
+  OrderBook ob(&sink);
+  ob.SetSelfTradePrevention(static_cast<SelfTradePrevention>(st.range(0)));
+  SeedOpposingBook(ob, OrderSide::kBuy, 5, 10, kLevelQty);
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
+  std::size_t total_trades = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    auto add = ob.AddMarket(UserId{3}, OrderSide::kBuy, kLevelQty);
+    benchmark::DoNotOptimize(add);
+    if (add.has_value()) total_trades += add->immediate_trades.size();
+
+    auto refill =
+        ob.AddLimit(UserId{1000}, OrderSide::kSell, best_ask, kLevelQty, kGtc);
+    benchmark::DoNotOptimize(refill);
+  }
+
+  SetPerOp(st, 2, perf);
+  st.counters["trades_per_op"] = benchmark::Counter(
+      static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
+}
+
+// BM_AddMarket_FullFill on a 5x10 book with range(0) stops waiting on each
+// side, spread over 1000 trigger prices well away from anything that trades,
+// so every fill pays for the trigger check and never for a release
+static void BM_AddMarket_FullFillWaitingStops(benchmark::State& st) {
+  NullStream sink;
+  OrderBook ob(&sink);
+  SeedOpposingBook(ob, OrderSide::kBuy, 5, 10, kLevelQty);
+  const auto stops = static_cast<Underlying>(st.range(0));
+  for (Underlying i = 0; i < stops; ++i) {
+    auto buy_stop = ob.AddStop(UserId{4000 + i}, OrderSide::kBuy,
+                               Price{kMid.v * 2 + i % 1000}, kLevelQty);
+    auto sell_stop = ob.AddStop(UserId{4000 + i}, OrderSide::kSell,
+                                Price{1 + i % (kMid.v / 2)}, kLevelQty);
+    benchmark::DoNotOptimize(buy_stop);
+    benchmark::DoNotOptimize(sell_stop);
+  }
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
+  std::size_t total_trades = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    auto add = ob.AddMarket(UserId{3}, OrderSide::kBuy, kLevelQty);
+    benchmark::DoNotOptimize(add);
+    if (add.has_value()) total_trades += add->immediate_trades.size();
+
+    auto refill =
+        ob.AddLimit(UserId{1000}, OrderSide::kSell, best_ask, kLevelQty, kGtc);
+    benchmark::DoNotOptimize(refill);
+  }
+
+  SetPerOp(st, 2, perf);
+  st.counters["trades_per_op"] = benchmark::Counter(
+      static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
+}
+
+// Icebergs that outlast the run hold the best bid and ask. Each iteration
+// parks range(0) buy stops at the ask, lifts the ask with a market buy, which
+// releases all of them into it, and hits the bid so the next batch waits
+// again.
+static void BM_AddMarket_ReleaseStops(benchmark::State& st) {
+  NullStream sink;
+  OrderBook ob(&sink);
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
+  const Price best_bid = MakerPrice(OrderSide::kBuy, 0);
+  auto ask = ob.AddIceberg(UserId{1000}, OrderSide::kSell, best_ask,
+                           Quantity{4'000'000'000}, kLevelQty);
+  auto bid = ob.AddIceberg(UserId{1001}, OrderSide::kBuy, best_bid,
+                           Quantity{4'000'000'000}, kLevelQty);
+  benchmark::DoNotOptimize(ask);
+  benchmark::DoNotOptimize(bid);
+  const auto stops = static_cast<Underlying>(st.range(0));
+  std::size_t total_triggered = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    for (Underlying i = 0; i < stops; ++i) {
+      auto stop = ob.AddStop(UserId{4000 + i}, OrderSide::kBuy, best_ask,
+                             Quantity{1});
+      benchmark::DoNotOptimize(stop);
+    }
+    auto lift = ob.AddMarket(UserId{3}, OrderSide::kBuy, kLevelQty);
+    benchmark::DoNotOptimize(lift);
+    if (lift.has_value()) total_triggered += lift->triggered_trades.size();
+    auto hit = ob.AddMarket(UserId{3}, OrderSide::kSell, kLevelQty);
+    benchmark::DoNotOptimize(hit);
+  }
+
+  SetPerOp(st, stops + 2, perf);
+  st.counters["released_per_op"] = benchmark::Counter(
+      static_cast<double>(total_triggered), benchmark::Counter::kAvgIterations);
+}
+
+// The market order empties the only level and the remainder is dropped, so
+// every iteration also creates and erases that level
 static void BM_AddMarket_PartialFill(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  SeedOpposingBook(ob, OrderSide::kBuy, 1, 1, Quantity{3});
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
   std::size_t total_trades = 0;
   std::size_t total_remaining = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    SeedOpposingBook(ob, OrderSide::kBuy, 1, 1, Quantity{3});
-    st.ResumeTiming();
-
     auto add = ob.AddMarket(UserId{4}, OrderSide::kBuy, Quantity{9});
     benchmark::DoNotOptimize(add);
     if (add.has_value()) {
       total_trades += add->immediate_trades.size();
       total_remaining += add->remaining_qty.v;
     }
+
+    auto refill =
+        ob.AddLimit(UserId{1000}, OrderSide::kSell, best_ask, Quantity{3}, kGtc);
+    benchmark::DoNotOptimize(refill);
   }
 
+  SetPerOp(st, 2, perf);
   st.counters["trades_per_op"] = benchmark::Counter(
       static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
   st.counters["remaining_qty_per_op"] = benchmark::Counter(
@@ -168,68 +300,180 @@ static void BM_AddMarket_PartialFill(benchmark::State& st) {
 
 static void BM_AddMarket_EmptyReject(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
   std::size_t total_rejects = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    st.ResumeTiming();
-
     auto add = ob.AddMarket(UserId{5}, OrderSide::kBuy, Quantity{1});
     benchmark::DoNotOptimize(add);
     if (!add.has_value()) ++total_rejects;
   }
 
+  SetPerOp(st, 1, perf);
   st.counters["reject_rate"] = benchmark::Counter(
       static_cast<double>(total_rejects), benchmark::Counter::kAvgIterations);
 }
 
+// One ask level of range(0) icebergs, each showing kLevelQty from a reserve
+// that outlasts the run. Every market buy takes range(1) slices, each of
+// which replenishes and re-queues its iceberg, so the level keeps its shape
+// without any refill adds.
+static void BM_AddMarket_IcebergLevel(benchmark::State& st) {
+  NullStream sink;
+  OrderBook ob(&sink);
+  const Price best_ask = MakerPrice(OrderSide::kSell, 0);
+  const auto icebergs = static_cast<Underlying>(st.range(0));
+  for (Underlying i = 0; i < icebergs; ++i) {
+    auto add = ob.AddIceberg(UserId{1000 + i}, OrderSide::kSell, best_ask,
+                             Quantity{4'000'000'000}, kLevelQty);
+    benchmark::DoNotOptimize(add);
+  }
+  const Quantity taker_qty{kLevelQty.v * static_cast<Underlying>(st.range(1))};
+  std::size_t total_trades = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    auto add = ob.AddMarket(UserId{3}, OrderSide::kBuy, taker_qty);
+    benchmark::DoNotOptimize(add);
+    if (add.has_value()) total_trades += add->immediate_trades.size();
+  }
+
+  SetPerOp(st, 1, perf);
+  st.counters["trades_per_op"] = benchmark::Counter(
+      static_cast<double>(total_trades), benchmark::Counter::kAvgIterations);
+}
+
+// Cancels the seeded orders round-robin and replaces each with a fresh order
+// at the back of the same level
 static void BM_Cancel_Hit(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  const auto orders_per_level = static_cast<std::size_t>(st.range(1));
+  auto ids = SeedCancelableOrders(ob, static_cast<std::size_t>(st.range(0)),
+                                  orders_per_level);
+  std::size_t next = 0;
   std::size_t total_success = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    auto ids = SeedCancelableOrders(ob, static_cast<std::size_t>(st.range(0)),
-                                    static_cast<std::size_t>(st.range(1)));
-    st.ResumeTiming();
-
-    bool ok = ob.Cancel(ids.front());
+    bool ok = ob.Cancel(ids[next]);
     benchmark::DoNotOptimize(ok);
     if (ok) ++total_success;
+
+    Price px{static_cast<Underlying>(kMid.v - 5 - next / orders_per_level)};
+    auto add = ob.AddLimit(UserId{2000}, OrderSide::kBuy, px, kLevelQty, kGtc);
+    if (add.has_value()) ids[next] = add->order_id;
+    if (++next == ids.size()) next = 0;
+  }
+
+  SetPerOp(st, 2, perf);
+  st.counters["success_rate"] = benchmark::Counter(
+      static_cast<double>(total_success), benchmark::Counter::kAvgIterations);
+}
+
+// Amends the seeded orders round-robin, moving each one tick away from the
+// mid and back, the one-call equivalent of the cancel and re-add pair that
+// BM_Cancel_Hit times
+static void BM_Modify_Reprice(benchmark::State& st) {
+  NullStream sink;
+  OrderBook ob(&sink);
+  const auto orders_per_level = static_cast<std::size_t>(st.range(1));
+  auto ids = SeedCancelableOrders(ob, static_cast<std::size_t>(st.range(0)),
+                                  orders_per_level);
+  std::size_t next = 0;
+  Underlying shift = 1;
+  std::size_t total_success = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    Price px{static_cast<Underlying>(kMid.v - 5 - next / orders_per_level -
+                                     shift)};
+    auto modify = ob.Modify(ids[next], kLevelQty, px);
+    benchmark::DoNotOptimize(modify);
+    if (modify.has_value()) ++total_success;
+    if (++next == ids.size()) {
+      next = 0;
+      shift ^= 1;
+    }
   }
 
+  SetPerOp(st, 1, perf);
   st.counters["success_rate"] = benchmark::Counter(
       static_cast<double>(total_success), benchmark::Counter::kAvgIterations);
 }
 
+// range(0) resting bids spread over 1000 levels, owned round-robin by users
+// with range(1) orders each. One user's orders are mass cancelled and then
+// re-added at the same prices, so the book keeps its size.
+static void BM_CancelAllForUser(benchmark::State& st) {
+  constexpr Underlying kLevels = 1000;
+  NullStream sink;
+  OrderBook ob(&sink);
+  const auto resting = static_cast<Underlying>(st.range(0));
+  const auto per_user = static_cast<Underlying>(st.range(1));
+  const Underlying users = resting / per_user;
+  for (Underlying i = 0; i < resting; ++i) {
+    auto add = ob.AddLimit(UserId{i % users}, OrderSide::kBuy,
+                           Price{1 + i % kLevels}, kLevelQty, kGtc);
+    benchmark::DoNotOptimize(add);
+  }
+  Underlying user = 0;
+  std::size_t total_cancelled = 0;
+
+  PerfRegion perf;
+  for (auto _ : st) {
+    std::size_t cancelled = ob.CancelAllForUser(UserId{user});
+    benchmark::DoNotOptimize(cancelled);
+    total_cancelled += cancelled;
+
+    for (Underlying i = user; i < resting; i += users) {
+      auto add = ob.AddLimit(UserId{user}, OrderSide::kBuy,
+                             Price{1 + i % kLevels}, kLevelQty, kGtc);
+      benchmark::DoNotOptimize(add);
+    }
+    if (++user == users) user = 0;
+  }
+
+  SetPerOp(st, 1 + per_user, perf);
+  st.counters["cancelled_per_call"] = benchmark::Counter(
+      static_cast<double>(total_cancelled), benchmark::Counter::kAvgIterations);
+}
+
 static void BM_Cancel_Miss(benchmark::State& st) {
   NullStream sink;
+  OrderBook ob(&sink);
+  auto ids = SeedCancelableOrders(ob, static_cast<std::size_t>(st.range(0)),
+                                  static_cast<std::size_t>(st.range(1)));
+  benchmark::DoNotOptimize(ids);
   std::size_t total_miss = 0;
 
+  PerfRegion perf;
   for (auto _ : st) {
-    st.PauseTiming();
-    OrderBook ob(&sink);
-    auto ids = SeedCancelableOrders(ob, static_cast<std::size_t>(st.range(0)),
-                                    static_cast<std::size_t>(st.range(1)));
-    benchmark::DoNotOptimize(ids);
-    st.ResumeTiming();
-
     bool ok = ob.Cancel(OrderId{0x7fffffff});
     benchmark::DoNotOptimize(ok);
     if (!ok) ++total_miss;
   }
 
+  SetPerOp(st, 1, perf);
   st.counters["miss_rate"] = benchmark::Counter(
       static_cast<double>(total_miss), benchmark::Counter::kAvgIterations);
 }
 
-BENCHMARK(BM_AddLimit_Resting)->Args({5, 10})->Args({20, 20});
+BENCHMARK(BM_AddCancel_Resting)->Args({5, 10})->Args({20, 20});
 BENCHMARK(BM_AddLimit_CrossingImmediateFill)->Args({5, 10})->Args({20, 20});
 BENCHMARK(BM_AddMarket_FullFill)->Args({5, 10})->Args({20, 20});
+BENCHMARK(BM_AddMarket_FullFillSelfTradeCheck)->Arg(0)->Arg(4);
+BENCHMARK(BM_AddMarket_FullFillWaitingStops)->Arg(0)->Arg(100'000);
+BENCHMARK(BM_AddMarket_ReleaseStops)->Arg(1)->Arg(10)->Arg(100);
 BENCHMARK(BM_AddMarket_PartialFill);
 BENCHMARK(BM_AddMarket_EmptyReject);
+BENCHMARK(BM_AddMarket_IcebergLevel)->Args({10, 1})->Args({100, 10});
 BENCHMARK(BM_Cancel_Hit)->Args({5, 10})->Args({20, 20});
 BENCHMARK(BM_Cancel_Miss)->Args({5, 10})->Args({20, 20});
+BENCHMARK(BM_Modify_Reprice)->Args({5, 10})->Args({20, 20});
+BENCHMARK(BM_CancelAllForUser)
+    ->Args({10'000, 100})
+    ->Args({100'000, 100})
+    ->Args({100'000, 1'000});
 }  // namespace order_book_v1
@@ -0,0 +1,140 @@
+#include "perf_counters.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace order_book_v1 {
+namespace {
+constexpr uint64_t CacheConfig(uint64_t cache, uint64_t op, uint64_t result) {
+  return cache | (op << 8) | (result << 16);
+}
+
+struct EventSpec {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr std::array<EventSpec, kPerfEventCount> kSpecs = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE,
+     CacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE,
+     CacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ,
+                 PERF_COUNT_HW_CACHE_RESULT_MISS)},
+}};
+
+bool RequestedByEnv() {
+  const char* value = std::getenv("ORDERBOOK_PERF_COUNTERS");
+  return value != nullptr && *value != '\0' && std::string(value) != "0";
+}
+
+int OpenEvent(const EventSpec& spec) {
+  perf_event_attr attr{};
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+}
+}  // namespace
+
+std::string_view PerfEventName(PerfEvent event) {
+  switch (event) {
+    case PerfEvent::kCycles:
+      return "cycles";
+    case PerfEvent::kInstructions:
+      return "instructions";
+    case PerfEvent::kL1dMisses:
+      return "l1d_misses";
+    case PerfEvent::kLlcMisses:
+      return "llc_misses";
+    case PerfEvent::kBranchMisses:
+      return "branch_misses";
+    case PerfEvent::kDtlbMisses:
+      return "dtlb_misses";
+  }
+  return "unknown";
+}
+
+PerfCounters& PerfCounters::Instance() {
+  static PerfCounters counters;
+  return counters;
+}
+
+PerfCounters::PerfCounters() {
+  fds_.fill(-1);
+  if (!RequestedByEnv()) return;
+
+  int first_error = 0;
+  for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+    fds_[i] = OpenEvent(kSpecs[i]);
+    if (fds_[i] < 0 && first_error == 0) first_error = errno;
+  }
+  if (!enabled()) {
+    std::cerr << "perf counters unavailable: " << std::strerror(first_error)
+              << "\n";
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (int fd : fds_) {
+    if (fd >= 0) close(fd);
+  }
+}
+
+bool PerfCounters::enabled() const {
+  for (int fd : fds_) {
+    if (fd >= 0) return true;
+  }
+  return false;
+}
+
+void PerfCounters::Start() {
+  for (int fd : fds_) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void PerfCounters::Stop() {
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+
+  for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+    values_[i].reset();
+    if (fds_[i] < 0) continue;
+
+    // value, time_enabled, time_running
+    std::array<uint64_t, 3> data{};
+    if (read(fds_[i], data.data(), sizeof(data)) !=
+            static_cast<ssize_t>(sizeof(data)) ||
+        data[2] == 0) {
+      continue;
+    }
+    values_[i] = static_cast<double>(data[0]) * static_cast<double>(data[1]) /
+                 static_cast<double>(data[2]);
+  }
+}
+
+std::optional<double> PerfCounters::Value(PerfEvent event) const {
+  return values_[static_cast<std::size_t>(event)];
+}
+}  // namespace order_book_v1
@@ -0,0 +1,55 @@
+#ifndef BENCHMARK_PERF_COUNTERS_H_
+#define BENCHMARK_PERF_COUNTERS_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace order_book_v1 {
+enum class PerfEvent : uint8_t {
+  kCycles = 0,
+  kInstructions,
+  kL1dMisses,
+  kLlcMisses,
+  kBranchMisses,
+  kDtlbMisses,
+};
+
+constexpr std::size_t kPerfEventCount = 6;
+std::string_view PerfEventName(PerfEvent event);
+
+// Counts hardware events for the calling thread between Start() and Stop()
+// through perf_event_open. Counting is opt-in: nothing is opened unless
+// ORDERBOOK_PERF_COUNTERS is set to a non-empty value other than "0". Each
+// event is opened on its own, so an event the CPU or kernel refuses (common
+// in VMs and containers, or with a restrictive perf_event_paranoid) is simply
+// missing from the results while the rest still work.
+class PerfCounters {
+ public:
+  // Process-wide instance, opened on first use
+  static PerfCounters& Instance();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  ~PerfCounters();
+
+  // True if at least one event could be opened
+  bool enabled() const;
+
+  void Start();
+  void Stop();
+  // Count from the last Start()/Stop() pair, scaled up if the kernel had to
+  // multiplex the event. nullopt if the event is unavailable.
+  std::optional<double> Value(PerfEvent event) const;
+
+ private:
+  PerfCounters();
+
+  std::array<int, kPerfEventCount> fds_;
+  std::array<std::optional<double>, kPerfEventCount> values_;
+};
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef BENCHMARK_PERF_REGION_H_
+#define BENCHMARK_PERF_REGION_H_
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <string>
+
+#include "alloc_counter.h"
+#include "perf_counters.h"
+
+namespace order_book_v1 {
+// Counts hardware events and heap allocations from construction until
+// Report(), meant to bracket a benchmark's timed loop. Report() adds one user
+// counter per available event, divided by the number of operations. Costs
+// nothing unless counters or allocation counting are enabled.
+class PerfRegion {
+ public:
+  PerfRegion()
+      : counters_(PerfCounters::Instance()), allocs_(ThreadAllocStats()) {
+    if (counters_.enabled()) counters_.Start();
+  }
+
+  void Report(benchmark::State& st, double ops) {
+    if (ops <= 0) return;
+    if (AllocCountingEnabled()) {
+      AllocStats now = ThreadAllocStats();
+      st.counters["allocs_per_op"] =
+          static_cast<double>(now.allocs - allocs_.allocs) / ops;
+      st.counters["bytes_per_op"] =
+          static_cast<double>(now.bytes - allocs_.bytes) / ops;
+    }
+    if (!counters_.enabled()) return;
+    counters_.Stop();
+    for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+      auto event = static_cast<PerfEvent>(i);
+      auto value = counters_.Value(event);
+      if (value.has_value()) {
+        st.counters[std::string(PerfEventName(event))] = *value / ops;
+      }
+    }
+  }
+
+ private:
+  PerfCounters& counters_;
+  AllocStats allocs_;
+};
+}  // namespace order_book_v1
+
+#endif
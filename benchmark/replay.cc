@@ -0,0 +1,205 @@
+// Replays a large event stream through one OrderBook and reports sustained
+// throughput plus per-event latency percentiles by event type. The stream is
+// either a recorded journal (--input) or the WorkloadGenerator stream for a
+// seed. Set ORDERBOOK_PERF_COUNTERS=1 to add hardware counters for the
+// throughput pass, and build with -DORDERBOOK_COUNT_ALLOCS=ON to add heap
+// allocation counts.
+//
+//   orderbook_replay_benchmark [--input <journal>] [--events <n>] [--seed <n>]
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "event_log.h"
+#include "orderbook.h"
+#include "perf_counters.h"
+#include "tsc_clock.h"
+#include "types.h"
+#include "workload.h"
+
+namespace order_book_v1 {
+namespace {
+struct ReplayConfig {
+  std::string input_path;
+  uint32_t events = 1'000'000;
+  uint32_t seed = 42;
+};
+
+// One per OrderBookEvent alternative, in variant order
+constexpr std::array<const char*, 8> kTypeNames = {
+    "limit", "market", "cancel", "modify", "cxl_all", "iceberg", "stop",
+    "set_stp"};
+static_assert(kTypeNames.size() == std::variant_size_v<OrderBookEvent>);
+
+std::size_t TypeIndex(const OrderBookEvent& event) { return event.index(); }
+
+bool LoadEvents(const std::string& path, std::vector<OrderBookEvent>& out) {
+  std::ifstream file(path);
+  if (!file.is_open()) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    auto record = ParseEvent(line);
+    if (record.has_value()) out.emplace_back(std::move(record->event));
+  }
+  return true;
+}
+
+double Percentile(const std::vector<uint64_t>& sorted, double p) {
+  if (sorted.empty()) return 0;
+  auto rank = static_cast<std::size_t>(p * static_cast<double>(sorted.size()));
+  return static_cast<double>(sorted[std::min(rank, sorted.size() - 1)]);
+}
+
+int Run(const ReplayConfig& config) {
+  std::vector<OrderBookEvent> events;
+  if (!config.input_path.empty()) {
+    if (!LoadEvents(config.input_path, events)) {
+      std::cerr << "Cannot read " << config.input_path << "\n";
+      return 3;
+    }
+  } else {
+    events = GenerateWorkload({.seed = config.seed}, config.events);
+  }
+  if (events.empty()) {
+    std::cerr << "No events to replay\n";
+    return 3;
+  }
+
+  // Pass 1: sustained throughput with nothing but the book in the loop
+  OrderBook throughput_book;
+  PerfCounters& perf = PerfCounters::Instance();
+  if (perf.enabled()) perf.Start();
+  const AllocStats allocs_before = ThreadAllocStats();
+  auto start = std::chrono::steady_clock::now();
+  for (const auto& event : events) throughput_book.Apply(event);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  const AllocStats allocs_after = ThreadAllocStats();
+  if (perf.enabled()) perf.Stop();
+  double seconds = std::chrono::duration<double>(elapsed).count();
+
+  // Pass 2: the same stream on a fresh book, stamping every event
+  const double ticks_per_ns = TscClock::Calibrate();
+  std::array<std::vector<uint64_t>, kTypeNames.size()> samples;
+  std::array<AllocStats, kTypeNames.size()> type_allocs{};
+  for (auto& s : samples) s.reserve(events.size());
+
+  OrderBook latency_book;
+  for (const auto& event : events) {
+    const AllocStats a0 = ThreadAllocStats();
+    uint64_t t0 = TscClock::Now();
+    latency_book.Apply(event);
+    uint64_t t1 = TscClock::Now();
+    const AllocStats a1 = ThreadAllocStats();
+    const std::size_t type = TypeIndex(event);
+    samples[type].emplace_back(t1 - t0);
+    type_allocs[type].allocs += a1.allocs - a0.allocs;
+    type_allocs[type].bytes += a1.bytes - a0.bytes;
+  }
+
+  // Cost of the two stamps themselves. It is not subtracted from the samples
+  // but is reported so small numbers can be read in context.
+  std::vector<uint64_t> overhead(10'000);
+  for (auto& o : overhead) {
+    uint64_t t0 = TscClock::Now();
+    uint64_t t1 = TscClock::Now();
+    o = t1 - t0;
+  }
+  std::sort(overhead.begin(), overhead.end());
+
+  std::cout << "events:        " << events.size() << "\n"
+            << "elapsed:       " << std::fixed << std::setprecision(3)
+            << seconds << " s\n"
+            << "throughput:    " << std::setprecision(0)
+            << static_cast<double>(events.size()) / seconds << " events/s\n"
+            << "tsc ticks/ns:  " << std::setprecision(3) << ticks_per_ns
+            << "\n"
+            << "clock overhead p50: " << std::setprecision(1)
+            << Percentile(overhead, 0.5) / ticks_per_ns << " ns\n"
+            << "hash:          " << latency_book.ToHash() << "\n";
+  const double count = static_cast<double>(events.size());
+  for (std::size_t i = 0; i < kPerfEventCount; ++i) {
+    auto event = static_cast<PerfEvent>(i);
+    auto value = perf.Value(event);
+    if (!value.has_value()) continue;
+    std::cout << PerfEventName(event) << "/event: " << std::setprecision(2)
+              << *value / count << "\n";
+  }
+  if (AllocCountingEnabled()) {
+    const AllocStats pass{.allocs = allocs_after.allocs - allocs_before.allocs,
+                          .bytes = allocs_after.bytes - allocs_before.bytes};
+    std::cout << "allocs/event:  " << std::setprecision(2)
+              << static_cast<double>(pass.allocs) / count << "\n"
+              << "bytes/event:   " << static_cast<double>(pass.bytes) / count
+              << "\n";
+  }
+  std::cout << "\n";
+
+  std::cout << std::left << std::setw(8) << "type" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "p50_ns"
+            << std::setw(10) << "p99_ns" << std::setw(10) << "p99.9_ns"
+            << std::setw(12) << "max_ns";
+  if (AllocCountingEnabled()) {
+    std::cout << std::setw(12) << "allocs/op" << std::setw(12) << "bytes/op";
+  }
+  std::cout << "\n";
+  for (std::size_t t = 0; t < samples.size(); ++t) {
+    auto& s = samples[t];
+    std::sort(s.begin(), s.end());
+    auto ns = [&](double p) { return Percentile(s, p) / ticks_per_ns; };
+    std::cout << std::left << std::setw(8) << kTypeNames[t] << std::right
+              << std::setw(10) << s.size() << std::setprecision(0)
+              << std::setw(10) << ns(0.5) << std::setw(10) << ns(0.99)
+              << std::setw(10) << ns(0.999) << std::setw(12) << ns(1.0);
+    if (AllocCountingEnabled() && !s.empty()) {
+      const auto n = static_cast<double>(s.size());
+      std::cout << std::setprecision(2) << std::setw(12)
+                << static_cast<double>(type_allocs[t].allocs) / n
+                << std::setw(12) << static_cast<double>(type_allocs[t].bytes) / n;
+    }
+    std::cout << "\n";
+  }
+  return 0;
+}
+
+bool ParseUint32(std::string_view text, uint32_t& out) {
+  const char* end = text.data() + text.size();
+  auto [ptr, ec] = std::from_chars(text.data(), end, out);
+  return !text.empty() && ec == std::errc() && ptr == end;
+}
+}  // namespace
+}  // namespace order_book_v1
+
+int main(int argc, char** argv) {
+  order_book_v1::ReplayConfig config;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for option: " << arg << "\n";
+      return 2;
+    }
+    const std::string_view value = argv[++i];
+    if (arg == "--input") {
+      config.input_path = value;
+    } else if (arg == "--events") {
+      if (!order_book_v1::ParseUint32(value, config.events)) return 2;
+    } else if (arg == "--seed") {
+      if (!order_book_v1::ParseUint32(value, config.seed)) return 2;
+    } else {
+      std::cerr << "Unknown option: " << arg << "\n";
+      return 1;
+    }
+  }
+  return order_book_v1::Run(config);
+}
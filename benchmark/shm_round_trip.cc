@@ -0,0 +1,58 @@
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "orderbook.h"
+#include "perf_region.h"
+#include "shm_transport.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+// Submit a resting limit order and wait for its ack, then cancel it and wait
+// for the cancel ack. Each iteration is two round trips through the rings, so
+// the book stays empty and only transport plus an add/cancel is measured.
+void BM_ShmRoundTrip_LimitCancel(benchmark::State& st) {
+  const std::string name = "orderbook_bench_" + std::to_string(getpid());
+  auto client = ShmClient::Create(name);
+  if (!client.has_value()) {
+    st.SkipWithError("cannot create /dev/shm channel");
+    return;
+  }
+
+  OrderBook ob;
+  ShmServer server{&ob};
+  if (!server.Attach(name).has_value()) {
+    st.SkipWithError("cannot attach to /dev/shm channel");
+    return;
+  }
+  std::atomic<bool> stop{false};
+  std::thread server_thread([&] { server.Run(stop); });
+
+  ShmResponse response{};
+  PerfRegion perf;
+  for (auto _ : st) {
+    while (!client->SubmitLimit(UserId{1}, OrderSide::kBuy, Price{100},
+                                Quantity{10}, TimeInForce::kGoodTillCancel)) {
+      std::this_thread::yield();
+    }
+    while (!client->PollResponse(response)) std::this_thread::yield();
+    while (!client->SubmitCancel(response.order_id)) {
+      std::this_thread::yield();
+    }
+    while (!client->PollResponse(response)) std::this_thread::yield();
+    benchmark::DoNotOptimize(response);
+  }
+
+  stop = true;
+  server_thread.join();
+  st.SetItemsProcessed(st.iterations() * 2);
+  perf.Report(st, static_cast<double>(st.iterations() * 2));
+}
+}  // namespace
+
+BENCHMARK(BM_ShmRoundTrip_LimitCancel)->UseRealTime();
+}  // namespace order_book_v1
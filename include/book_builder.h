@@ -0,0 +1,73 @@
+#ifndef INCLUDE_BOOK_BUILDER_H_
+#define INCLUDE_BOOK_BUILDER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <vector>
+
+#include "hash.h"
+#include "order.h"
+#include "order_message.h"
+#include "types.h"
+
+namespace order_book_v1 {
+// Consumer-side book rebuilt from the market-by-order feed. Levels, FIFO
+// position and order fields mirror the source OrderBook, so ToHash() agrees
+// with the source once both have seen the same events.
+//
+// No matching happens here, so the layout is tuned for applying messages:
+// live orders sit in a compact pool of recycled slots that each level links
+// through by index, and since OrderBook assigns ids sequentially the id to
+// slot lookup is a flat array rather than a hash map. The pool stays as small
+// as the live book; only the 4 byte lookup entries grow with the highest id.
+class BookBuilder : public OrderMessageSink {
+ public:
+  void OnOrderMessage(const OrderMessage& message) override { Apply(message); }
+
+  // Returns false if the message references an order the builder doesn't know
+  bool Apply(const OrderMessage& message);
+  void Reserve(std::size_t live_orders, std::size_t max_order_id);
+
+  std::optional<Price> BestBid() const;
+  std::optional<Price> BestAsk() const;
+  Quantity DepthAt(OrderSide side, Price price) const;
+  std::size_t OrderCount() const;
+  FixedWidth ToHash() const;
+
+ private:
+  static constexpr uint32_t kNil = UINT32_MAX;
+
+  struct LinkedLevel {
+    Quantity aggregate_qty{};
+    uint32_t head = kNil;
+    uint32_t tail = kNil;
+  };
+  using LinkedSide = std::map<Price, LinkedLevel>;
+
+  // Free slots are chained through next
+  struct Slot {
+    Order order;
+    LinkedLevel* level = nullptr;
+    uint32_t prev = kNil;
+    uint32_t next = kNil;
+  };
+
+  LinkedSide bids_;
+  LinkedSide asks_;
+  std::vector<Slot> slots_;
+  std::vector<uint32_t> slot_of_id_;
+  uint32_t free_head_ = kNil;
+  std::size_t order_count_ = 0;
+
+  void Add(const OrderMessage& message);
+  uint32_t Find(OrderId order_id) const;
+  bool RemoveQty(OrderId order_id, Quantity qty);
+  bool Delete(OrderId order_id);
+  void Erase(OrderId order_id, uint32_t index);
+  void HashSide(FixedWidth& seed, const LinkedSide& side) const;
+};
+}  // namespace order_book_v1
+
+#endif
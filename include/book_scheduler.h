@@ -0,0 +1,138 @@
+#ifndef INCLUDE_BOOK_SCHEDULER_H_
+#define INCLUDE_BOOK_SCHEDULER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "event_log.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+struct SchedulerConfig {
+  std::size_t threads = 1;
+  // A book is migrated when the busiest thread's event rate exceeds the least
+  // busy thread's by this factor
+  double imbalance_threshold = 1.5;
+  // How often the background rebalancer runs. 0 leaves rebalancing to
+  // explicit Rebalance() calls.
+  std::chrono::milliseconds rebalance_interval{0};
+  // Receives one line per completed migration. May be nullptr.
+  std::ostream* migration_log = nullptr;
+};
+
+struct MigrationRecord {
+  BookId book;
+  std::size_t from_thread;
+  std::size_t to_thread;
+  // Time the book was owned by neither thread. Events submitted meanwhile
+  // queue in the book's mailbox and are applied by the new owner.
+  std::chrono::nanoseconds pause;
+};
+
+// Runs many independent OrderBooks on a fixed pool of matching threads. Every
+// book has a FIFO mailbox and exactly one owning thread, so events for a book
+// are applied in submission order. Rebalance() measures per-book event rates
+// and moves a book from the busiest thread to the least busy one. The source
+// thread only gives a book up between mailbox drains and the destination
+// adopts it before touching its mailbox, so no event is dropped or reordered.
+class BookScheduler {
+ public:
+  BookScheduler(SchedulerConfig config);
+  ~BookScheduler();
+
+  BookScheduler(const BookScheduler&) = delete;
+  BookScheduler& operator=(const BookScheduler&) = delete;
+
+  // Books must be added before Start(). They are assigned round-robin.
+  BookId AddBook(std::ostream* log_dst = nullptr);
+  void Start();
+  void Stop();
+
+  // Thread-safe. Events from one producer keep their order per book.
+  void Submit(BookId book, const OrderBookEvent& event);
+  // Blocks until every submitted event has been applied
+  void Drain();
+
+  // Starts at most one migration and returns whether it did
+  bool Rebalance();
+  // Returns false if the book is already migrating or lives on that thread
+  bool Migrate(BookId book, std::size_t to_thread);
+
+  std::size_t OwnerOf(BookId book) const;
+  std::vector<MigrationRecord> migrations() const;
+  // Only safe to inspect once Drain() has returned and nothing is submitting
+  OrderBook& book(BookId book);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct BookSlot {
+    BookId id;
+    OrderBook book;
+    std::mutex mu;
+    std::vector<OrderBookEvent> mailbox;
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> processed{0};
+    std::atomic<std::size_t> owner{0};
+    std::atomic<bool> migrating{false};
+    // Read by the rebalancer only
+    uint64_t processed_mark = 0;
+  };
+
+  struct Release {
+    BookSlot* slot;
+    std::size_t to_thread;
+  };
+
+  struct Handoff {
+    BookSlot* slot;
+    std::size_t from_thread;
+    Clock::time_point released_at;
+  };
+
+  struct Worker {
+    std::thread thread;
+    std::mutex mu;
+    std::condition_variable cv;
+    bool signaled = false;
+    std::vector<Release> releases;
+    std::vector<Handoff> inbox;
+    // Touched only by the worker thread once started
+    std::vector<BookSlot*> books;
+  };
+
+  SchedulerConfig config_;
+  std::vector<std::unique_ptr<BookSlot>> slots_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<bool> stop_{false};
+  bool started_ = false;
+
+  std::mutex drain_mu_;
+  std::condition_variable drain_cv_;
+
+  std::mutex rebalance_mu_;
+  std::condition_variable rebalance_cv_;
+  std::thread rebalancer_;
+
+  mutable std::mutex log_mu_;
+  std::vector<MigrationRecord> migrations_;
+
+  void Signal(std::size_t worker);
+  void RunWorker(std::size_t index);
+  bool DrainMailbox(BookSlot& slot, std::vector<OrderBookEvent>& batch);
+  void RecordMigration(const MigrationRecord& record);
+  bool AllProcessed() const;
+  void RunRebalancer();
+};
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef INCLUDE_CONFLATING_PUBLISHER_H_
+#define INCLUDE_CONFLATING_PUBLISHER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "level_delta.h"
+
+namespace order_book_v1 {
+struct ConflationConfig {
+  // Publish after this many input events. 0 disables the event window.
+  std::size_t max_events = 0;
+  // Publish once the oldest buffered change is at least this old. 0 disables
+  // the time window.
+  std::chrono::nanoseconds max_delay{0};
+  // Distinct levels held before a publish is forced regardless of the windows
+  std::size_t capacity = 1024;
+};
+
+// Sits between an OrderBook and a slower subscriber. Level deltas are folded
+// into a buffer keyed by (side, price) and only the latest state of each level
+// is forwarded when a window closes, so publishing cost is bounded by the
+// number of distinct levels rather than the event rate. All storage is sized
+// in the constructor; buffering and publishing never allocate.
+class ConflatingPublisher : public LevelDeltaSink {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  ConflatingPublisher(LevelDeltaSink* downstream, ConflationConfig config);
+
+  void OnLevelDeltas(std::span<const LevelDelta> deltas) override;
+
+  // Publishes if the time window has elapsed. Call while the book is idle so
+  // buffered changes don't wait for the next event.
+  void Poll(Clock::time_point now);
+  void Flush();
+
+  // Intermediate level states that were overwritten before being published
+  uint64_t dropped_updates() const;
+  uint64_t published_updates() const;
+  uint64_t flushes() const;
+
+ private:
+  static constexpr uint32_t kEmpty = 0;
+
+  LevelDeltaSink* downstream_;
+  ConflationConfig config_;
+
+  // Open-addressed table of (pending index + 1), sized to a power of two at
+  // least twice the capacity so probes stay short
+  std::vector<uint32_t> table_;
+  std::size_t table_mask_;
+  std::vector<LevelDelta> pending_;
+  std::vector<uint32_t> pending_slots_;
+
+  std::size_t events_in_window_ = 0;
+  Clock::time_point window_start_{};
+
+  uint64_t dropped_updates_ = 0;
+  uint64_t published_updates_ = 0;
+  uint64_t flushes_ = 0;
+
+  void Buffer(const LevelDelta& delta);
+};
+}  // namespace order_book_v1
+
+#endif
@@ -1,9 +1,11 @@
 #ifndef INCLUDE_EVENT_LOG_H_
 #define INCLUDE_EVENT_LOG_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <optional>
 #include <ostream>
+#include <string_view>
 #include <variant>
 
 #include "types.h"
@@ -27,14 +29,64 @@ struct CancelOrderEvent {
   OrderId order_id;
 };
 
+struct ModifyOrderEvent {
+  OrderId order_id;
+  Quantity qty;
+  Price price;
+};
+
+// GTC limit that rests showing at most display_qty at a time
+struct AddIcebergOrderEvent {
+  UserId creator_id;
+  OrderSide side;
+  Quantity qty;
+  Price price;
+  Quantity display_qty;
+};
+
+// Waits outside the book until a trade reaches stop_price, then enters as a
+// market order or, with a limit_price, as a GTC limit
+struct AddStopOrderEvent {
+  UserId creator_id;
+  OrderSide side;
+  Quantity qty;
+  Price stop_price;
+  std::optional<Price> limit_price;
+};
+
+// Book-wide self-trade prevention mode from this event on
+struct SetSelfTradePreventionEvent {
+  SelfTradePrevention mode;
+};
+
+// Every resting order of one user, optionally only on one side
+struct CancelAllOrdersEvent {
+  UserId user_id;
+  std::optional<OrderSide> side;
+};
+
 using OrderBookEvent =
-    std::variant<AddLimitOrderEvent, AddMarketOrderEvent, CancelOrderEvent>;
+    std::variant<AddLimitOrderEvent, AddMarketOrderEvent, CancelOrderEvent,
+                 ModifyOrderEvent, CancelAllOrdersEvent, AddIcebergOrderEvent,
+                 AddStopOrderEvent, SetSelfTradePreventionEvent>;
 
 struct LoggedEvent {
   uint32_t event_seq;
   OrderBookEvent event;
 };
 
+// Longest line FormatEvent can produce, newline included: a 10-digit
+// sequence number, ADDICEBERG with four 10-digit fields, and separators
+constexpr std::size_t kMaxEventLineSize = 96;
+
+// Writes `record` as one journal line without the trailing newline and
+// returns its length. `out` must hold kMaxEventLineSize bytes.
+std::size_t FormatEvent(const LoggedEvent& record, char* out);
+
+// Parses one journal line as written by EventLog::AppendEvent. Returns nullopt
+// for blank or malformed lines, including INVALID_LIMIT_ORDER.
+std::optional<LoggedEvent> ParseEvent(std::string_view line);
+
 class EventLog {
  public:
   EventLog(std::ostream* dst);
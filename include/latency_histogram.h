@@ -0,0 +1,121 @@
+#ifndef INCLUDE_LATENCY_HISTOGRAM_H_
+#define INCLUDE_LATENCY_HISTOGRAM_H_
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace order_book_v1 {
+// Fixed-size log-linear histogram in the style of HdrHistogram. Each power of
+// two is split into kSubBuckets linear buckets, so any recorded value is
+// reported within 1/kSubBuckets (12.5%) of itself. Covers the full uint64
+// range in 4 KiB and never allocates.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+  static constexpr std::size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  void Record(uint64_t value) {
+    ++counts_[BucketOf(value)];
+    ++total_;
+    if (value > max_) max_ = value;
+  }
+
+  void Reset();
+  void Merge(const LatencyHistogram& other);
+
+  uint64_t count() const { return total_; }
+  uint64_t max() const { return max_; }
+  // Highest value that falls in the same bucket as the value at percentile p
+  // (0-100), capped at the recorded maximum. 0 when empty.
+  uint64_t ValueAtPercentile(double p) const;
+
+  static std::size_t BucketOf(uint64_t value) {
+    const int msb = std::bit_width(value | 1) - 1;
+    if (msb < kSubBucketBits) return value;
+    const int shift = msb - kSubBucketBits;
+    return (static_cast<std::size_t>(shift + 1) << kSubBucketBits) +
+           ((value >> shift) & (kSubBuckets - 1));
+  }
+  static uint64_t BucketUpperBound(std::size_t bucket);
+
+ private:
+  std::array<uint64_t, kBuckets> counts_{};
+  uint64_t total_ = 0;
+  uint64_t max_ = 0;
+};
+
+// One histogram per OrderBook entry point and outcome
+enum class LatencyKind : uint8_t {
+  kLimitRested = 0,  // No trades. Includes IOC orders that expired untraded.
+  kLimitFilled,
+  kLimitPartial,
+  kLimitRejected,
+  kMarketFilled,
+  kMarketPartial,
+  kMarketRejected,
+  kCancelHit,
+  kCancelMiss,
+  kModify,  // Any outcome, including trades from a crossing new price
+  kStop,    // Any outcome, including stops released by the stop's own trades
+  kCancelAll,  // Whole call, however many orders it cancels
+};
+
+constexpr std::size_t kLatencyKindCount = 12;
+std::string_view LatencyKindName(LatencyKind kind);
+
+// Values are TSC ticks (see TscClock)
+struct LatencySnapshot {
+  std::array<LatencyHistogram, kLatencyKindCount> histograms;
+
+  const LatencyHistogram& operator[](LatencyKind kind) const {
+    return histograms[static_cast<std::size_t>(kind)];
+  }
+};
+
+// Owns a LatencySnapshot on the heap so that an owner which never enables
+// recording pays for one null pointer. Copies are deep, keeping owners
+// copyable.
+class LatencyRecorder {
+ public:
+  LatencyRecorder() = default;
+  LatencyRecorder(const LatencyRecorder& other)
+      : histograms_(other.histograms_
+                        ? std::make_unique<LatencySnapshot>(*other.histograms_)
+                        : nullptr) {}
+  LatencyRecorder& operator=(const LatencyRecorder& other) {
+    if (this != &other) *this = LatencyRecorder(other);
+    return *this;
+  }
+  LatencyRecorder(LatencyRecorder&&) noexcept = default;
+  LatencyRecorder& operator=(LatencyRecorder&&) noexcept = default;
+
+  void Enable() {
+    if (!histograms_) histograms_ = std::make_unique<LatencySnapshot>();
+  }
+  // Must only be called once enabled
+  void Record(LatencyKind kind, uint64_t ticks) {
+    histograms_->histograms[static_cast<std::size_t>(kind)].Record(ticks);
+  }
+  LatencySnapshot Snapshot() const {
+    return histograms_ ? *histograms_ : LatencySnapshot{};
+  }
+  void Reset() {
+    if (!histograms_) return;
+    for (auto& histogram : histograms_->histograms) histogram.Reset();
+  }
+
+ private:
+  std::unique_ptr<LatencySnapshot> histograms_;
+};
+
+// True when the library was built with -DORDERBOOK_LATENCY_HISTOGRAMS=ON.
+// Otherwise OrderBook records nothing and snapshots are empty.
+bool LatencyHistogramsEnabled();
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef INCLUDE_LEVEL_DELTA_H_
+#define INCLUDE_LEVEL_DELTA_H_
+
+#include <span>
+
+#include "types.h"
+
+namespace order_book_v1 {
+// Market-by-price (L2) update for a single level. A removed level is reported
+// with an aggregate_qty of 0.
+struct LevelDelta {
+  OrderSide side;
+  Price price;
+  Quantity aggregate_qty;
+  bool removed;
+};
+
+// Receives the level changes caused by one input event (AddLimit, AddMarket or
+// Cancel). Each touched level appears at most once per call and carries its
+// final state after the event, so applying the deltas in order keeps a mirror
+// book in sync at a cost proportional to the number of changed levels.
+class LevelDeltaSink {
+ public:
+  virtual ~LevelDeltaSink() = default;
+  virtual void OnLevelDeltas(std::span<const LevelDelta> deltas) = 0;
+};
+}  // namespace order_book_v1
+
+#endif
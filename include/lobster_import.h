@@ -0,0 +1,112 @@
+#ifndef INCLUDE_LOBSTER_IMPORT_H_
+#define INCLUDE_LOBSTER_IMPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <string_view>
+#include <vector>
+
+#include "event_log.h"
+#include "types.h"
+
+namespace order_book_v1 {
+// Message types of a LOBSTER message file. Each line is
+//   time,type,order id,size,price,direction
+// with the price in units of 1/10000 and direction 1 for buy, -1 for sell.
+enum class LobsterMessageType : uint8_t {
+  kSubmit = 1,
+  kPartialCancel = 2,
+  kDelete = 3,
+  kExecuteVisible = 4,
+  kExecuteHidden = 5,
+  kCross = 6,
+  kHalt = 7,
+};
+
+struct LobsterImportStats {
+  uint64_t lines = 0;
+  uint64_t submits = 0;
+  uint64_t partial_cancels = 0;
+  uint64_t deletes = 0;
+  uint64_t executions = 0;
+  // Hidden executions, cross trades and halts, which name no resting order
+  uint64_t skipped_no_order = 0;
+  // Messages for orders that were resting before the file starts
+  uint64_t skipped_unknown_order = 0;
+  uint64_t malformed = 0;
+  uint64_t events_written = 0;
+};
+
+// Open-addressing map from external order ids to the state the importer
+// needs for them. Linear probing over one flat array, with backward-shift
+// deletion instead of tombstones, so a stream with millions of short-lived
+// orders never degrades and each entry costs 24 bytes at most half full.
+class ExternalOrderMap {
+ public:
+  struct Entry {
+    uint64_t external_id;
+    // 0 marks a free slot; the book numbers orders from 1
+    OrderId order_id;
+    Quantity remaining;
+    Price price;
+    OrderSide side;
+  };
+
+  ExternalOrderMap();
+
+  // nullptr if absent. Valid until the next Insert or Erase.
+  Entry* Find(uint64_t external_id);
+  // Replaces any entry with the same external id
+  void Insert(const Entry& entry);
+  void Erase(uint64_t external_id);
+
+  std::size_t size() const { return size_; }
+  std::size_t capacity() const { return slots_.size(); }
+
+ private:
+  std::size_t Home(uint64_t external_id) const;
+  void Grow();
+
+  std::vector<Entry> slots_;
+  std::size_t size_ = 0;
+  int shift_;
+};
+
+// Converts a LOBSTER message file into journal events, assuming the journal
+// is replayed on an empty book. Orders get the sequential ids that book will
+// assign, so the importer predicts them instead of running a book.
+//
+//   submit          ADDLIMIT GTC, user 0
+//   partial cancel  MODIFY down to the remainder, keeping queue position
+//   delete          CANCEL
+//   execute         ADDMARKET on the other side for the executed size
+//
+// Executions are replayed as market orders so the book does the matching.
+// They hit the named order as long as the replayed queue agrees with the
+// exchange's.
+class LobsterImporter {
+ public:
+  explicit LobsterImporter(EventLog& journal);
+
+  // Returns false if the line is malformed
+  bool ImportLine(std::string_view line);
+  // Reads `in` to the end in large blocks
+  void ImportStream(std::istream& in);
+
+  const LobsterImportStats& stats() const { return stats_; }
+  std::size_t open_orders() const { return orders_.size(); }
+
+ private:
+  void AppendAdd(const OrderBookEvent& event);
+  void AppendCancel(OrderId order_id);
+  void AppendModify(const ExternalOrderMap::Entry& entry);
+
+  EventLog& journal_;
+  ExternalOrderMap orders_;
+  Underlying next_order_id_ = 0;
+  LobsterImportStats stats_;
+};
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef INCLUDE_METRICS_H_
+#define INCLUDE_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected/expected.hpp>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace order_book_v1 {
+constexpr std::size_t kCacheLineSize = 64;
+// Indexed by RejectReason
+constexpr std::size_t kRejectReasonCount = 6;
+
+// Counter with exactly one writer at a time and any number of readers. The
+// writer updates it with a relaxed load and store instead of a locked
+// read-modify-write, so counting costs about as much as a plain increment.
+class MetricCounter {
+ public:
+  void Add(uint64_t n = 1) {
+    value_.store(value_.load(std::memory_order_relaxed) + n,
+                 std::memory_order_relaxed);
+  }
+  void Set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+  void SetMax(uint64_t value) {
+    if (value > value_.load(std::memory_order_relaxed)) Set(value);
+  }
+  uint64_t Load() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Counters for one OrderBook, updated only by the thread that currently runs
+// that book. Each block starts on its own cache line so the books of
+// different threads never share one.
+struct alignas(kCacheLineSize) BookMetrics {
+  MetricCounter limit_orders;
+  MetricCounter market_orders;
+  MetricCounter stop_orders;
+  MetricCounter fills;
+  MetricCounter cancels_hit;
+  MetricCounter cancels_miss;
+  // CancelAllForUser calls. The orders they take count as cancel hits.
+  MetricCounter mass_cancels;
+  MetricCounter modifies;
+  // Stop orders a trade released from waiting into matching
+  MetricCounter stops_triggered;
+  // Matches of a user against itself that the book declined
+  MetricCounter self_trades_prevented;
+  MetricCounter rejects[kRejectReasonCount];
+  MetricCounter levels_created;
+  MetricCounter levels_destroyed;
+  // Gauges, refreshed after every call into the book
+  MetricCounter resting_orders;
+  // Most price levels (both sides) resting at once
+  MetricCounter peak_levels;
+};
+
+// Plain copy of the counters summed over every registered book
+struct MetricsSnapshot {
+  uint64_t books = 0;
+  uint64_t limit_orders = 0;
+  uint64_t market_orders = 0;
+  uint64_t stop_orders = 0;
+  uint64_t fills = 0;
+  uint64_t cancels_hit = 0;
+  uint64_t cancels_miss = 0;
+  uint64_t mass_cancels = 0;
+  uint64_t modifies = 0;
+  uint64_t stops_triggered = 0;
+  uint64_t self_trades_prevented = 0;
+  uint64_t rejects[kRejectReasonCount] = {};
+  uint64_t levels_created = 0;
+  uint64_t levels_destroyed = 0;
+  uint64_t resting_orders = 0;
+  // Largest peak of any single book
+  uint64_t peak_levels = 0;
+
+  // Prometheus text exposition format, version 0.0.4
+  void WritePrometheus(std::ostream& os) const;
+};
+
+// Owns the BookMetrics blocks so they outlive any book pointing at them
+class MetricsRegistry {
+ public:
+  // Thread-safe. The returned block stays valid for the registry's lifetime.
+  BookMetrics& Register();
+  MetricsSnapshot Aggregate() const;
+
+ private:
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<BookMetrics>> blocks_;
+};
+
+enum class MetricsExportError : uint8_t {
+  kSocketFailed = 0,
+  kBindFailed,
+};
+
+struct MetricsExporterConfig {
+  std::chrono::milliseconds interval{1000};
+  // Rewritten every interval, via a temporary file and rename so readers
+  // never see a partial write. Empty disables the file.
+  std::string file_path;
+  // Unix domain socket answering every connection with an HTTP response
+  // holding the current metrics, e.g. for
+  //   curl --unix-socket <path> http://localhost/metrics
+  // Empty disables the endpoint.
+  std::string socket_path;
+};
+
+// Background thread that aggregates a registry and exports it
+class MetricsExporter {
+ public:
+  MetricsExporter(const MetricsRegistry& registry,
+                  MetricsExporterConfig config);
+  ~MetricsExporter();
+
+  MetricsExporter(const MetricsExporter&) = delete;
+  MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+  // Fails if the endpoint socket cannot be created or bound
+  tl::expected<void, MetricsExportError> Start();
+  // Writes the file one last time so it reflects the final counts
+  void Stop();
+
+ private:
+  void Run();
+  void WriteFile();
+  void ServeOne();
+
+  const MetricsRegistry& registry_;
+  MetricsExporterConfig config_;
+  int listen_fd_ = -1;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+};
+}  // namespace order_book_v1
+
+#endif
@@ -16,8 +16,15 @@ struct Order {
   std::optional<Price> price;
 
   std::optional<TimeInForce> tif;
+
+  // Iceberg orders only show up to display_qty in qty and keep the rest in
+  // hidden_qty. Both are 0 for ordinary orders.
+  Quantity display_qty{};
+  Quantity hidden_qty{};
 };
 
+// The hidden reserve is left out: it is never published, so a book rebuilt
+// from the market-by-order feed could not agree on it
 inline void HashOrder(FixedWidth& seed, Order const& order) {
   HashCombine(seed, order.id.v);
   HashCombine(seed, order.creator_id.v);
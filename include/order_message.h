@@ -0,0 +1,57 @@
+#ifndef INCLUDE_ORDER_MESSAGE_H_
+#define INCLUDE_ORDER_MESSAGE_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+
+#include "types.h"
+
+namespace order_book_v1 {
+enum class OrderMessageType : uint8_t {
+  kAdd = 0,  // Order rests in the book with qty at price
+  kExecute,  // Resting order was filled for qty at price
+  kReduce,   // Resting order had qty removed without trading
+  kDelete,   // Resting order was removed from the book
+};
+
+// Market-by-order (L3) message. The struct is its own wire format: every
+// message is exactly sizeof(OrderMessage) bytes in host byte order, so a feed
+// can be written and read back without any parsing.
+struct OrderMessage {
+  OrderMessageType type;
+  OrderSide side;
+  TimeInForce tif;
+  uint8_t reserved{};
+  OrderId order_id;
+  UserId user_id;
+  Price price;
+  Quantity qty;
+};
+
+static_assert(std::is_trivially_copyable_v<OrderMessage>);
+static_assert(sizeof(OrderMessage) == 20);
+
+class OrderMessageSink {
+ public:
+  virtual ~OrderMessageSink() = default;
+  virtual void OnOrderMessage(const OrderMessage& message) = 0;
+};
+
+// Writes each message as its fixed-size binary encoding.
+class BinaryOrderMessageWriter : public OrderMessageSink {
+ public:
+  BinaryOrderMessageWriter(std::ostream* dst);
+
+  void OnOrderMessage(const OrderMessage& message) override;
+
+ private:
+  std::ostream* dst_;
+};
+
+// Returns false once the stream no longer holds a complete message.
+bool ReadOrderMessage(std::istream& src, OrderMessage& message);
+}  // namespace order_book_v1
+
+#endif
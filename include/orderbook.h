@@ -1,9 +1,11 @@
 #ifndef INCLUDE_ORDERBOOK_H_
 #define INCLUDE_ORDERBOOK_H_
 
+#include <cstddef>
 #include <cstdint>
 #include <expected/expected.hpp>
 #include <iostream>
+#include <limits>
 #include <list>
 #include <map>
 #include <optional>
@@ -13,13 +15,23 @@
 
 #include "event_log.h"
 #include "hash.h"
+#include "latency_histogram.h"
+#include "level_delta.h"
+#include "metrics.h"
 #include "order.h"
+#include "order_message.h"
 #include "trade.h"
 #include "types.h"
 
 namespace order_book_v1 {
+constexpr uint32_t kNoDeltaSlot = std::numeric_limits<uint32_t>::max();
+
 struct Level {
   Quantity aggregate_qty{};
+  // Where this level's delta was last put in the pending batch. It is only
+  // trusted if the entry there is still for this level. A level that has
+  // never had a delta starts at kNoDeltaSlot.
+  uint32_t delta_slot = kNoDeltaSlot;
   std::list<Order> orders;
 };
 
@@ -28,6 +40,11 @@ struct Handle {
   using SideMap = std::map<Price, Level>;
   SideMap::iterator level_it;
   std::list<Order>::iterator order_it;
+  // Links in the owner's list of resting orders. user_pprev points at
+  // whatever points here (the previous order's user_next or the list head),
+  // so an order unlinks itself without looking its owner up.
+  Handle* user_next = nullptr;
+  Handle** user_pprev = nullptr;
 };
 
 enum class RejectReason : uint8_t {
@@ -35,6 +52,10 @@ enum class RejectReason : uint8_t {
   kBadQty,
   kOverflow,  // NOTE: Currently unused
   kEmptyBookForMarket,
+  // Fill-or-kill order the opposite side could not fill in full
+  kInsufficientLiquidity,
+  // Modify or transport cancel of an order that is not resting in the book
+  kUnknownOrder,
 };
 
 struct AddResultPayload {
@@ -42,15 +63,74 @@ struct AddResultPayload {
   OrderStatus status;
   std::vector<Trade> immediate_trades;
   Quantity remaining_qty;
+  // Trades of the stop orders this call released, in the order they happened
+  std::vector<Trade> triggered_trades;
+  // Self-trades the book declined, for this order and any stops it released
+  std::vector<PreventedTrade> prevented_trades;
 };
 
 using AddResult = tl::expected<AddResultPayload, RejectReason>;
 using BookSide = std::map<Price, Level>;
+using OrderIndex =
+    std::unordered_map<OrderId, Handle, StrongIdHash<OrderIdTag>>;
+// Head of each user's list of resting orders. An entry is erased when its
+// list empties, so the table only holds users with orders in the book.
+using UserIndex = std::unordered_map<UserId, Handle*, StrongIdHash<UserIdTag>>;
+
+// Hash of both sides of a book in price order. Shared by every structure that
+// mirrors an OrderBook so their states can be compared directly.
+FixedWidth HashBook(const BookSide& bids, const BookSide& asks);
+
+// Estimated heap footprint of a book. Node sizes follow libstdc++'s layouts
+// (map nodes carry a color and three links, list nodes two links, hash nodes
+// one link and no cached hash since StrongIdHash is noexcept) and each node
+// is rounded up to the chunk glibc malloc would hand out for it.
+struct BookMemoryStats {
+  std::size_t levels = 0;
+  std::size_t level_node_bytes = 0;
+  std::size_t orders = 0;
+  std::size_t order_node_bytes = 0;
+  std::size_t index_entries = 0;
+  std::size_t index_node_bytes = 0;
+  std::size_t index_buckets = 0;
+  std::size_t index_bucket_bytes = 0;
+  // Per-user list heads, nodes and buckets together
+  std::size_t user_index_bytes = 0;
+  // Stops waiting for their trigger: levels, nodes, index and per-user lists
+  // together
+  std::size_t stop_orders = 0;
+  std::size_t stop_bytes = 0;
+  // Reserved per-event scratch space (pending level deltas)
+  std::size_t scratch_bytes = 0;
+  // The book allocates every node individually; there are no pools or arenas
+  std::size_t pool_bytes = 0;
+
+  std::size_t total_bytes() const {
+    return level_node_bytes + order_node_bytes + index_node_bytes +
+           index_bucket_bytes + user_index_bytes + stop_bytes + scratch_bytes +
+           pool_bytes;
+  }
+  // 0 for an empty book
+  double bytes_per_order() const {
+    return orders == 0 ? 0.0
+                       : static_cast<double>(total_bytes()) /
+                             static_cast<double>(orders);
+  }
+};
+
+struct LevelSummary {
+  Price price;
+  Quantity qty;
+  std::size_t orders;
+};
 
 struct MatchResult {
   std::vector<Trade> trades;
   std::optional<Order> unfilled;
   bool filled_all;
+  std::vector<PreventedTrade> prevented;
+  // Self-trade prevention cancelled `unfilled`, so none of it may rest
+  bool taker_cancelled = false;
 };
 
 class OrderBook {
@@ -60,21 +140,90 @@ class OrderBook {
   // Postconditions: FIFO preserved, empty levels removed, no crossed book
   AddResult AddLimit(UserId user_id, OrderSide side, Price price, Quantity qty,
                      TimeInForce tif);
+  // GTC limit that shows at most `display_qty` at a time. On arrival it
+  // trades its whole quantity like any limit. Once resting, each time the
+  // shown slice fills the next one is taken from the hidden rest and the
+  // order moves to the back of its level. DepthAt, level deltas and the
+  // market-by-order feed only ever see the shown slice.
+  AddResult AddIceberg(UserId user_id, OrderSide side, Price price,
+                       Quantity qty, Quantity display_qty);
   // Postconditions: FIFO preserved, empty levels removed, no crossed book
   AddResult AddMarket(UserId user_id, OrderSide side, Quantity qty);
+  // Order that waits outside the book until a trade prints at or through
+  // `stop_price` (at or above it for a buy, at or below for a sell). It then
+  // enters under its own id as a market order, or as a GTC limit at
+  // `limit_price` if one is given. A stop that has already triggered when it
+  // arrives enters straight away. Stops released by a call are matched
+  // before it returns, best trigger price first and oldest first within a
+  // price, and their trades are reported in triggered_trades.
+  AddResult AddStop(UserId user_id, OrderSide side, Price stop_price,
+                    Quantity qty,
+                    std::optional<Price> limit_price = std::nullopt);
 
   // Cancelling an order is O(1) because the location of every order is stored
   // in the order_id_index_ class data member as a Handle. Cancelling an order
   // will not require shifting any elements because std::list is being used to
-  // store orders.
+  // store orders. Stops still waiting for their trigger are cancelled too.
   bool Cancel(OrderId order_id);
 
+  // Changes a resting order to `qty` open at `price`, keeping its id. At the
+  // same price a reduction is applied in place and keeps the order's queue
+  // position; an increase moves it to the back of its level. A new price
+  // takes the order out of its level and re-submits it there, so it can
+  // trade if it now crosses. The result reports any trades and what rests.
+  AddResult Modify(OrderId order_id, Quantity qty, Price price);
+
+  // Cancels every resting order of `user_id`, or only those on `side`, and
+  // returns how many went. Stops still waiting for their trigger go too, so
+  // nothing of theirs can trade afterwards. Walks that user's own orders and
+  // stops, so the cost is proportional to their count rather than to the
+  // size of the book.
+  std::size_t CancelAllForUser(UserId user_id,
+                               std::optional<OrderSide> side = std::nullopt);
+
+  // What to do when an order would trade against a resting order of the
+  // same user, from the next call on. kNone, the default, lets them trade.
+  // Whatever is prevented instead is listed in prevented_trades, and the
+  // resting side's cancels and decrements go out on the market-by-order
+  // feed as deletes and reduces. The change is journalled, so a replayed
+  // book prevents the same trades.
+  void SetSelfTradePrevention(SelfTradePrevention mode);
+
+  // Applies a journalled input event as if the matching call had been made
+  void Apply(const OrderBookEvent& event);
+
   std::optional<Price> BestBid() const;
   std::optional<Price> BestAsk() const;
+  // Id given to the most recent order, 0 before the first. Ids are handed out
+  // in order, so the next accepted order gets the one after it.
+  OrderId LastOrderId() const;
 
   Quantity DepthAt(OrderSide side, Price price) const;
+  // Up to `depth` levels of one side, best price first
+  std::vector<LevelSummary> TopLevels(OrderSide side, std::size_t depth) const;
+  // O(1): derived from container sizes, not by walking the book
+  BookMemoryStats MemoryStats() const;
   FixedWidth ToHash();
 
+  // Level deltas are coalesced per input event and delivered to the sink once
+  // the event has been fully applied. Passing nullptr disables the feed.
+  void SetLevelDeltaSink(LevelDeltaSink* sink);
+  // Market-by-order messages are delivered as soon as the matching path
+  // changes a resting order. Passing nullptr disables the feed.
+  void SetOrderMessageSink(OrderMessageSink* sink);
+
+  // Counters are updated after every call into the book. The block must
+  // outlive the book and have no other writer; copies of the book keep the
+  // pointer, so point a copy elsewhere before using both. Passing nullptr
+  // disables counting.
+  void SetMetrics(BookMetrics* metrics);
+
+  // Per-call latency of AddLimit, AddMarket and Cancel in TSC ticks, split by
+  // outcome. Only recorded when the library is built with
+  // ORDERBOOK_LATENCY_HISTOGRAMS; otherwise the snapshot is empty.
+  LatencySnapshot SnapshotLatency() const;
+  void ResetLatency();
+
   friend std::ostream& operator<<(std::ostream& os, const OrderBook& book) {
     os << "Book:";
     if (book.bids_.empty() && book.asks_.empty()) {
@@ -116,20 +265,97 @@ class OrderBook {
   uint32_t order_id_ = 0;
   uint32_t match_id_ = 0;
 
-  std::unordered_map<OrderId, Handle, StrongIdHash<OrderIdTag>> order_id_index_;
+  OrderIndex order_id_index_;
+  UserIndex user_orders_;
+
+  // Stops waiting for their trigger, keyed by stop price. They reuse the
+  // book's level and handle types, and their user links chain each user's
+  // waiting stops apart from their resting orders.
+  BookSide buy_stops_;
+  BookSide sell_stops_;
+  OrderIndex stop_index_;
+  UserIndex user_stops_;
+  // Price of the most recent trade, 0 until the first one
+  Price last_trade_price_{};
+  // Lowest and highest trade price since stops were last checked; the
+  // range is empty while print_high_ is 0
+  static constexpr Price kNoPrintLow{std::numeric_limits<Underlying>::max()};
+  Price print_low_ = kNoPrintLow;
+  Price print_high_{};
+
+  SelfTradePrevention self_trade_prevention_ = SelfTradePrevention::kNone;
+
+  // A non-zero display_qty makes the order an iceberg
+  AddResult AddLimitImpl(UserId user_id, OrderSide side, Price price,
+                         Quantity qty, TimeInForce tif,
+                         Quantity display_qty = Quantity{0});
+  AddResult AddMarketImpl(UserId user_id, OrderSide side, Quantity qty);
+  AddResult AddStopImpl(UserId user_id, OrderSide side, Price stop_price,
+                        Quantity qty, std::optional<Price> limit_price);
+  // Matching halves of AddLimitImpl and AddMarketImpl for an order that
+  // already has its id. Neither journals nor publishes level deltas, which
+  // the caller does once the whole input event has been applied.
+  AddResultPayload ExecuteLimit(const Order& order);
+  AddResult ExecuteMarket(const Order& order);
+  bool StopTriggered(OrderSide side, Price stop_price) const;
+  // Feeds every stop the prints since the last check have reached back
+  // through matching and adds what they did to `result`
+  void ReleaseTriggeredStops(AddResultPayload& result);
+  void RemoveStop(OrderIndex::iterator handle_it);
+  bool CancelImpl(OrderId order_id);
+  std::size_t CancelAllForUserImpl(UserId user_id,
+                                   std::optional<OrderSide> side);
+  AddResult ModifyImpl(OrderId order_id, Quantity qty, Price price);
+  // Read-only walk over the aggregate quantity of the levels that `side`
+  // would cross up to `limit`. Stops as soon as `qty` is covered. Hidden
+  // iceberg quantity is not counted, so the answer errs towards killing.
+  // With self-trade prevention on, levels are walked order by order so that
+  // `user_id`'s own orders are not counted.
+  bool CanFillCompletely(OrderSide side, Price limit, Quantity qty,
+                         UserId user_id) const;
 
   MatchResult Match(OrderSide side, Price best_value, const Order& order,
                     bool is_market);
   void Reduce(Level& level, Quantity& unfilled_qty, const Order& order,
-              std::vector<Trade>& trades);
+              MatchResult& result);
+  // Reduce's path when `order` meets a resting order of its own user
+  void PreventSelfTrade(Level& level, Quantity& unfilled_qty,
+                        const Order& order, MatchResult& result);
+  // The front order of `level` shows nothing more. An iceberg takes its next
+  // slice and moves to the back; anything else leaves the book.
+  void RetireFront(Level& level);
   void AddOrderToBook(OrderSide side, BookSide* book_side, Price value,
                       const Order& order);
+  // Takes a resting order out of its level and out of both indexes
+  void RemoveResting(OrderIndex::iterator handle_it);
+  // `user_id` owns the order; their list entry goes once it is empty
+  void EraseIndexEntry(OrderIndex::iterator handle_it, UserId user_id);
   void EmitLimitOrderEvent(const Order& order);
   void EmitMarketOrderEvent(const Order& order);
+  void EmitStopOrderEvent(const Order& order, Price stop_price);
   void EmitCancelEvent(OrderId order);
+  void EmitModifyEvent(OrderId order, Quantity qty, Price price);
+  void EmitCancelAllEvent(UserId user, std::optional<OrderSide> side);
+  void EmitSelfTradePreventionEvent(SelfTradePrevention mode);
+  void RecordLevelDelta(Level& level, OrderSide side, Price price);
+  void PublishLevelDeltas();
+  void EmitOrderMessage(OrderMessageType type, const Order& order,
+                        Quantity qty);
+  void CountAdd(MetricCounter& orders, const AddResult& result);
+  void CountLevelErased();
+  void RefreshGauges();
 
   EventLog log_;
 
+  LevelDeltaSink* delta_sink_ = nullptr;
+  std::vector<LevelDelta> pending_deltas_;
+  OrderMessageSink* order_sink_ = nullptr;
+  BookMetrics* metrics_ = nullptr;
+
+  // Only enabled when built with ORDERBOOK_LATENCY_HISTOGRAMS. Present either
+  // way so the book's layout does not depend on the option.
+  LatencyRecorder latency_;
+
 #ifndef NDEBUG
   // Only provided in debug builds. Used to verify invariants.
   void Verify() const;
@@ -0,0 +1,253 @@
+#ifndef INCLUDE_SHM_TRANSPORT_H_
+#define INCLUDE_SHM_TRANSPORT_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <expected/expected.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "order_message.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+// Order entry for processes on the same host. A client creates a channel file
+// under /dev/shm holding one request ring and one response ring; the server
+// maps the same file. Both rings are single-producer/single-consumer, so the
+// fast path on either side is a few loads and stores with no syscalls. All
+// waiting is polling; the server loop yields the CPU only while idle.
+
+enum class ShmRequestType : uint8_t { kLimit = 0, kMarket, kCancel, kIceberg };
+
+struct ShmRequest {
+  uint64_t client_seq;
+  ShmRequestType type;
+  OrderSide side;
+  TimeInForce tif;
+  uint8_t reserved{};
+  UserId user_id;
+  Price price;
+  Quantity qty;
+  OrderId order_id;      // Cancel target
+  Quantity display_qty;  // Iceberg slice size
+};
+
+enum class ShmResponseType : uint8_t {
+  kAck = 0,       // Order accepted, status and remaining qty are set
+  kReject,        // Order rejected, reason is set
+  kFill,          // One fill of the order, as taker or maker
+  kCancelAck,
+  kCancelReject,  // Unknown order or not owned by this channel
+};
+
+// `reason` is only meaningful for kReject, where it is the book's reject
+// reason, and kCancelReject, where it is kUnknownOrder. Other responses leave
+// it value-initialised and clients should not read it.
+struct ShmResponse {
+  uint64_t client_seq;  // Sequence of the request that placed the order
+  ShmResponseType type;
+  OrderStatus status;
+  RejectReason reason;
+  uint8_t reserved{};
+  OrderId order_id;
+  Price price;
+  Quantity qty;
+};
+
+static_assert(std::is_trivially_copyable_v<ShmRequest>);
+static_assert(std::is_trivially_copyable_v<ShmResponse>);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+constexpr std::size_t kShmRingCapacity = 1024;
+
+// Sequence counters sit on their own cache lines so producer and consumer
+// don't false-share.
+template <typename T>
+struct ShmRing {
+  alignas(64) std::atomic<uint64_t> write_seq;
+  alignas(64) std::atomic<uint64_t> read_seq;
+  alignas(64) std::array<T, kShmRingCapacity> slots;
+};
+
+struct ShmChannelLayout {
+  std::atomic<uint32_t> magic;
+  ShmRing<ShmRequest> requests;
+  ShmRing<ShmResponse> responses;
+};
+
+template <typename T>
+class ShmRingWriter {
+ public:
+  ShmRingWriter(ShmRing<T>* ring = nullptr)
+      : ring_(ring),
+        write_(ring ? ring->write_seq.load(std::memory_order_relaxed) : 0),
+        cached_read_(ring ? ring->read_seq.load(std::memory_order_acquire)
+                          : 0) {}
+
+  bool TryPush(const T& value) {
+    if (write_ - cached_read_ == kShmRingCapacity) {
+      cached_read_ = ring_->read_seq.load(std::memory_order_acquire);
+      if (write_ - cached_read_ == kShmRingCapacity) return false;
+    }
+    ring_->slots[write_ % kShmRingCapacity] = value;
+    ring_->write_seq.store(++write_, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  ShmRing<T>* ring_;
+  uint64_t write_;
+  uint64_t cached_read_;
+};
+
+template <typename T>
+class ShmRingReader {
+ public:
+  ShmRingReader(ShmRing<T>* ring = nullptr)
+      : ring_(ring),
+        read_(ring ? ring->read_seq.load(std::memory_order_relaxed) : 0),
+        cached_write_(read_) {}
+
+  bool TryPop(T& out) {
+    if (read_ == cached_write_) {
+      cached_write_ = ring_->write_seq.load(std::memory_order_acquire);
+      if (read_ == cached_write_) return false;
+    }
+    out = ring_->slots[read_ % kShmRingCapacity];
+    ring_->read_seq.store(++read_, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  ShmRing<T>* ring_;
+  uint64_t read_;
+  uint64_t cached_write_;
+};
+
+enum class ShmError : uint8_t {
+  kOpenFailed = 0,
+  kResizeFailed,
+  kMapFailed,
+  kBadLayout,
+};
+
+// Owns one mapping of a channel file. The creator unlinks the file when its
+// mapping is released; peers that still have it mapped are unaffected.
+class ShmMapping {
+ public:
+  static tl::expected<ShmMapping, ShmError> Create(std::string_view name);
+  static tl::expected<ShmMapping, ShmError> Open(std::string_view name);
+
+  ShmMapping() = default;
+  ShmMapping(ShmMapping&& other) noexcept;
+  ShmMapping& operator=(ShmMapping&& other) noexcept;
+  ShmMapping(const ShmMapping&) = delete;
+  ShmMapping& operator=(const ShmMapping&) = delete;
+  ~ShmMapping();
+
+  ShmChannelLayout* layout() const;
+
+ private:
+  ShmChannelLayout* layout_ = nullptr;
+  std::string path_;
+  bool owner_ = false;
+
+  void Release();
+};
+
+class ShmClient {
+ public:
+  // Creates /dev/shm/<name>. The server attaches to it afterwards.
+  static tl::expected<ShmClient, ShmError> Create(std::string_view name);
+
+  // Each returns the request's client sequence, or nullopt if the request
+  // ring is full
+  std::optional<uint64_t> SubmitLimit(UserId user_id, OrderSide side,
+                                      Price price, Quantity qty,
+                                      TimeInForce tif);
+  std::optional<uint64_t> SubmitMarket(UserId user_id, OrderSide side,
+                                       Quantity qty);
+  std::optional<uint64_t> SubmitCancel(OrderId order_id);
+  std::optional<uint64_t> SubmitIceberg(UserId user_id, OrderSide side,
+                                        Price price, Quantity qty,
+                                        Quantity display_qty);
+
+  bool PollResponse(ShmResponse& out);
+
+ private:
+  ShmMapping mapping_;
+  ShmRingWriter<ShmRequest> requests_;
+  ShmRingReader<ShmResponse> responses_;
+  uint64_t next_seq_ = 1;
+
+  std::optional<uint64_t> Submit(ShmRequest request);
+};
+
+// Drives an OrderBook from any number of client channels. The server installs
+// itself as the book's OrderMessageSink so fills against resting orders are
+// routed to the channel that placed them, an iceberg's later slices included.
+// Clients may only cancel their own
+// orders. A client that lets its response ring fill up is dropped rather than
+// waited on, so it cannot stall every other channel: the server stops reading
+// its requests and cancels its resting orders once the current request is
+// done.
+class ShmServer : public OrderMessageSink {
+ public:
+  ShmServer(OrderBook* book);
+
+  // Returns the channel index
+  tl::expected<std::size_t, ShmError> Attach(std::string_view name);
+
+  // Handles every request currently queued and returns how many there were
+  std::size_t PollOnce();
+  void Run(const std::atomic<bool>& stop);
+
+  void OnOrderMessage(const OrderMessage& message) override;
+
+ private:
+  struct Channel {
+    ShmMapping mapping;
+    ShmRingReader<ShmRequest> requests;
+    ShmRingWriter<ShmResponse> responses;
+    bool dropped = false;
+  };
+
+  struct RestingOrder {
+    std::size_t channel;
+    uint64_t client_seq;
+    Quantity remaining;
+  };
+
+  OrderBook* book_;
+  std::vector<Channel> channels_;
+  std::unordered_map<OrderId, RestingOrder, StrongIdHash<OrderIdTag>> resting_;
+
+  std::size_t current_channel_ = 0;
+  uint64_t current_seq_ = 0;
+  // Id the book will give the order the current request places, if it
+  // accepts it. Only that order is attributed to the current channel.
+  OrderId current_order_id_{};
+  // Order whose shown quantity just ran out. Its entry is kept until the
+  // next message shows whether an iceberg slice replaces it.
+  std::optional<OrderId> emptied_;
+  // Set when a channel is dropped mid-request, whose orders can only be
+  // cancelled once the book is done with that request
+  bool cancel_dropped_ = false;
+
+  void Handle(std::size_t channel, const ShmRequest& request);
+  void HandleAdd(std::size_t channel, const ShmRequest& request,
+                 const AddResult& result);
+  void Send(std::size_t channel, const ShmResponse& response);
+  void CancelDroppedOrders();
+  void EraseEmptied();
+};
+}  // namespace order_book_v1
+
+#endif
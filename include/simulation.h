@@ -0,0 +1,66 @@
+#ifndef INCLUDE_SIMULATION_H_
+#define INCLUDE_SIMULATION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "event_log.h"
+#include "split_mix.h"
+#include "types.h"
+
+namespace order_book_v1 {
+struct RandomFlowConfig {
+  Underlying min_price = 1;
+  Underlying max_price = 100;
+  Underlying min_qty = 1;
+  Underlying max_qty = 50;
+};
+
+// The simulator's event mix: 51% limits (80% GTC), 30% markets, the rest
+// cancels of recent adds. Order ids are predicted rather than read back from
+// a book, since OrderBook numbers every add that passes validation in order,
+// so the stream can be produced without running one.
+class RandomFlow {
+ public:
+  RandomFlow(const RandomFlowConfig& config, uint64_t seed);
+
+  OrderBookEvent Next();
+  // Id the book gives the most recent add that passes validation
+  OrderId predicted_order_id() const;
+
+ private:
+  // Recent resting candidates for cancels, capped so memory stays flat on
+  // unbounded runs
+  static constexpr std::size_t kMaxLive = 1 << 16;
+
+  RandomFlowConfig config_;
+  SplitMix64 rng_;
+  std::vector<OrderId> live_;
+  Underlying next_order_id_ = 0;
+};
+
+// Seed of book `book`'s stream. Neighbouring books get unrelated streams
+// even for neighbouring seeds.
+uint64_t BookSeed(uint64_t seed, std::size_t book);
+
+struct MultiBookConfig {
+  RandomFlowConfig flow{};
+  uint64_t seed = 0;
+  std::size_t threads = 1;
+  // Events generated for every book
+  uint64_t events_per_book = 0;
+  // Events per second summed over all books. 0 runs flat out.
+  uint32_t target_rate = 0;
+};
+
+// Generates one RandomFlow per segment, seeded with BookSeed, and writes each
+// stream to its own journal. Books are split across threads in fixed
+// batches, but nothing a book writes depends on which thread runs it or
+// when, so every segment is byte-identical for any thread count.
+void RunMultiBookSimulation(const MultiBookConfig& config,
+                            const std::vector<std::ostream*>& segments);
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef INCLUDE_SPLIT_MIX_H_
+#define INCLUDE_SPLIT_MIX_H_
+
+#include <cstdint>
+
+namespace order_book_v1 {
+// SplitMix64 generator. One add and three multiply/xor-shift steps per draw,
+// which keeps workload generation well below the cost of the engine calls it
+// feeds, where std::mt19937 plus uniform_int_distribution does not. Not for
+// anything that needs cryptographic quality.
+class SplitMix64 {
+ public:
+  explicit SplitMix64(uint64_t seed) : state_(seed) {}
+
+  uint64_t Next() {
+    uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in [lo, hi] by multiply-shift instead of a division. The bias is
+  // below range / 2^32, negligible for the ranges used here.
+  uint32_t Between(uint32_t lo, uint32_t hi) {
+    const uint64_t range = uint64_t{hi} - lo + 1;
+    return lo + static_cast<uint32_t>(((Next() >> 32) * range) >> 32);
+  }
+
+  // Uniform in [0, 1)
+  double NextDouble() {
+    return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+  }
+
+ private:
+  uint64_t state_;
+};
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef INCLUDE_TRACE_H_
+#define INCLUDE_TRACE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#include "tsc_clock.h"
+
+namespace order_book_v1 {
+// One completed span. Names must be string literals (or otherwise outlive the
+// tracer) because only the pointer is stored.
+struct TraceEvent {
+  const char* name;
+  uint64_t start;  // TSC ticks
+  uint64_t end;
+};
+
+// Fixed-capacity ring owned by one writer thread. Once full, new spans
+// overwrite the oldest, so a long run keeps its most recent history.
+class TraceRing {
+ public:
+  static constexpr std::size_t kCapacity = std::size_t{1} << 16;
+
+  explicit TraceRing(uint32_t tid) : tid_(tid) {}
+
+  void Push(const TraceEvent& event) {
+    events_[written_ % kCapacity] = event;
+    ++written_;
+  }
+  void Clear() { written_ = 0; }
+
+  uint32_t tid() const { return tid_; }
+  std::size_t size() const {
+    return written_ < kCapacity ? static_cast<std::size_t>(written_)
+                                : kCapacity;
+  }
+  uint64_t dropped() const {
+    return written_ < kCapacity ? 0 : written_ - kCapacity;
+  }
+  // i-th retained span, oldest first
+  const TraceEvent& at(std::size_t i) const {
+    return events_[(written_ - size() + i) % kCapacity];
+  }
+
+ private:
+  uint32_t tid_;
+  uint64_t written_ = 0;
+  std::array<TraceEvent, kCapacity> events_{};
+};
+
+// Process-wide switch and registry of per-thread rings. Each thread that
+// records gets its own ring on first use, so recording never takes a lock or
+// touches a shared cache line. Export reads every ring without
+// synchronization, so call it after Stop() once writers have finished.
+class Tracer {
+ public:
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+  static void Start() { enabled_.store(true, std::memory_order_relaxed); }
+  static void Stop() { enabled_.store(false, std::memory_order_relaxed); }
+
+  // Appends to the calling thread's ring whether or not tracing is enabled;
+  // TraceSpan does the enabled() check
+  static void Record(const char* name, uint64_t start, uint64_t end);
+  // Discards every recorded span. Rings stay registered.
+  static void Clear();
+
+  // Writes every retained span in Chrome trace event format ("X" complete
+  // events, microsecond timestamps relative to the earliest span). Load the
+  // file in Perfetto or chrome://tracing.
+  static void WriteChromeTrace(std::ostream& os);
+
+ private:
+  inline static std::atomic<bool> enabled_{false};
+};
+
+// Times its own scope into the calling thread's ring. When tracing is off the
+// constructor costs one load and a predictable branch.
+class TraceSpan {
+ public:
+  explicit TraceSpan(const char* name)
+      : name_(name), start_(Tracer::enabled() ? TscClock::Now() : 0) {}
+  ~TraceSpan() {
+    if (start_ != 0) Tracer::Record(name_, start_, TscClock::Now());
+  }
+
+  TraceSpan(const TraceSpan&) = delete;
+  TraceSpan& operator=(const TraceSpan&) = delete;
+
+ private:
+  const char* name_;
+  uint64_t start_;
+};
+}  // namespace order_book_v1
+
+// Spans are only compiled in when the ORDERBOOK_TRACING option is on
+#define ORDERBOOK_TRACE_CONCAT_INNER(a, b) a##b
+#define ORDERBOOK_TRACE_CONCAT(a, b) ORDERBOOK_TRACE_CONCAT_INNER(a, b)
+#ifdef ORDERBOOK_TRACING
+#define ORDERBOOK_TRACE_SPAN(name) \
+  ::order_book_v1::TraceSpan ORDERBOOK_TRACE_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define ORDERBOOK_TRACE_SPAN(name) static_cast<void>(0)
+#endif
+
+#endif
@@ -13,6 +13,18 @@ struct Trade {
   Quantity qty;
   Price price;
 };
+
+// A match the book declined because both orders belonged to the same user.
+// qty is what would have traded; `action` says what was done instead.
+struct PreventedTrade {
+  UserId user_id;
+  OrderId order_id;
+  OrderId resting_order_id;
+
+  Quantity qty;
+  Price price;
+  SelfTradePrevention action;
+};
 }  // namespace order_book_v1
 
 #endif
@@ -0,0 +1,47 @@
+#ifndef INCLUDE_TSC_CLOCK_H_
+#define INCLUDE_TSC_CLOCK_H_
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace order_book_v1 {
+// Cycle counter for timing single operations. Reading the TSC costs a few
+// nanoseconds, where steady_clock goes through the vDSO and costs several
+// times that. Ticks are converted to nanoseconds with a rate calibrated
+// against steady_clock. Non-x86 targets fall back to steady_clock, in which
+// case a tick is a nanosecond.
+class TscClock {
+ public:
+  static uint64_t Now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+#endif
+  }
+
+  // Spins for `window` and returns the measured ticks per nanosecond
+  static double Calibrate(
+      std::chrono::milliseconds window = std::chrono::milliseconds(50)) {
+    auto wall_start = std::chrono::steady_clock::now();
+    uint64_t tsc_start = Now();
+    while (std::chrono::steady_clock::now() - wall_start < window) {
+    }
+    uint64_t tsc_end = Now();
+    auto wall_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - wall_start)
+                       .count();
+    return static_cast<double>(tsc_end - tsc_start) /
+           static_cast<double>(wall_ns);
+  }
+};
+}  // namespace order_book_v1
+
+#endif
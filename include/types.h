@@ -11,12 +11,26 @@ enum class EventType : uint8_t { kLimit = 0, kMarket, kCancel };
 enum class OrderSide : uint8_t { kBuy = 0, kSell };
 std::ostream& operator<<(std::ostream& os, OrderSide const side);
 
-enum class TimeInForce {
+enum class TimeInForce : uint8_t {
   kGoodTillCancel = 0,
   kImmediateOrCancel,
+  // Fills completely on arrival or is rejected without touching the book
+  kFillOrKill,
 };
 std::ostream& operator<<(std::ostream& os, TimeInForce const tif);
 
+// What a book does instead of matching an order against a resting order of
+// the same user
+enum class SelfTradePrevention : uint8_t {
+  kNone = 0,      // They trade like any other pair
+  kCancelNewest,  // Cancel the rest of the incoming order
+  kCancelOldest,  // Cancel the resting order and keep matching
+  kCancelBoth,
+  // Take the smaller open quantity off both without trading
+  kDecrement,
+};
+std::ostream& operator<<(std::ostream& os, SelfTradePrevention const mode);
+
 using Underlying = uint32_t;
 
 template <class Tag>
@@ -39,17 +53,19 @@ struct StrongIdHash {
 struct OrderIdTag {};
 struct MatchIdTag {};
 struct UserIdTag {};
+struct BookIdTag {};
 
 using OrderId = StrongId<OrderIdTag>;
 using MatchId = StrongId<MatchIdTag>;
 using UserId = StrongId<UserIdTag>;
+using BookId = StrongId<BookIdTag>;
 
 template <class Tag>
 struct StrongNum {
   Underlying v{};
 
   friend constexpr StrongNum operator+(StrongNum a, StrongNum b) {
-    return a.v + b.v;
+    return StrongNum{a.v + b.v};
   }
 
   friend constexpr StrongNum operator+=(StrongNum& a, StrongNum b) {
@@ -0,0 +1,138 @@
+#ifndef INCLUDE_WORKLOAD_H_
+#define INCLUDE_WORKLOAD_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "event_log.h"
+#include "order_message.h"
+#include "orderbook.h"
+#include "split_mix.h"
+#include "types.h"
+
+namespace order_book_v1 {
+// Shape of the generated order flow. The defaults aim at a busy lit venue:
+// passive adds clustered a few ticks off a drifting mid, over 90% of them
+// cancelled before they trade, heavy-tailed sizes, a few very active users
+// and arrivals that come in bursts.
+struct WorkloadConfig {
+  uint64_t seed = 42;
+
+  // Share of events that are market orders
+  double market_share = 0.01;
+  // The rest are limit adds or cancels. A cancel is drawn with probability
+  // live / (live + target_resting), as if every resting order were cancelled
+  // at the same constant rate, so the book settles around target_resting
+  // orders. With the defaults about 92% of the orders that rest are
+  // cancelled; the rest are filled.
+  std::size_t target_resting = 5'000;
+  // Share of limit orders sent as IOC
+  double ioc_share = 0.05;
+
+  // The mid starts here and moves one tick up or down with this probability
+  // after each event
+  Underlying initial_mid = 100'000;
+  double mid_step_probability = 0.0005;
+  // Limit prices sit 1 + X ticks from the mid on the order's own side, X
+  // exponential with this mean, so most orders rest at or near the inside.
+  double price_offset_mean = 4.0;
+
+  // Sizes are Pareto: min_qty * U^(-1/size_alpha), capped at max_qty
+  Underlying min_qty = 1;
+  Underlying max_qty = 10'000;
+  double size_alpha = 1.5;
+
+  // Users 1..user_count, user k drawn with probability proportional to
+  // 1 / k^user_zipf_exponent
+  uint32_t user_count = 10'000;
+  double user_zipf_exponent = 1.1;
+
+  // Arrival times follow a Hawkes process with an exponential kernel: the
+  // intensity is base_rate plus a jump of branching_ratio * decay_rate per
+  // event, decaying at decay_rate per second. branching_ratio is the mean
+  // number of events each event triggers and is clamped below 1, so the
+  // long-run rate is base_rate / (1 - branching_ratio).
+  double base_rate = 20'000;
+  double branching_ratio = 0.8;
+  double decay_rate = 100'000;
+};
+
+struct WorkloadEvent {
+  // Nanoseconds since the start of the stream
+  uint64_t time_ns;
+  OrderBookEvent event;
+};
+
+struct WorkloadStats {
+  uint64_t limits = 0;
+  uint64_t markets = 0;
+  uint64_t cancels = 0;
+  // Limit orders that rested at least partly
+  uint64_t rested = 0;
+};
+
+// Generates an endless, seed-deterministic event stream. A private OrderBook
+// replays every event it emits and its market-by-order feed tracks which
+// orders still rest, so every cancel targets a live order anywhere in the
+// book rather than only recent ones.
+class WorkloadGenerator {
+ public:
+  explicit WorkloadGenerator(const WorkloadConfig& config);
+
+  // The book holds a pointer back into the generator
+  WorkloadGenerator(const WorkloadGenerator&) = delete;
+  WorkloadGenerator& operator=(const WorkloadGenerator&) = delete;
+
+  WorkloadEvent Next();
+
+  const WorkloadStats& stats() const { return stats_; }
+  std::size_t live_orders() const { return live_.size(); }
+  Underlying mid() const { return mid_; }
+
+ private:
+  class LiveTracker : public OrderMessageSink {
+   public:
+    explicit LiveTracker(WorkloadGenerator& generator)
+        : generator_(generator) {}
+    void OnOrderMessage(const OrderMessage& message) override;
+
+   private:
+    WorkloadGenerator& generator_;
+  };
+
+  struct LiveOrder {
+    // Position in live_
+    std::size_t slot;
+    Quantity remaining;
+  };
+
+  Quantity DrawQty();
+  UserId DrawUser();
+  Price DrawPrice(OrderSide side);
+  uint64_t DrawArrival();
+  void AddLive(OrderId order_id, Quantity qty);
+  void RemoveLive(OrderId order_id);
+
+  WorkloadConfig config_;
+  SplitMix64 rng_;
+  LiveTracker tracker_;
+  OrderBook book_;
+  // Cumulative Zipf weights, normalized to end at 1
+  std::vector<double> user_cdf_;
+  std::vector<OrderId> live_;
+  std::unordered_map<OrderId, LiveOrder, StrongIdHash<OrderIdTag>> live_index_;
+  Underlying mid_;
+  double time_s_ = 0;
+  // Intensity above base_rate at time_s_
+  double excitation_ = 0;
+  WorkloadStats stats_;
+};
+
+// First `count` events of the stream for `config`
+std::vector<OrderBookEvent> GenerateWorkload(const WorkloadConfig& config,
+                                             std::size_t count);
+}  // namespace order_book_v1
+
+#endif
@@ -0,0 +1,153 @@
+#include "../include/book_builder.h"
+
+namespace order_book_v1 {
+bool BookBuilder::Apply(const OrderMessage& message) {
+  switch (message.type) {
+    case OrderMessageType::kAdd:
+      Add(message);
+      return true;
+    case OrderMessageType::kExecute:
+    case OrderMessageType::kReduce:
+      return RemoveQty(message.order_id, message.qty);
+    case OrderMessageType::kDelete:
+      return Delete(message.order_id);
+  }
+  return false;
+}
+
+void BookBuilder::Reserve(std::size_t live_orders, std::size_t max_order_id) {
+  slots_.reserve(live_orders);
+  slot_of_id_.reserve(max_order_id + 1);
+}
+
+void BookBuilder::Add(const OrderMessage& message) {
+  LinkedSide& book_side = message.side == OrderSide::kBuy ? bids_ : asks_;
+  LinkedLevel& level = book_side.try_emplace(message.price).first->second;
+
+  uint32_t index = free_head_;
+  if (index == kNil) {
+    index = static_cast<uint32_t>(slots_.size());
+    slots_.emplace_back();
+  } else {
+    free_head_ = slots_[index].next;
+  }
+  slots_[index] = Slot{
+      .order =
+          Order{
+              .id = message.order_id,
+              .creator_id = message.user_id,
+              .side = message.side,
+              .qty = message.qty,
+              .price = message.price,
+              .tif = message.tif,
+          },
+      .level = &level,
+      .prev = level.tail,
+      .next = kNil,
+  };
+
+  if (level.tail == kNil) {
+    level.head = index;
+  } else {
+    slots_[level.tail].next = index;
+  }
+  level.tail = index;
+  level.aggregate_qty += message.qty;
+
+  if (message.order_id.v >= slot_of_id_.size()) {
+    slot_of_id_.resize(message.order_id.v + 1, kNil);
+  }
+  slot_of_id_[message.order_id.v] = index;
+  ++order_count_;
+}
+
+uint32_t BookBuilder::Find(OrderId order_id) const {
+  if (order_id.v >= slot_of_id_.size()) return kNil;
+  return slot_of_id_[order_id.v];
+}
+
+bool BookBuilder::RemoveQty(OrderId order_id, Quantity qty) {
+  uint32_t index = Find(order_id);
+  if (index == kNil) return false;
+
+  Slot& slot = slots_[index];
+  slot.order.qty -= qty;
+  slot.level->aggregate_qty -= qty;
+  if (slot.order.qty == Quantity{0}) {
+    Erase(order_id, index);
+  }
+  return true;
+}
+
+bool BookBuilder::Delete(OrderId order_id) {
+  uint32_t index = Find(order_id);
+  if (index == kNil) return false;
+
+  Slot& slot = slots_[index];
+  slot.level->aggregate_qty -= slot.order.qty;
+  Erase(order_id, index);
+  return true;
+}
+
+void BookBuilder::Erase(OrderId order_id, uint32_t index) {
+  Slot& slot = slots_[index];
+  LinkedLevel& level = *slot.level;
+  if (slot.prev == kNil) {
+    level.head = slot.next;
+  } else {
+    slots_[slot.prev].next = slot.next;
+  }
+  if (slot.next == kNil) {
+    level.tail = slot.prev;
+  } else {
+    slots_[slot.next].prev = slot.prev;
+  }
+
+  if (level.head == kNil) {
+    LinkedSide& book_side = slot.order.side == OrderSide::kBuy ? bids_ : asks_;
+    book_side.erase(slot.order.price.value());
+  }
+
+  slot.level = nullptr;
+  slot.next = free_head_;
+  free_head_ = index;
+  slot_of_id_[order_id.v] = kNil;
+  --order_count_;
+}
+
+std::optional<Price> BookBuilder::BestBid() const {
+  if (bids_.empty()) return std::nullopt;
+  return bids_.rbegin()->first;
+}
+
+std::optional<Price> BookBuilder::BestAsk() const {
+  if (asks_.empty()) return std::nullopt;
+  return asks_.begin()->first;
+}
+
+Quantity BookBuilder::DepthAt(OrderSide side, Price price) const {
+  const LinkedSide& book_side = side == OrderSide::kBuy ? bids_ : asks_;
+  auto it = book_side.find(price);
+  if (it == book_side.end()) return Quantity{0};
+  return it->second.aggregate_qty;
+}
+
+std::size_t BookBuilder::OrderCount() const { return order_count_; }
+
+// Must visit orders in the same sequence as HashBook does for an OrderBook
+void BookBuilder::HashSide(FixedWidth& seed, const LinkedSide& side) const {
+  for (const auto& [price, level] : side) {
+    for (uint32_t i = level.head; i != kNil; i = slots_[i].next) {
+      HashOrder(seed, slots_[i].order);
+    }
+    HashCombine(seed, level.aggregate_qty.v);
+  }
+}
+
+FixedWidth BookBuilder::ToHash() const {
+  FixedWidth seed = HASH_SEED;
+  HashSide(seed, bids_);
+  HashSide(seed, asks_);
+  return seed;
+}
+}  // namespace order_book_v1
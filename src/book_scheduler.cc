@@ -0,0 +1,291 @@
+#include "../include/book_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace order_book_v1 {
+BookScheduler::BookScheduler(SchedulerConfig config) : config_(config) {
+  config_.threads = std::max<std::size_t>(config_.threads, 1);
+  for (std::size_t i = 0; i < config_.threads; ++i) {
+    workers_.emplace_back(std::make_unique<Worker>());
+  }
+}
+
+BookScheduler::~BookScheduler() { Stop(); }
+
+BookId BookScheduler::AddBook(std::ostream* log_dst) {
+  auto slot = std::make_unique<BookSlot>();
+  slot->id = BookId{static_cast<Underlying>(slots_.size())};
+  slot->book = OrderBook(log_dst);
+  slots_.emplace_back(std::move(slot));
+  return slots_.back()->id;
+}
+
+void BookScheduler::Start() {
+  if (started_) return;
+  started_ = true;
+  stop_ = false;
+
+  for (auto& worker : workers_) {
+    worker->books.clear();
+    worker->releases.clear();
+    worker->inbox.clear();
+    worker->signaled = false;
+  }
+  for (std::size_t i = 0; i < slots_.size(); ++i) {
+    std::size_t owner = i % workers_.size();
+    slots_[i]->owner = owner;
+    slots_[i]->migrating = false;
+    workers_[owner]->books.emplace_back(slots_[i].get());
+  }
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->thread = std::thread([this, i] { RunWorker(i); });
+  }
+  if (config_.rebalance_interval.count() > 0) {
+    rebalancer_ = std::thread([this] { RunRebalancer(); });
+  }
+}
+
+void BookScheduler::Stop() {
+  if (!started_) return;
+  stop_ = true;
+
+  for (auto& worker : workers_) {
+    {
+      std::lock_guard lock(worker->mu);
+    }
+    worker->cv.notify_one();
+  }
+  {
+    std::lock_guard lock(rebalance_mu_);
+  }
+  rebalance_cv_.notify_one();
+
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) worker->thread.join();
+  }
+  if (rebalancer_.joinable()) rebalancer_.join();
+  started_ = false;
+}
+
+void BookScheduler::Signal(std::size_t worker_index) {
+  Worker& worker = *workers_[worker_index];
+  {
+    std::lock_guard lock(worker.mu);
+    worker.signaled = true;
+  }
+  worker.cv.notify_one();
+}
+
+void BookScheduler::Submit(BookId book, const OrderBookEvent& event) {
+  BookSlot& slot = *slots_[book.v];
+  bool was_empty = false;
+  {
+    std::lock_guard lock(slot.mu);
+    was_empty = slot.mailbox.empty();
+    slot.mailbox.emplace_back(event);
+    slot.submitted.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // A non-empty mailbox already has a wakeup outstanding. If the book is
+  // mid-migration the new owner drains it on adoption regardless.
+  if (was_empty) Signal(slot.owner.load());
+}
+
+bool BookScheduler::DrainMailbox(BookSlot& slot,
+                                 std::vector<OrderBookEvent>& batch) {
+  {
+    std::lock_guard lock(slot.mu);
+    if (slot.mailbox.empty()) return false;
+    batch.swap(slot.mailbox);
+  }
+
+  for (const auto& event : batch) {
+    slot.book.Apply(event);
+  }
+  slot.processed.fetch_add(batch.size(), std::memory_order_release);
+  batch.clear();
+  return true;
+}
+
+void BookScheduler::RunWorker(std::size_t index) {
+  Worker& worker = *workers_[index];
+  std::vector<Release> releases;
+  std::vector<Handoff> inbox;
+  std::vector<OrderBookEvent> batch;
+
+  while (true) {
+    {
+      std::unique_lock lock(worker.mu);
+      worker.cv.wait(lock, [&] {
+        return worker.signaled || stop_ || !worker.releases.empty() ||
+               !worker.inbox.empty();
+      });
+      if (stop_) break;
+      worker.signaled = false;
+      releases.swap(worker.releases);
+      inbox.swap(worker.inbox);
+    }
+
+    // Quiescent point: this thread is not inside any book, so releasing one
+    // here cannot split a mailbox drain across two threads.
+    for (const auto& release : releases) {
+      auto it = std::find(worker.books.begin(), worker.books.end(),
+                          release.slot);
+      if (it == worker.books.end()) continue;
+      worker.books.erase(it);
+
+      Worker& dst = *workers_[release.to_thread];
+      {
+        std::lock_guard lock(dst.mu);
+        dst.inbox.emplace_back(Handoff{.slot = release.slot,
+                                       .from_thread = index,
+                                       .released_at = Clock::now()});
+      }
+      dst.cv.notify_one();
+    }
+    releases.clear();
+
+    for (const auto& handoff : inbox) {
+      worker.books.emplace_back(handoff.slot);
+      handoff.slot->owner = index;
+      auto pause = Clock::now() - handoff.released_at;
+      handoff.slot->migrating = false;
+      RecordMigration(MigrationRecord{
+          .book = handoff.slot->id,
+          .from_thread = handoff.from_thread,
+          .to_thread = index,
+          .pause =
+              std::chrono::duration_cast<std::chrono::nanoseconds>(pause),
+      });
+    }
+    inbox.clear();
+
+    bool progressed = false;
+    for (BookSlot* slot : worker.books) {
+      progressed |= DrainMailbox(*slot, batch);
+    }
+    if (progressed) {
+      {
+        std::lock_guard lock(drain_mu_);
+      }
+      drain_cv_.notify_all();
+    }
+  }
+}
+
+bool BookScheduler::AllProcessed() const {
+  for (const auto& slot : slots_) {
+    if (slot->processed.load(std::memory_order_acquire) !=
+        slot->submitted.load(std::memory_order_relaxed)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void BookScheduler::Drain() {
+  std::unique_lock lock(drain_mu_);
+  drain_cv_.wait(lock, [this] { return AllProcessed(); });
+}
+
+bool BookScheduler::Migrate(BookId book, std::size_t to_thread) {
+  if (book.v >= slots_.size() || to_thread >= workers_.size()) return false;
+  BookSlot& slot = *slots_[book.v];
+  if (slot.migrating.exchange(true)) return false;
+
+  std::size_t from = slot.owner.load();
+  if (from == to_thread) {
+    slot.migrating = false;
+    return false;
+  }
+
+  Worker& src = *workers_[from];
+  {
+    std::lock_guard lock(src.mu);
+    src.releases.emplace_back(Release{.slot = &slot, .to_thread = to_thread});
+  }
+  src.cv.notify_one();
+  return true;
+}
+
+bool BookScheduler::Rebalance() {
+  std::lock_guard lock(rebalance_mu_);
+
+  // Events applied per book since the previous call. The interval is the
+  // same for every book, so counts compare directly as rates.
+  std::vector<uint64_t> rates(slots_.size());
+  std::vector<uint64_t> loads(workers_.size());
+  for (std::size_t i = 0; i < slots_.size(); ++i) {
+    BookSlot& slot = *slots_[i];
+    uint64_t processed = slot.processed.load(std::memory_order_relaxed);
+    rates[i] = processed - slot.processed_mark;
+    slot.processed_mark = processed;
+    loads[slot.owner.load()] += rates[i];
+  }
+
+  auto [min_it, max_it] = std::minmax_element(loads.begin(), loads.end());
+  std::size_t busiest = static_cast<std::size_t>(max_it - loads.begin());
+  std::size_t idlest = static_cast<std::size_t>(min_it - loads.begin());
+  if (busiest == idlest ||
+      static_cast<double>(*max_it) <=
+          config_.imbalance_threshold * static_cast<double>(*min_it)) {
+    return false;
+  }
+
+  // Move the book whose rate best halves the gap. A book carrying the whole
+  // gap would only swap which thread is overloaded.
+  const uint64_t gap = *max_it - *min_it;
+  std::size_t candidate = slots_.size();
+  double best_distance = 0;
+  for (std::size_t i = 0; i < slots_.size(); ++i) {
+    const BookSlot& slot = *slots_[i];
+    if (slot.owner.load() != busiest || slot.migrating.load()) continue;
+    if (rates[i] == 0 || rates[i] >= gap) continue;
+    double distance = std::abs(static_cast<double>(rates[i]) -
+                               static_cast<double>(gap) / 2);
+    if (candidate == slots_.size() || distance < best_distance) {
+      candidate = i;
+      best_distance = distance;
+    }
+  }
+  if (candidate == slots_.size()) return false;
+
+  return Migrate(slots_[candidate]->id, idlest);
+}
+
+void BookScheduler::RunRebalancer() {
+  while (true) {
+    {
+      std::unique_lock lock(rebalance_mu_);
+      rebalance_cv_.wait_for(lock, config_.rebalance_interval,
+                             [this] { return stop_.load(); });
+      if (stop_) return;
+    }
+    Rebalance();
+  }
+}
+
+void BookScheduler::RecordMigration(const MigrationRecord& record) {
+  std::lock_guard lock(log_mu_);
+  migrations_.emplace_back(record);
+  if (config_.migration_log != nullptr) {
+    *config_.migration_log << "MIGRATE book=" << record.book
+                           << " from=" << record.from_thread
+                           << " to=" << record.to_thread
+                           << " pause_ns=" << record.pause.count() << "\n";
+  }
+}
+
+std::size_t BookScheduler::OwnerOf(BookId book) const {
+  return slots_[book.v]->owner.load();
+}
+
+std::vector<MigrationRecord> BookScheduler::migrations() const {
+  std::lock_guard lock(log_mu_);
+  return migrations_;
+}
+
+OrderBook& BookScheduler::book(BookId book) { return slots_[book.v]->book; }
+}  // namespace order_book_v1
@@ -0,0 +1,101 @@
+#include "../include/conflating_publisher.h"
+
+#include <algorithm>
+
+namespace order_book_v1 {
+namespace {
+std::size_t TableSizeFor(std::size_t capacity) {
+  std::size_t size = 16;
+  while (size < capacity * 2) size <<= 1;
+  return size;
+}
+}  // namespace
+
+ConflatingPublisher::ConflatingPublisher(LevelDeltaSink* downstream,
+                                         ConflationConfig config)
+    : downstream_(downstream),
+      config_(config),
+      table_(TableSizeFor(std::max<std::size_t>(config.capacity, 1)), kEmpty),
+      table_mask_(table_.size() - 1) {
+  config_.capacity = std::max<std::size_t>(config_.capacity, 1);
+  pending_.reserve(config_.capacity);
+  pending_slots_.reserve(config_.capacity);
+}
+
+void ConflatingPublisher::Buffer(const LevelDelta& delta) {
+  std::size_t slot =
+      (static_cast<std::size_t>(delta.price.v) * 2 +
+       static_cast<std::size_t>(delta.side)) *
+          0x9E3779B97F4A7C15ull >>
+      32;
+  slot &= table_mask_;
+
+  while (table_[slot] != kEmpty) {
+    LevelDelta& existing = pending_[table_[slot] - 1];
+    if (existing.side == delta.side && existing.price == delta.price) {
+      existing = delta;
+      ++dropped_updates_;
+      return;
+    }
+    slot = (slot + 1) & table_mask_;
+  }
+
+  if (pending_.size() == config_.capacity) {
+    Flush();
+    Buffer(delta);
+    return;
+  }
+
+  if (pending_.empty() && config_.max_delay.count() > 0) {
+    window_start_ = Clock::now();
+  }
+  pending_.emplace_back(delta);
+  pending_slots_.emplace_back(static_cast<uint32_t>(slot));
+  table_[slot] = static_cast<uint32_t>(pending_.size());
+}
+
+void ConflatingPublisher::OnLevelDeltas(std::span<const LevelDelta> deltas) {
+  for (const auto& delta : deltas) {
+    Buffer(delta);
+  }
+
+  ++events_in_window_;
+  if (config_.max_events != 0 && events_in_window_ >= config_.max_events) {
+    Flush();
+  } else if (config_.max_delay.count() > 0) {
+    Poll(Clock::now());
+  }
+}
+
+void ConflatingPublisher::Poll(Clock::time_point now) {
+  if (pending_.empty() || config_.max_delay.count() <= 0) return;
+  if (now - window_start_ >= config_.max_delay) {
+    Flush();
+  }
+}
+
+void ConflatingPublisher::Flush() {
+  events_in_window_ = 0;
+  if (pending_.empty()) return;
+
+  downstream_->OnLevelDeltas(pending_);
+  published_updates_ += pending_.size();
+  ++flushes_;
+
+  for (uint32_t slot : pending_slots_) {
+    table_[slot] = kEmpty;
+  }
+  pending_.clear();
+  pending_slots_.clear();
+}
+
+uint64_t ConflatingPublisher::dropped_updates() const {
+  return dropped_updates_;
+}
+
+uint64_t ConflatingPublisher::published_updates() const {
+  return published_updates_;
+}
+
+uint64_t ConflatingPublisher::flushes() const { return flushes_; }
+}  // namespace order_book_v1
@@ -1,42 +1,295 @@
 #include "../include/event_log.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "../include/trace.h"
+
 namespace order_book_v1 {
-template <typename... Args>
-std::ostream& WriteSpaceSep(std::ostream& os, const Args&... xs) {
-  bool first = true;
-  ((os << (first ? "" : " ") << xs, first = false), ...);
-  return os;
+namespace {
+char* Put(char* out, std::string_view text) {
+  std::memcpy(out, text.data(), text.size());
+  return out + text.size();
+}
+
+// Numbers are preceded by the separator, which is true of every field after
+// the sequence number
+char* PutField(char* out, Underlying value) {
+  *out++ = ' ';
+  return std::to_chars(out, out + 10, value).ptr;
+}
+
+char* PutField(char* out, OrderSide side) {
+  return Put(out, side == OrderSide::kBuy ? " BUY" : " SELL");
+}
+
+char* PutField(char* out, TimeInForce tif) {
+  switch (tif) {
+    case TimeInForce::kGoodTillCancel:
+      return Put(out, " GTC");
+    case TimeInForce::kImmediateOrCancel:
+      return Put(out, " IOC");
+    case TimeInForce::kFillOrKill:
+      return Put(out, " FOK");
+  }
+  return out;
+}
+
+char* PutField(char* out, SelfTradePrevention mode) {
+  switch (mode) {
+    case SelfTradePrevention::kNone:
+      return Put(out, " NONE");
+    case SelfTradePrevention::kCancelNewest:
+      return Put(out, " NEWEST");
+    case SelfTradePrevention::kCancelOldest:
+      return Put(out, " OLDEST");
+    case SelfTradePrevention::kCancelBoth:
+      return Put(out, " BOTH");
+    case SelfTradePrevention::kDecrement:
+      return Put(out, " DECREMENT");
+  }
+  return out;
 }
+}  // namespace
 
-std::ostream& operator<<(std::ostream& os, const AddLimitOrderEvent& event) {
-  if (!event.price.has_value() || !event.tif.has_value())
-    return os << "INVALID_LIMIT_ORDER";
-  WriteSpaceSep(os, "ADDLIMIT", event.creator_id, event.side, event.qty,
-                event.price.value(), event.tif.value());
-  return os;
+// One line per event, fields separated by single spaces:
+//   <seq> ADDLIMIT <user> <side> <qty> <price> <tif>
+//   <seq> ADDMARKET <user> <side> <qty>
+//   <seq> CANCEL <order>
+//   <seq> MODIFY <order> <qty> <price>
+//   <seq> CANCELALL <user> [<side>]
+//   <seq> ADDICEBERG <user> <side> <qty> <price> <display qty>
+//   <seq> ADDSTOP <user> <side> <qty> <stop price> [<limit price>]
+//   <seq> SETSTP NONE|NEWEST|OLDEST|BOTH|DECREMENT
+// Sides are BUY or SELL and time in force GTC, IOC or FOK. Fields are
+// written straight into `out`, without the stream formatting machinery.
+std::size_t FormatEvent(const LoggedEvent& record, char* out) {
+  char* const begin = out;
+  out = std::to_chars(out, out + 10, record.event_seq).ptr;
+  std::visit(
+      [&out](const auto& e) {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, AddLimitOrderEvent>) {
+          if (!e.price.has_value() || !e.tif.has_value()) {
+            out = Put(out, " INVALID_LIMIT_ORDER");
+            return;
+          }
+          out = Put(out, " ADDLIMIT");
+          out = PutField(out, e.creator_id.v);
+          out = PutField(out, e.side);
+          out = PutField(out, e.qty.v);
+          out = PutField(out, e.price->v);
+          out = PutField(out, *e.tif);
+        } else if constexpr (std::is_same_v<T, AddMarketOrderEvent>) {
+          out = Put(out, " ADDMARKET");
+          out = PutField(out, e.creator_id.v);
+          out = PutField(out, e.side);
+          out = PutField(out, e.qty.v);
+        } else if constexpr (std::is_same_v<T, CancelOrderEvent>) {
+          out = Put(out, " CANCEL");
+          out = PutField(out, e.order_id.v);
+        } else if constexpr (std::is_same_v<T, ModifyOrderEvent>) {
+          out = Put(out, " MODIFY");
+          out = PutField(out, e.order_id.v);
+          out = PutField(out, e.qty.v);
+          out = PutField(out, e.price.v);
+        } else if constexpr (std::is_same_v<T, CancelAllOrdersEvent>) {
+          out = Put(out, " CANCELALL");
+          out = PutField(out, e.user_id.v);
+          if (e.side.has_value()) out = PutField(out, *e.side);
+        } else if constexpr (std::is_same_v<T, AddIcebergOrderEvent>) {
+          out = Put(out, " ADDICEBERG");
+          out = PutField(out, e.creator_id.v);
+          out = PutField(out, e.side);
+          out = PutField(out, e.qty.v);
+          out = PutField(out, e.price.v);
+          out = PutField(out, e.display_qty.v);
+        } else if constexpr (std::is_same_v<T, AddStopOrderEvent>) {
+          out = Put(out, " ADDSTOP");
+          out = PutField(out, e.creator_id.v);
+          out = PutField(out, e.side);
+          out = PutField(out, e.qty.v);
+          out = PutField(out, e.stop_price.v);
+          if (e.limit_price.has_value()) out = PutField(out, e.limit_price->v);
+        } else if constexpr (std::is_same_v<T, SetSelfTradePreventionEvent>) {
+          out = Put(out, " SETSTP");
+          out = PutField(out, e.mode);
+        }
+      },
+      record.event);
+  return static_cast<std::size_t>(out - begin);
 }
 
-std::ostream& operator<<(std::ostream& os, const AddMarketOrderEvent& event) {
-  WriteSpaceSep(os, "ADDMARKET", event.creator_id, event.side, event.qty);
-  return os;
+namespace {
+// Splits off the next space-separated token, leaving the rest in `line`
+std::string_view NextToken(std::string_view& line) {
+  std::size_t begin = line.find_first_not_of(' ');
+  if (begin == std::string_view::npos) {
+    line = {};
+    return {};
+  }
+  line.remove_prefix(begin);
+  std::size_t end = std::min(line.find(' '), line.size());
+  std::string_view token = line.substr(0, end);
+  line.remove_prefix(end);
+  return token;
 }
 
-std::ostream& operator<<(std::ostream& os, const CancelOrderEvent& event) {
-  WriteSpaceSep(os, "CANCEL", event.order_id);
-  return os;
+bool ParseNumber(std::string_view token, Underlying& out) {
+  const char* end = token.data() + token.size();
+  auto [ptr, ec] = std::from_chars(token.data(), end, out);
+  return !token.empty() && ec == std::errc() && ptr == end;
 }
 
-std::ostream& operator<<(std::ostream& os, const LoggedEvent& record) {
-  os << record.event_seq << " ";
-  std::visit([&os](auto&& args) { os << args; }, record.event);
-  return os;
+std::optional<OrderSide> ParseSide(std::string_view token) {
+  if (token == "BUY") return OrderSide::kBuy;
+  if (token == "SELL") return OrderSide::kSell;
+  return std::nullopt;
+}
+
+std::optional<TimeInForce> ParseTif(std::string_view token) {
+  if (token == "GTC") return TimeInForce::kGoodTillCancel;
+  if (token == "IOC") return TimeInForce::kImmediateOrCancel;
+  if (token == "FOK") return TimeInForce::kFillOrKill;
+  return std::nullopt;
+}
+
+std::optional<SelfTradePrevention> ParseSelfTradePrevention(
+    std::string_view token) {
+  if (token == "NONE") return SelfTradePrevention::kNone;
+  if (token == "NEWEST") return SelfTradePrevention::kCancelNewest;
+  if (token == "OLDEST") return SelfTradePrevention::kCancelOldest;
+  if (token == "BOTH") return SelfTradePrevention::kCancelBoth;
+  if (token == "DECREMENT") return SelfTradePrevention::kDecrement;
+  return std::nullopt;
+}
+}  // namespace
+
+// Reads back the line format described above FormatEvent
+std::optional<LoggedEvent> ParseEvent(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+  uint32_t seq = 0;
+  if (!ParseNumber(NextToken(line), seq)) return std::nullopt;
+  std::string_view type = NextToken(line);
+
+  // Every field has been consumed once an event is built, so anything left
+  // over makes the line malformed
+  auto complete = [&line, seq](const OrderBookEvent& event) {
+    return NextToken(line).empty()
+               ? std::optional<LoggedEvent>(
+                     LoggedEvent{.event_seq = seq, .event = event})
+               : std::nullopt;
+  };
+  if (type == "ADDLIMIT") {
+    Underlying user = 0, qty = 0, price = 0;
+    bool ok = ParseNumber(NextToken(line), user);
+    auto side = ParseSide(NextToken(line));
+    ok = ok && ParseNumber(NextToken(line), qty);
+    ok = ok && ParseNumber(NextToken(line), price);
+    auto tif = ParseTif(NextToken(line));
+    if (ok && side.has_value() && tif.has_value()) {
+      return complete(AddLimitOrderEvent{.creator_id = UserId{user},
+                                         .side = *side,
+                                         .qty = Quantity{qty},
+                                         .price = Price{price},
+                                         .tif = tif});
+    }
+  } else if (type == "ADDMARKET") {
+    Underlying user = 0, qty = 0;
+    bool ok = ParseNumber(NextToken(line), user);
+    auto side = ParseSide(NextToken(line));
+    ok = ok && ParseNumber(NextToken(line), qty);
+    if (ok && side.has_value()) {
+      return complete(AddMarketOrderEvent{
+          .creator_id = UserId{user}, .side = *side, .qty = Quantity{qty}});
+    }
+  } else if (type == "CANCEL") {
+    Underlying id = 0;
+    if (ParseNumber(NextToken(line), id)) {
+      return complete(CancelOrderEvent{.order_id = OrderId{id}});
+    }
+  } else if (type == "MODIFY") {
+    Underlying id = 0, qty = 0, price = 0;
+    bool ok = ParseNumber(NextToken(line), id);
+    ok = ok && ParseNumber(NextToken(line), qty);
+    ok = ok && ParseNumber(NextToken(line), price);
+    if (ok) {
+      return complete(ModifyOrderEvent{.order_id = OrderId{id},
+                                       .qty = Quantity{qty},
+                                       .price = Price{price}});
+    }
+  } else if (type == "ADDICEBERG") {
+    Underlying user = 0, qty = 0, price = 0, display = 0;
+    bool ok = ParseNumber(NextToken(line), user);
+    auto side = ParseSide(NextToken(line));
+    ok = ok && ParseNumber(NextToken(line), qty);
+    ok = ok && ParseNumber(NextToken(line), price);
+    ok = ok && ParseNumber(NextToken(line), display);
+    if (ok && side.has_value()) {
+      return complete(AddIcebergOrderEvent{.creator_id = UserId{user},
+                                           .side = *side,
+                                           .qty = Quantity{qty},
+                                           .price = Price{price},
+                                           .display_qty = Quantity{display}});
+    }
+  } else if (type == "ADDSTOP") {
+    Underlying user = 0, qty = 0, stop = 0, limit = 0;
+    bool ok = ParseNumber(NextToken(line), user);
+    auto side = ParseSide(NextToken(line));
+    ok = ok && ParseNumber(NextToken(line), qty);
+    ok = ok && ParseNumber(NextToken(line), stop);
+    if (ok && side.has_value()) {
+      AddStopOrderEvent event{.creator_id = UserId{user},
+                              .side = *side,
+                              .qty = Quantity{qty},
+                              .stop_price = Price{stop},
+                              .limit_price = std::nullopt};
+      // A stop-limit carries its limit as an optional last field
+      std::string_view limit_token = NextToken(line);
+      if (limit_token.empty()) return complete(event);
+      if (ParseNumber(limit_token, limit)) {
+        event.limit_price = Price{limit};
+        return complete(event);
+      }
+    }
+  } else if (type == "SETSTP") {
+    if (auto mode = ParseSelfTradePrevention(NextToken(line))) {
+      return complete(SetSelfTradePreventionEvent{.mode = *mode});
+    }
+  } else if (type == "CANCELALL") {
+    Underlying user = 0;
+    if (ParseNumber(NextToken(line), user)) {
+      // The side is optional, so an absent token is not an error
+      std::string_view side_token = NextToken(line);
+      if (side_token.empty()) {
+        return complete(CancelAllOrdersEvent{.user_id = UserId{user},
+                                             .side = std::nullopt});
+      }
+      if (auto side = ParseSide(side_token)) {
+        return complete(
+            CancelAllOrdersEvent{.user_id = UserId{user}, .side = *side});
+      }
+    }
+  }
+
+  return std::nullopt;
 }
 
 EventLog::EventLog(std::ostream* dst) : dst_(dst) {}
 
 void EventLog::AppendEvent(const OrderBookEvent& event) {
-  LoggedEvent record{.event_seq = event_seq_++, .event = event};
-  *dst_ << record << "\n";
+  ORDERBOOK_TRACE_SPAN("JournalAppend");
+  char line[kMaxEventLineSize];
+  std::size_t size =
+      FormatEvent(LoggedEvent{.event_seq = event_seq_++, .event = event}, line);
+  line[size++] = '\n';
+  // Straight to the buffer: the line is already formatted, so the stream's
+  // sentry and locale handling would be pure overhead
+  dst_->rdbuf()->sputn(line, static_cast<std::streamsize>(size));
 }
 
 uint32_t EventLog::event_seq() { return event_seq_; }
@@ -0,0 +1,78 @@
+#include "../include/latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace order_book_v1 {
+void LatencyHistogram::Reset() {
+  counts_.fill(0);
+  total_ = 0;
+  max_ = 0;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  for (std::size_t i = 0; i < kBuckets; ++i) counts_[i] += other.counts_[i];
+  total_ += other.total_;
+  max_ = std::max(max_, other.max_);
+}
+
+uint64_t LatencyHistogram::BucketUpperBound(std::size_t bucket) {
+  if (bucket < kSubBuckets) return bucket;
+  const auto shift = static_cast<int>((bucket >> kSubBucketBits) - 1);
+  const uint64_t lower = (kSubBuckets + (bucket & (kSubBuckets - 1))) << shift;
+  return lower + ((uint64_t{1} << shift) - 1);
+}
+
+uint64_t LatencyHistogram::ValueAtPercentile(double p) const {
+  if (total_ == 0) return 0;
+  const double clamped = std::clamp(p, 0.0, 100.0);
+  auto rank = static_cast<uint64_t>(
+      std::ceil(clamped / 100.0 * static_cast<double>(total_)));
+  rank = std::max<uint64_t>(rank, 1);
+
+  uint64_t seen = 0;
+  for (std::size_t i = 0; i < kBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return std::min(BucketUpperBound(i), max_);
+  }
+  return max_;
+}
+
+std::string_view LatencyKindName(LatencyKind kind) {
+  switch (kind) {
+    case LatencyKind::kLimitRested:
+      return "limit_rested";
+    case LatencyKind::kLimitFilled:
+      return "limit_filled";
+    case LatencyKind::kLimitPartial:
+      return "limit_partial";
+    case LatencyKind::kLimitRejected:
+      return "limit_rejected";
+    case LatencyKind::kMarketFilled:
+      return "market_filled";
+    case LatencyKind::kMarketPartial:
+      return "market_partial";
+    case LatencyKind::kMarketRejected:
+      return "market_rejected";
+    case LatencyKind::kCancelHit:
+      return "cancel_hit";
+    case LatencyKind::kCancelMiss:
+      return "cancel_miss";
+    case LatencyKind::kModify:
+      return "modify";
+    case LatencyKind::kStop:
+      return "stop";
+    case LatencyKind::kCancelAll:
+      return "cancel_all";
+  }
+  return "unknown";
+}
+
+bool LatencyHistogramsEnabled() {
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  return true;
+#else
+  return false;
+#endif
+}
+}  // namespace order_book_v1
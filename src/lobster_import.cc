@@ -0,0 +1,251 @@
+#include "../include/lobster_import.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
+namespace order_book_v1 {
+namespace {
+constexpr int kInitialBits = 10;
+constexpr std::size_t kReadBlockSize = 1 << 20;
+
+// Splits off the next comma-separated field, leaving the rest in `line`
+std::string_view NextField(std::string_view& line) {
+  const std::size_t end = std::min(line.find(','), line.size());
+  std::string_view field = line.substr(0, end);
+  line.remove_prefix(std::min(end + 1, line.size()));
+  return field;
+}
+
+template <class T>
+bool ParseField(std::string_view field, T& out) {
+  const char* end = field.data() + field.size();
+  auto [ptr, ec] = std::from_chars(field.data(), end, out);
+  return !field.empty() && ec == std::errc() && ptr == end;
+}
+}  // namespace
+
+ExternalOrderMap::ExternalOrderMap()
+    : slots_(std::size_t{1} << kInitialBits), shift_(64 - kInitialBits) {}
+
+// Fibonacci hashing: exchange ids are often sequential, and the multiply
+// spreads them over the whole table
+std::size_t ExternalOrderMap::Home(uint64_t external_id) const {
+  return static_cast<std::size_t>((external_id * 0x9E3779B97F4A7C15ULL) >>
+                                  shift_);
+}
+
+ExternalOrderMap::Entry* ExternalOrderMap::Find(uint64_t external_id) {
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = Home(external_id);; i = (i + 1) & mask) {
+    Entry& slot = slots_[i];
+    if (slot.order_id.v == 0) return nullptr;
+    if (slot.external_id == external_id) return &slot;
+  }
+}
+
+void ExternalOrderMap::Insert(const Entry& entry) {
+  if ((size_ + 1) * 2 > slots_.size()) Grow();
+  const std::size_t mask = slots_.size() - 1;
+  for (std::size_t i = Home(entry.external_id);; i = (i + 1) & mask) {
+    Entry& slot = slots_[i];
+    if (slot.order_id.v == 0) {
+      slot = entry;
+      ++size_;
+      return;
+    }
+    if (slot.external_id == entry.external_id) {
+      slot = entry;
+      return;
+    }
+  }
+}
+
+// Moves later members of the probe run back into the hole whenever the hole
+// lies between their home slot and where they sit, so lookups never stop
+// early at it
+void ExternalOrderMap::Erase(uint64_t external_id) {
+  const std::size_t mask = slots_.size() - 1;
+  std::size_t hole = Home(external_id);
+  while (true) {
+    if (slots_[hole].order_id.v == 0) return;
+    if (slots_[hole].external_id == external_id) break;
+    hole = (hole + 1) & mask;
+  }
+  for (std::size_t i = (hole + 1) & mask; slots_[i].order_id.v != 0;
+       i = (i + 1) & mask) {
+    const std::size_t home = Home(slots_[i].external_id);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots_[hole] = slots_[i];
+      hole = i;
+    }
+  }
+  slots_[hole].order_id = OrderId{0};
+  --size_;
+}
+
+void ExternalOrderMap::Grow() {
+  std::vector<Entry> old(slots_.size() * 2);
+  old.swap(slots_);
+  --shift_;
+  size_ = 0;
+  for (const Entry& entry : old) {
+    if (entry.order_id.v != 0) Insert(entry);
+  }
+}
+
+LobsterImporter::LobsterImporter(EventLog& journal) : journal_(journal) {}
+
+bool LobsterImporter::ImportLine(std::string_view line) {
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+  if (line.empty()) return true;
+  ++stats_.lines;
+
+  NextField(line);  // time
+  int type = 0;
+  uint64_t external_id = 0;
+  Underlying size = 0;
+  int64_t price = 0;
+  int direction = 0;
+  if (!ParseField(NextField(line), type) ||
+      !ParseField(NextField(line), external_id) ||
+      !ParseField(NextField(line), size) ||
+      !ParseField(NextField(line), price) ||
+      !ParseField(NextField(line), direction) ||
+      (direction != 1 && direction != -1)) {
+    ++stats_.malformed;
+    return false;
+  }
+  const OrderSide side = direction == 1 ? OrderSide::kBuy : OrderSide::kSell;
+
+  switch (static_cast<LobsterMessageType>(type)) {
+    case LobsterMessageType::kSubmit: {
+      if (size == 0 || price <= 0 ||
+          price > std::numeric_limits<Underlying>::max()) {
+        ++stats_.malformed;
+        return false;
+      }
+      const Price limit{static_cast<Underlying>(price)};
+      AppendAdd(AddLimitOrderEvent{.creator_id = UserId{0},
+                                   .side = side,
+                                   .qty = Quantity{size},
+                                   .price = limit,
+                                   .tif = TimeInForce::kGoodTillCancel});
+      orders_.Insert({.external_id = external_id,
+                      .order_id = OrderId{next_order_id_},
+                      .remaining = Quantity{size},
+                      .price = limit,
+                      .side = side});
+      ++stats_.submits;
+      return true;
+    }
+    case LobsterMessageType::kPartialCancel:
+    case LobsterMessageType::kDelete:
+    case LobsterMessageType::kExecuteVisible:
+      break;
+    case LobsterMessageType::kExecuteHidden:
+    case LobsterMessageType::kCross:
+    case LobsterMessageType::kHalt:
+      ++stats_.skipped_no_order;
+      return true;
+    default:
+      ++stats_.malformed;
+      return false;
+  }
+
+  ExternalOrderMap::Entry* entry = orders_.Find(external_id);
+  if (entry == nullptr) {
+    ++stats_.skipped_unknown_order;
+    return true;
+  }
+  const bool leaves_order =
+      type == static_cast<int>(LobsterMessageType::kDelete) ||
+      size >= entry->remaining.v;
+
+  if (type == static_cast<int>(LobsterMessageType::kExecuteVisible)) {
+    ++stats_.executions;
+    if (size > 0) {
+      AppendAdd(AddMarketOrderEvent{
+          .creator_id = UserId{0},
+          .side = entry->side == OrderSide::kBuy ? OrderSide::kSell
+                                                 : OrderSide::kBuy,
+          .qty = Quantity{size}});
+    }
+    if (leaves_order) {
+      orders_.Erase(external_id);
+    } else {
+      entry->remaining = Quantity{entry->remaining.v - size};
+    }
+    return true;
+  }
+
+  if (type == static_cast<int>(LobsterMessageType::kDelete)) {
+    ++stats_.deletes;
+  } else {
+    ++stats_.partial_cancels;
+  }
+  if (leaves_order) {
+    AppendCancel(entry->order_id);
+    orders_.Erase(external_id);
+    return true;
+  }
+  entry->remaining = Quantity{entry->remaining.v - size};
+  AppendModify(*entry);
+  return true;
+}
+
+void LobsterImporter::ImportStream(std::istream& in) {
+  std::vector<char> block(kReadBlockSize);
+  std::size_t carry = 0;
+  while (in) {
+    in.read(block.data() + carry,
+            static_cast<std::streamsize>(block.size() - carry));
+    const auto got = static_cast<std::size_t>(in.gcount());
+    if (got == 0) break;
+    const std::size_t filled = carry + got;
+
+    std::size_t begin = 0;
+    while (true) {
+      const void* newline =
+          std::memchr(block.data() + begin, '\n', filled - begin);
+      if (newline == nullptr) break;
+      const auto end =
+          static_cast<std::size_t>(static_cast<const char*>(newline) -
+                                   block.data());
+      ImportLine(std::string_view(block.data() + begin, end - begin));
+      begin = end + 1;
+    }
+
+    carry = filled - begin;
+    if (carry == block.size()) {
+      // A line longer than a whole block is not a LOBSTER message
+      ++stats_.lines;
+      ++stats_.malformed;
+      carry = 0;
+    } else {
+      std::memmove(block.data(), block.data() + begin, carry);
+    }
+  }
+  if (carry > 0) ImportLine(std::string_view(block.data(), carry));
+}
+
+// Every add this importer writes passes the book's validation, so each one
+// takes the next order id
+void LobsterImporter::AppendAdd(const OrderBookEvent& event) {
+  journal_.AppendEvent(event);
+  ++next_order_id_;
+  ++stats_.events_written;
+}
+
+void LobsterImporter::AppendCancel(OrderId order_id) {
+  journal_.AppendEvent(CancelOrderEvent{.order_id = order_id});
+  ++stats_.events_written;
+}
+
+void LobsterImporter::AppendModify(const ExternalOrderMap::Entry& entry) {
+  journal_.AppendEvent(ModifyOrderEvent{
+      .order_id = entry.order_id, .qty = entry.remaining, .price = entry.price});
+  ++stats_.events_written;
+}
+}  // namespace order_book_v1
@@ -3,18 +3,29 @@
 #include <algorithm>
 #include <cctype>
 #include <charconv>
+#include <cstddef>
 #include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <ostream>
 #include <random>
 #include <sstream>
 #include <string>
 #include <string_view>
 #include <thread>
-
+#include <vector>
+
+#include "event_log.h"
+#include "latency_histogram.h"
+#include "lobster_import.h"
+#include "metrics.h"
+#include "simulation.h"
+#include "trace.h"
+#include "tsc_clock.h"
 #include "types.h"
 
 namespace {
@@ -63,10 +74,12 @@ Central Limit Order Book with replay abilities
 Commands:
   simulate		Generate random events with random data
   replay		Ingest event log and show the final state
+  import-lobster	Convert a LOBSTER message file (--input) into an event log (--output)
 
 Options:
   --output <path>			Write events to a file path
   --input <path>			Read events from file path for replay
+  --trace <path>			Write a Chrome trace of the replay (needs ORDERBOOK_TRACING)
   --max-sim-steps <number>		Maximum number of events to generate in simuluation
   --min-sim-sleep <milliseconds>	Minimum delay between simulated events (default: 10)
   --max-sim-sleep <milliseconds>	Maximum delay between simulated events (default: 1250)
@@ -75,11 +88,20 @@ Options:
   --min-quantity <number>		Minimum quantity for simulated orders (default: 1)
   --max-quantity <number>		Maximum quantity for simulated orders (default: 50)
   --seed <number>			Use a specified seed when creating simulated events
+  --headless				Simulate without printing or sleeping, writing only the journal
+  --rate <events/s>			Pace headless simulation to this many events per second (default: flat out)
+  --summary-every <events>		Print a book summary to stderr every N headless events
+  --summary-depth <levels>		Levels per side in the headless summary (default: 5)
+  --books <number>			Simulate this many independent books headless, one journal segment each
+  --threads <number>			Threads generating the books (default: hardware threads)
+  --metrics-file <path>			Rewrite Prometheus-format metrics to a file while simulating
+  --metrics-socket <path>		Serve Prometheus metrics over HTTP on a unix socket while simulating
+  --metrics-interval <milliseconds>	How often the metrics file is rewritten (default: 1000)
   --help				Display this message and exit
 )";
 }
 
-enum class CLIMode { kSimulate = 0, kReplay };
+enum class CLIMode { kSimulate = 0, kReplay, kImportLobster };
 
 struct SimulationConfig {
   std::string_view output_path;
@@ -91,6 +113,18 @@ struct SimulationConfig {
   uint32_t min_quantity;
   uint32_t max_quantity;
   uint32_t simulation_seed;
+  std::string_view metrics_file;
+  std::string_view metrics_socket;
+  uint32_t metrics_interval;
+  bool headless;
+  // Events per second in headless mode. 0 runs flat out.
+  uint32_t target_rate;
+  // Prints a book summary every this many events in headless mode. 0 never.
+  uint32_t summary_every;
+  uint32_t summary_depth;
+  // More than one runs StartMultiBookSimulation
+  uint32_t books;
+  uint32_t threads;
 };
 
 void StartSimulation(const SimulationConfig& config) {
@@ -118,6 +152,20 @@ void StartSimulation(const SimulationConfig& config) {
     ob = order_book_v1::OrderBook(&log_file);
   }
 
+  order_book_v1::MetricsRegistry metrics;
+  order_book_v1::MetricsExporter exporter(
+      metrics, {.interval = std::chrono::milliseconds(config.metrics_interval),
+                .file_path = std::string(config.metrics_file),
+                .socket_path = std::string(config.metrics_socket)});
+  if (!config.metrics_file.empty() || !config.metrics_socket.empty()) {
+    ob.SetMetrics(&metrics.Register());
+    if (!exporter.Start().has_value()) {
+      std::cerr << "Cannot listen on metrics socket: " << config.metrics_socket
+                << "\n";
+      return;
+    }
+  }
+
   std::vector<order_book_v1::OrderId> past_ids;
   uint32_t iterations = 0;
   while (config.max_sim_steps == 0 || iterations++ < config.max_sim_steps) {
@@ -153,7 +201,8 @@ void StartSimulation(const SimulationConfig& config) {
         const size_t idx =
             cancel_idx_rn(rng, decltype(cancel_idx_rn)::param_type{0, last});
         ob.Cancel(past_ids[idx]);
-        past_ids.clear();
+        past_ids[idx] = past_ids.back();
+        past_ids.pop_back();
       }
     }
 
@@ -162,67 +211,255 @@ void StartSimulation(const SimulationConfig& config) {
   }
 }
 
-int StartReplay(std::string_view& input_path) {
+void PrintBookSummary(const order_book_v1::OrderBook& ob, uint64_t events,
+                      double seconds, uint32_t depth) {
+  std::cerr << "events=" << events << " elapsed=" << std::fixed
+            << std::setprecision(2) << seconds << "s rate=" << std::setprecision(0)
+            << static_cast<double>(events) / seconds << "/s"
+            << std::defaultfloat << "\n";
+  for (auto side :
+       {order_book_v1::OrderSide::kSell, order_book_v1::OrderSide::kBuy}) {
+    auto levels = ob.TopLevels(side, depth);
+    std::cerr << (side == order_book_v1::OrderSide::kBuy ? "  bids:" : "  asks:");
+    for (const auto& level : levels) {
+      std::cerr << " " << level.price.v << "x" << level.qty.v << "("
+                << level.orders << ")";
+    }
+    std::cerr << "\n";
+  }
+}
+
+// Same event mix as StartSimulation, written straight to the journal with no
+// printing or sleeping. A book is only run alongside when periodic summaries
+// are requested.
+void StartHeadlessSimulation(const SimulationConfig& config) {
+  std::ofstream log_file;
+  std::vector<char> file_buffer;
+  std::ostream* out = &std::cout;
+  if (config.output_path.empty()) {
+    std::ios::sync_with_stdio(false);
+  } else {
+    file_buffer.resize(1 << 20);
+    log_file.rdbuf()->pubsetbuf(file_buffer.data(),
+                                static_cast<std::streamsize>(file_buffer.size()));
+    log_file.open(std::string(config.output_path), std::ios::binary);
+    out = &log_file;
+  }
+  order_book_v1::EventLog journal(out);
+
+  std::optional<order_book_v1::OrderBook> summary_book;
+  if (config.summary_every > 0) summary_book.emplace();
+
+  order_book_v1::RandomFlow flow({.min_price = config.min_price,
+                                   .max_price = config.max_price,
+                                   .min_qty = config.min_quantity,
+                                   .max_qty = config.max_quantity},
+                                  config.simulation_seed);
+
+  // Pacing is checked once per batch so the clock read stays off the per
+  // event path
+  constexpr uint64_t kPaceBatch = 1024;
+  const auto start = std::chrono::steady_clock::now();
+  auto elapsed_seconds = [&start] {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                         start)
+        .count();
+  };
+
+  uint64_t events = 0;
+  while (config.max_sim_steps == 0 || events < config.max_sim_steps) {
+    const order_book_v1::OrderBookEvent event = flow.Next();
+    journal.AppendEvent(event);
+    ++events;
+
+    if (summary_book.has_value()) {
+      summary_book->Apply(event);
+      if (events % config.summary_every == 0) {
+        PrintBookSummary(*summary_book, events, elapsed_seconds(),
+                         config.summary_depth);
+      }
+    }
+    if (config.target_rate > 0 && events % kPaceBatch == 0) {
+      const double due = static_cast<double>(events) / config.target_rate;
+      const double ahead = due - elapsed_seconds();
+      if (ahead > 0) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(ahead));
+      }
+    }
+  }
+  out->flush();
+
+  const double seconds = elapsed_seconds();
+  std::cerr << "Wrote " << events << " events in " << std::fixed
+            << std::setprecision(3) << seconds << " s ("
+            << std::setprecision(0) << static_cast<double>(events) / seconds
+            << " events/s)" << std::defaultfloat << "\n";
+}
+
+// One independent stream per book, each in its own journal segment
+// <output>.<book>. Segments only depend on --seed, never on --threads.
+int StartMultiBookSimulation(const SimulationConfig& config) {
+  if (config.output_path.empty()) {
+    std::cerr << "--books needs --output for the journal segments\n";
+    return 2;
+  }
+  std::vector<std::ofstream> files(config.books);
+  std::vector<std::vector<char>> buffers(config.books);
+  std::vector<std::ostream*> segments;
+  for (uint32_t b = 0; b < config.books; ++b) {
+    const std::string path =
+        std::string(config.output_path) + "." + std::to_string(b);
+    buffers[b].resize(1 << 18);
+    files[b].rdbuf()->pubsetbuf(
+        buffers[b].data(), static_cast<std::streamsize>(buffers[b].size()));
+    files[b].open(path, std::ios::binary);
+    if (!files[b].is_open()) {
+      std::cerr << "Cannot open output file: " << path << "\n";
+      return 3;
+    }
+    segments.push_back(&files[b]);
+  }
+
+  const order_book_v1::MultiBookConfig multi{
+      .flow = {.min_price = config.min_price,
+               .max_price = config.max_price,
+               .min_qty = config.min_quantity,
+               .max_qty = config.max_quantity},
+      .seed = config.simulation_seed,
+      .threads = config.threads,
+      .events_per_book = config.max_sim_steps,
+      .target_rate = config.target_rate,
+  };
+  const auto start = std::chrono::steady_clock::now();
+  order_book_v1::RunMultiBookSimulation(multi, segments);
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  const double events =
+      static_cast<double>(config.max_sim_steps) * config.books;
+  std::cerr << "Wrote " << config.books << " segments of "
+            << config.max_sim_steps << " events on " << multi.threads
+            << " threads in " << std::fixed << std::setprecision(3)
+            << seconds << " s (" << std::setprecision(0) << events / seconds
+            << " events/s)" << std::defaultfloat << "\n";
+  return 0;
+}
+
+void PrintLatency(const order_book_v1::LatencySnapshot& snapshot) {
+  using order_book_v1::LatencyKind;
+  const double ticks_per_ns = order_book_v1::TscClock::Calibrate();
+  auto ns = [ticks_per_ns](uint64_t ticks) {
+    return static_cast<double>(ticks) / ticks_per_ns;
+  };
+
+  std::cout << "Latency (ns):\n";
+  std::cout << std::left << std::setw(16) << "kind" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "p50"
+            << std::setw(10) << "p99" << std::setw(10) << "p99.9"
+            << std::setw(10) << "max" << "\n";
+  std::cout << std::fixed << std::setprecision(0);
+  for (std::size_t i = 0; i < order_book_v1::kLatencyKindCount; ++i) {
+    const auto kind = static_cast<LatencyKind>(i);
+    const auto& histogram = snapshot[kind];
+    if (histogram.count() == 0) continue;
+    std::cout << std::left << std::setw(16)
+              << order_book_v1::LatencyKindName(kind) << std::right
+              << std::setw(10) << histogram.count() << std::setw(10)
+              << ns(histogram.ValueAtPercentile(50)) << std::setw(10)
+              << ns(histogram.ValueAtPercentile(99)) << std::setw(10)
+              << ns(histogram.ValueAtPercentile(99.9)) << std::setw(10)
+              << ns(histogram.max()) << "\n";
+  }
+  std::cout << std::defaultfloat;
+}
+
+int StartLobsterImport(std::string_view input_path,
+                       std::string_view output_path) {
+  if (input_path.empty() || output_path.empty()) {
+    std::cerr << "import-lobster needs both --input and --output\n";
+    return 2;
+  }
+  std::ifstream input(std::string(input_path), std::ios::binary);
+  if (!input.is_open()) {
+    std::cerr << "Specified input file doesn't exist" << std::endl;
+    return 3;
+  }
+  std::vector<char> output_buffer(1 << 20);
+  std::ofstream output;
+  output.rdbuf()->pubsetbuf(output_buffer.data(),
+                            static_cast<std::streamsize>(output_buffer.size()));
+  output.open(std::string(output_path), std::ios::binary);
+  if (!output.is_open()) {
+    std::cerr << "Cannot open output file: " << output_path << "\n";
+    return 3;
+  }
+
+  order_book_v1::EventLog journal(&output);
+  order_book_v1::LobsterImporter importer(journal);
+  const auto start = std::chrono::steady_clock::now();
+  importer.ImportStream(input);
+  output.flush();
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+          .count();
+
+  const auto& stats = importer.stats();
+  std::cerr << "Read " << stats.lines << " messages in " << std::fixed
+            << std::setprecision(3) << seconds << " s ("
+            << std::setprecision(0)
+            << static_cast<double>(stats.lines) / seconds << " lines/s)\n"
+            << std::defaultfloat << "  submits " << stats.submits
+            << ", partial cancels " << stats.partial_cancels << ", deletes "
+            << stats.deletes << ", executions " << stats.executions << "\n"
+            << "  skipped: " << stats.skipped_no_order
+            << " without a visible order, " << stats.skipped_unknown_order
+            << " for orders resting before the file, " << stats.malformed
+            << " malformed\n"
+            << "Wrote " << stats.events_written << " events, "
+            << importer.open_orders() << " orders still open\n";
+  return output.good() ? 0 : 3;
+}
+
+int StartReplay(std::string_view& input_path, std::string_view trace_path) {
   std::ifstream log_file(input_path.begin());
   if (!log_file.is_open()) {
     std::cerr << "Specified input file doesn't exist" << std::endl;
     return 3;
   }
+  std::ofstream trace_file;
+  if (!trace_path.empty()) {
+#ifndef ORDERBOOK_TRACING
+    std::cerr << "Built without ORDERBOOK_TRACING; the trace will be empty\n";
+#endif
+    trace_file.open(std::string(trace_path));
+    if (!trace_file.is_open()) {
+      std::cerr << "Cannot open trace file: " << trace_path << "\n";
+      return 3;
+    }
+    order_book_v1::Tracer::Start();
+  }
 
   std::ostringstream buf = std::ostringstream();
   order_book_v1::OrderBook ob{&buf};
 
   std::string line;
   while (std::getline(log_file, line)) {
-    std::vector<std::string> parts;
-    std::istringstream str(line);
-    std::string part;
-
-    order_book_v1::EventType type = order_book_v1::EventType::kLimit;
-
-    while (str >> part) {
-      parts.emplace_back(part);
-
-      if (parts.size() == 2) {
-        std::string type_part = parts.rbegin()->c_str();
-        if (type_part == "ADDLIMIT") {
-          type = order_book_v1::EventType::kLimit;
-        } else if (type_part == "ADDMARKET") {
-          type = order_book_v1::EventType::kMarket;
-        } else if (type_part == "CANCEL") {
-          type = order_book_v1::EventType::kCancel;
-        }
-      }
+    std::optional<order_book_v1::LoggedEvent> record;
+    {
+      ORDERBOOK_TRACE_SPAN("Parse");
+      record = order_book_v1::ParseEvent(line);
     }
-
-    // Type is known, all parts have been read
-    if (type == order_book_v1::EventType::kLimit) {
-      uint32_t user_id = std::stoi(parts[2]);
-      order_book_v1::OrderSide side = (parts[3] == "BUY")
-                                          ? order_book_v1::OrderSide::kBuy
-                                          : order_book_v1::OrderSide::kSell;
-      uint32_t qty = std::stoi(parts[4]);
-      uint32_t price = std::stoi(parts[5]);
-      order_book_v1::TimeInForce tif =
-          (parts[6] == "GTC") ? order_book_v1::TimeInForce::kGoodTillCancel
-                              : order_book_v1::TimeInForce::kImmediateOrCancel;
-      auto result = ob.AddLimit(order_book_v1::UserId{user_id}, side,
-                                order_book_v1::Price{price},
-                                order_book_v1::Quantity{qty}, tif);
-    } else if (type == order_book_v1::EventType::kMarket) {
-      uint32_t user_id = std::stoi(parts[2]);
-      order_book_v1::OrderSide side = (parts[3] == "BUY")
-                                          ? order_book_v1::OrderSide::kBuy
-                                          : order_book_v1::OrderSide::kSell;
-      uint32_t qty = std::stoi(parts[4]);
-      auto result = ob.AddMarket(order_book_v1::UserId{user_id}, side,
-                                 order_book_v1::Quantity{qty});
-    } else if (type == order_book_v1::EventType::kCancel) {
-      uint32_t order_id = std::stoi(parts[2]);
-      ob.Cancel(order_book_v1::OrderId{order_id});
+    if (record.has_value()) {
+      ob.Apply(record->event);
     }
   }
 
+  if (trace_file.is_open()) {
+    order_book_v1::Tracer::Stop();
+    order_book_v1::Tracer::WriteChromeTrace(trace_file);
+  }
+
   std::cout << buf.str() << "\n";
 
   std::cout << "Final State:\n";
@@ -230,6 +467,9 @@ int StartReplay(std::string_view& input_path) {
   std::cout << "Hash: " << ob.ToHash() << "\n";
   std::cout << ob;
   std::cout << "====================\n";
+  if (order_book_v1::LatencyHistogramsEnabled()) {
+    PrintLatency(ob.SnapshotLatency());
+  }
   return 0;
 }
 }  // namespace
@@ -243,6 +483,7 @@ int main(int argc, char** argv) {
   CLIMode mode = CLIMode::kSimulate;
   std::string_view output_path;
   std::string_view input_path;
+  std::string_view trace_path;
   uint32_t max_sim_steps = 0;
   uint32_t min_sim_sleep = 10;
   uint32_t max_sim_sleep = 1250;
@@ -251,6 +492,15 @@ int main(int argc, char** argv) {
   uint32_t min_quantity = 1;
   uint32_t max_quantity = 50;
   uint32_t simulation_seed = time(0);
+  std::string_view metrics_file;
+  std::string_view metrics_socket;
+  uint32_t metrics_interval = 1000;
+  bool headless = false;
+  uint32_t target_rate = 0;
+  uint32_t summary_every = 0;
+  uint32_t summary_depth = 5;
+  uint32_t books = 1;
+  uint32_t threads = std::max(1u, std::thread::hardware_concurrency());
 
   const std::string first = ToLowerAscii(argv[1]);
 
@@ -263,6 +513,8 @@ int main(int argc, char** argv) {
     mode = CLIMode::kSimulate;
   } else if (first == "replay") {
     mode = CLIMode::kReplay;
+  } else if (first == "import-lobster") {
+    mode = CLIMode::kImportLobster;
   } else {
     std::cerr << "Unknown command: " << argv[1] << "\n\n";
     PrintHelp();
@@ -285,6 +537,11 @@ int main(int argc, char** argv) {
         return 2;
       }
       input_path = argv[++i];
+    } else if (arg == "--trace") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      trace_path = argv[++i];
     } else if (arg == "--max-sim-steps") {
       if (!RequireValue(i, argc, arg)) {
         return 2;
@@ -341,6 +598,60 @@ int main(int argc, char** argv) {
       if (!ParseUint32(argv[++i], arg, simulation_seed)) {
         return 2;
       }
+    } else if (arg == "--headless") {
+      headless = true;
+    } else if (arg == "--books") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, books)) {
+        return 2;
+      }
+    } else if (arg == "--threads") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, threads)) {
+        return 2;
+      }
+    } else if (arg == "--rate") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, target_rate)) {
+        return 2;
+      }
+    } else if (arg == "--summary-every") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, summary_every)) {
+        return 2;
+      }
+    } else if (arg == "--summary-depth") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, summary_depth)) {
+        return 2;
+      }
+    } else if (arg == "--metrics-file") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      metrics_file = argv[++i];
+    } else if (arg == "--metrics-socket") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      metrics_socket = argv[++i];
+    } else if (arg == "--metrics-interval") {
+      if (!RequireValue(i, argc, arg)) {
+        return 2;
+      }
+      if (!ParseUint32(argv[++i], arg, metrics_interval)) {
+        return 2;
+      }
     } else if (!arg.empty() && arg.front() == '-') {
       std::cerr << "Unknown option: " << arg << "\n";
       return 1;
@@ -359,10 +670,16 @@ int main(int argc, char** argv) {
   } else if (min_quantity > max_quantity) {
     std::cerr << "--min-quantity cannot be greater than --max-quantity\n";
     return 2;
+  } else if (books == 0 || threads == 0) {
+    std::cerr << "--books and --threads must be at least 1\n";
+    return 2;
+  } else if (books > 1 && summary_every > 0) {
+    std::cerr << "--summary-every only applies to a single book\n";
+    return 2;
   }
 
   if (mode == CLIMode::kSimulate) {
-    StartSimulation({
+    const SimulationConfig config{
         .output_path = output_path,
         .max_sim_steps = max_sim_steps,
         .min_sim_sleep = min_sim_sleep,
@@ -372,9 +689,27 @@ int main(int argc, char** argv) {
         .min_quantity = min_quantity,
         .max_quantity = max_quantity,
         .simulation_seed = simulation_seed,
-    });
+        .metrics_file = metrics_file,
+        .metrics_socket = metrics_socket,
+        .metrics_interval = metrics_interval,
+        .headless = headless,
+        .target_rate = target_rate,
+        .summary_every = summary_every,
+        .summary_depth = summary_depth,
+        .books = books,
+        .threads = threads,
+    };
+    if (config.books > 1) {
+      return StartMultiBookSimulation(config);
+    } else if (config.headless) {
+      StartHeadlessSimulation(config);
+    } else {
+      StartSimulation(config);
+    }
   } else if (mode == CLIMode::kReplay) {
-    return StartReplay(input_path);
+    return StartReplay(input_path, trace_path);
+  } else if (mode == CLIMode::kImportLobster) {
+    return StartLobsterImport(input_path, output_path);
   }
 
   return 0;
@@ -0,0 +1,220 @@
+#include "../include/metrics.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <utility>
+
+namespace order_book_v1 {
+namespace {
+// Upper bound on how long Stop() waits for the exporter thread to notice
+constexpr std::chrono::milliseconds kPollSlice{100};
+
+constexpr const char* kRejectReasonLabels[kRejectReasonCount] = {
+    "bad_price", "bad_qty", "overflow", "empty_book_for_market",
+    "insufficient_liquidity", "unknown_order"};
+
+void WriteMetric(std::ostream& os, const char* name, const char* type,
+                 const char* help, uint64_t value) {
+  os << "# HELP " << name << ' ' << help << "\n# TYPE " << name << ' ' << type
+     << '\n'
+     << name << ' ' << value << '\n';
+}
+}  // namespace
+
+void MetricsSnapshot::WritePrometheus(std::ostream& os) const {
+  WriteMetric(os, "orderbook_books", "gauge", "Books reporting metrics.",
+              books);
+  os << "# HELP orderbook_orders_total Orders submitted, by type.\n"
+     << "# TYPE orderbook_orders_total counter\n"
+     << "orderbook_orders_total{type=\"limit\"} " << limit_orders << '\n'
+     << "orderbook_orders_total{type=\"market\"} " << market_orders << '\n'
+     << "orderbook_orders_total{type=\"stop\"} " << stop_orders << '\n';
+  WriteMetric(os, "orderbook_fills_total", "counter",
+              "Trades executed against resting orders.", fills);
+  os << "# HELP orderbook_cancels_total Cancel requests, by outcome.\n"
+     << "# TYPE orderbook_cancels_total counter\n"
+     << "orderbook_cancels_total{result=\"hit\"} " << cancels_hit << '\n'
+     << "orderbook_cancels_total{result=\"miss\"} " << cancels_miss << '\n';
+  WriteMetric(os, "orderbook_mass_cancels_total", "counter",
+              "Cancel-all requests for a user, however many orders they hit.",
+              mass_cancels);
+  WriteMetric(os, "orderbook_modifies_total", "counter",
+              "Modify requests, including rejected ones.", modifies);
+  WriteMetric(os, "orderbook_stops_triggered_total", "counter",
+              "Stop orders released into matching by a trade.",
+              stops_triggered);
+  WriteMetric(os, "orderbook_self_trades_prevented_total", "counter",
+              "Matches between orders of the same user that were prevented.",
+              self_trades_prevented);
+  os << "# HELP orderbook_rejects_total Rejected orders, by reason.\n"
+     << "# TYPE orderbook_rejects_total counter\n";
+  for (std::size_t i = 0; i < kRejectReasonCount; ++i) {
+    os << "orderbook_rejects_total{reason=\"" << kRejectReasonLabels[i]
+       << "\"} " << rejects[i] << '\n';
+  }
+  WriteMetric(os, "orderbook_levels_created_total", "counter",
+              "Price levels created.", levels_created);
+  WriteMetric(os, "orderbook_levels_destroyed_total", "counter",
+              "Price levels removed once empty.", levels_destroyed);
+  WriteMetric(os, "orderbook_resting_orders", "gauge",
+              "Orders resting across all books.", resting_orders);
+  WriteMetric(os, "orderbook_peak_levels", "gauge",
+              "Most price levels resting at once in any one book.",
+              peak_levels);
+}
+
+BookMetrics& MetricsRegistry::Register() {
+  std::lock_guard lock(mutex_);
+  blocks_.emplace_back(std::make_unique<BookMetrics>());
+  return *blocks_.back();
+}
+
+MetricsSnapshot MetricsRegistry::Aggregate() const {
+  std::lock_guard lock(mutex_);
+  MetricsSnapshot snapshot;
+  snapshot.books = blocks_.size();
+  for (const auto& block : blocks_) {
+    snapshot.limit_orders += block->limit_orders.Load();
+    snapshot.market_orders += block->market_orders.Load();
+    snapshot.stop_orders += block->stop_orders.Load();
+    snapshot.fills += block->fills.Load();
+    snapshot.cancels_hit += block->cancels_hit.Load();
+    snapshot.cancels_miss += block->cancels_miss.Load();
+    snapshot.mass_cancels += block->mass_cancels.Load();
+    snapshot.modifies += block->modifies.Load();
+    snapshot.stops_triggered += block->stops_triggered.Load();
+    snapshot.self_trades_prevented += block->self_trades_prevented.Load();
+    for (std::size_t i = 0; i < kRejectReasonCount; ++i) {
+      snapshot.rejects[i] += block->rejects[i].Load();
+    }
+    snapshot.levels_created += block->levels_created.Load();
+    snapshot.levels_destroyed += block->levels_destroyed.Load();
+    snapshot.resting_orders += block->resting_orders.Load();
+    snapshot.peak_levels =
+        std::max(snapshot.peak_levels, block->peak_levels.Load());
+  }
+  return snapshot;
+}
+
+MetricsExporter::MetricsExporter(const MetricsRegistry& registry,
+                                 MetricsExporterConfig config)
+    : registry_(registry), config_(std::move(config)) {}
+
+MetricsExporter::~MetricsExporter() { Stop(); }
+
+tl::expected<void, MetricsExportError> MetricsExporter::Start() {
+  if (!config_.socket_path.empty()) {
+    sockaddr_un addr{};
+    if (config_.socket_path.size() >= sizeof(addr.sun_path)) {
+      return tl::unexpected<MetricsExportError>(
+          MetricsExportError::kBindFailed);
+    }
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+      return tl::unexpected<MetricsExportError>(
+          MetricsExportError::kSocketFailed);
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, config_.socket_path.c_str(),
+                config_.socket_path.size() + 1);
+    // A stale socket file from an earlier run would make bind fail
+    unlink(config_.socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&addr),
+             sizeof(addr)) != 0 ||
+        listen(listen_fd_, 8) != 0) {
+      close(listen_fd_);
+      listen_fd_ = -1;
+      return tl::unexpected<MetricsExportError>(
+          MetricsExportError::kBindFailed);
+    }
+  }
+
+  running_.store(true, std::memory_order_release);
+  thread_ = std::thread([this] { Run(); });
+  return {};
+}
+
+void MetricsExporter::Stop() {
+  if (!running_.exchange(false, std::memory_order_acq_rel)) return;
+  thread_.join();
+  WriteFile();
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    listen_fd_ = -1;
+    unlink(config_.socket_path.c_str());
+  }
+}
+
+void MetricsExporter::Run() {
+  using Clock = std::chrono::steady_clock;
+  auto next_write = Clock::now();
+  while (running_.load(std::memory_order_acquire)) {
+    auto now = Clock::now();
+    if (now >= next_write) {
+      WriteFile();
+      next_write = now + config_.interval;
+    }
+    auto wait = std::min(
+        kPollSlice, std::chrono::duration_cast<std::chrono::milliseconds>(
+                        next_write - now));
+    if (listen_fd_ < 0) {
+      std::this_thread::sleep_for(wait);
+      continue;
+    }
+    pollfd pfd{.fd = listen_fd_, .events = POLLIN, .revents = 0};
+    if (poll(&pfd, 1, static_cast<int>(wait.count())) > 0 &&
+        (pfd.revents & POLLIN) != 0) {
+      ServeOne();
+    }
+  }
+}
+
+void MetricsExporter::WriteFile() {
+  if (config_.file_path.empty()) return;
+  const std::string tmp_path = config_.file_path + ".tmp";
+  {
+    std::ofstream out(tmp_path, std::ios::trunc);
+    if (!out.is_open()) return;
+    registry_.Aggregate().WritePrometheus(out);
+  }
+  std::rename(tmp_path.c_str(), config_.file_path.c_str());
+}
+
+// Answers one scrape. The request itself is not inspected: every path
+// returns the metrics.
+void MetricsExporter::ServeOne() {
+  int fd = accept(listen_fd_, nullptr, nullptr);
+  if (fd < 0) return;
+
+  char request[1024];
+  pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+  if (poll(&pfd, 1, static_cast<int>(kPollSlice.count())) > 0) {
+    [[maybe_unused]] auto ignored = read(fd, request, sizeof(request));
+  }
+
+  std::ostringstream body;
+  registry_.Aggregate().WritePrometheus(body);
+  const std::string text = body.str();
+  std::ostringstream response;
+  response << "HTTP/1.0 200 OK\r\n"
+           << "Content-Type: text/plain; version=0.0.4\r\n"
+           << "Content-Length: " << text.size() << "\r\n\r\n"
+           << text;
+  const std::string bytes = response.str();
+  std::size_t sent = 0;
+  while (sent < bytes.size()) {
+    auto n = send(fd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) break;
+    sent += static_cast<std::size_t>(n);
+  }
+  close(fd);
+}
+}  // namespace order_book_v1
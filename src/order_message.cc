@@ -0,0 +1,15 @@
+#include "../include/order_message.h"
+
+namespace order_book_v1 {
+BinaryOrderMessageWriter::BinaryOrderMessageWriter(std::ostream* dst)
+    : dst_(dst) {}
+
+void BinaryOrderMessageWriter::OnOrderMessage(const OrderMessage& message) {
+  dst_->write(reinterpret_cast<const char*>(&message), sizeof(OrderMessage));
+}
+
+bool ReadOrderMessage(std::istream& src, OrderMessage& message) {
+  src.read(reinterpret_cast<char*>(&message), sizeof(OrderMessage));
+  return src.gcount() == static_cast<std::streamsize>(sizeof(OrderMessage));
+}
+}  // namespace order_book_v1
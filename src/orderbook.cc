@@ -1,18 +1,40 @@
 #include "../include/orderbook.h"
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <expected/expected.hpp>
 #include <iterator>
+#include <list>
 #include <map>
 #include <optional>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
+#include <variant>
+
+#include "../include/trace.h"
+#include "../include/tsc_clock.h"
 
 namespace order_book_v1 {
-OrderBook::OrderBook(std::ostream* log_dst) : log_(EventLog{log_dst}) {}
+OrderBook::OrderBook(std::ostream* log_dst) : log_(EventLog{log_dst}) {
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  latency_.Enable();
+#endif
+}
 
 void OrderBook::EmitLimitOrderEvent(const Order& order) {
   if (log_.dst_stream() == nullptr) return;
+  if (order.display_qty != Quantity{0}) {
+    log_.AppendEvent(AddIcebergOrderEvent{
+        .creator_id = order.creator_id,
+        .side = order.side,
+        .qty = order.qty,
+        .price = order.price.value(),
+        .display_qty = order.display_qty,
+    });
+    return;
+  }
   log_.AppendEvent(AddLimitOrderEvent{
       .creator_id = order.creator_id,
       .side = order.side,
@@ -31,11 +53,131 @@ void OrderBook::EmitMarketOrderEvent(const Order& order) {
   });
 }
 
+void OrderBook::EmitStopOrderEvent(const Order& order, Price stop_price) {
+  if (log_.dst_stream() == nullptr) return;
+  log_.AppendEvent(AddStopOrderEvent{
+      .creator_id = order.creator_id,
+      .side = order.side,
+      .qty = order.qty,
+      .stop_price = stop_price,
+      .limit_price = order.price,
+  });
+}
+
 void OrderBook::EmitCancelEvent(OrderId id) {
   if (log_.dst_stream() == nullptr) return;
   log_.AppendEvent(CancelOrderEvent{.order_id = id});
 }
 
+void OrderBook::EmitModifyEvent(OrderId id, Quantity qty, Price price) {
+  if (log_.dst_stream() == nullptr) return;
+  log_.AppendEvent(
+      ModifyOrderEvent{.order_id = id, .qty = qty, .price = price});
+}
+
+void OrderBook::EmitSelfTradePreventionEvent(SelfTradePrevention mode) {
+  if (log_.dst_stream() == nullptr) return;
+  log_.AppendEvent(SetSelfTradePreventionEvent{.mode = mode});
+}
+
+void OrderBook::EmitCancelAllEvent(UserId user,
+                                   std::optional<OrderSide> side) {
+  if (log_.dst_stream() == nullptr) return;
+  log_.AppendEvent(CancelAllOrdersEvent{.user_id = user, .side = side});
+}
+
+void OrderBook::SetLevelDeltaSink(LevelDeltaSink* sink) {
+  delta_sink_ = sink;
+  pending_deltas_.clear();
+}
+
+// Coalesces with any earlier delta for the same level in the current event so
+// the sink only sees the final state of each level. The level keeps the slot
+// of its entry, so a level that is touched again costs O(1) however many
+// levels the event touches. Only a level created during the event has to
+// look for an entry left by one erased earlier at its price.
+void OrderBook::RecordLevelDelta(Level& level, OrderSide side, Price price) {
+  if (delta_sink_ == nullptr) return;
+  const Quantity aggregate_qty = level.aggregate_qty;
+  const bool removed = aggregate_qty == Quantity{0};
+  if (level.delta_slot == kNoDeltaSlot) {
+    for (std::size_t slot = 0; slot < pending_deltas_.size(); ++slot) {
+      const LevelDelta& pending = pending_deltas_[slot];
+      if (pending.removed && pending.side == side && pending.price == price) {
+        level.delta_slot = static_cast<uint32_t>(slot);
+        break;
+      }
+    }
+  }
+  if (level.delta_slot < pending_deltas_.size()) {
+    LevelDelta& pending = pending_deltas_[level.delta_slot];
+    if (pending.side == side && pending.price == price) {
+      pending.aggregate_qty = aggregate_qty;
+      pending.removed = removed;
+      return;
+    }
+  }
+  level.delta_slot = static_cast<uint32_t>(pending_deltas_.size());
+  pending_deltas_.emplace_back(LevelDelta{.side = side,
+                                          .price = price,
+                                          .aggregate_qty = aggregate_qty,
+                                          .removed = removed});
+}
+
+void OrderBook::SetOrderMessageSink(OrderMessageSink* sink) {
+  order_sink_ = sink;
+}
+
+static_assert(static_cast<std::size_t>(RejectReason::kUnknownOrder) + 1 ==
+              kRejectReasonCount);
+
+void OrderBook::SetMetrics(BookMetrics* metrics) {
+  metrics_ = metrics;
+  RefreshGauges();
+}
+
+void OrderBook::CountAdd(MetricCounter& orders, const AddResult& result) {
+  orders.Add();
+  if (result.has_value()) {
+    metrics_->fills.Add(result->immediate_trades.size() +
+                        result->triggered_trades.size());
+    metrics_->self_trades_prevented.Add(result->prevented_trades.size());
+  } else {
+    metrics_->rejects[static_cast<std::size_t>(result.error())].Add();
+  }
+  RefreshGauges();
+}
+
+void OrderBook::CountLevelErased() {
+  if (metrics_ != nullptr) metrics_->levels_destroyed.Add();
+}
+
+void OrderBook::RefreshGauges() {
+  if (metrics_ == nullptr) return;
+  metrics_->resting_orders.Set(order_id_index_.size());
+  metrics_->peak_levels.SetMax(bids_.size() + asks_.size());
+}
+
+void OrderBook::EmitOrderMessage(OrderMessageType type, const Order& order,
+                                 Quantity qty) {
+  if (order_sink_ == nullptr) return;
+  order_sink_->OnOrderMessage(OrderMessage{
+      .type = type,
+      .side = order.side,
+      .tif = order.tif.value_or(TimeInForce::kGoodTillCancel),
+      .order_id = order.id,
+      .user_id = order.creator_id,
+      .price = order.price.value_or(Price{0}),
+      .qty = qty,
+  });
+}
+
+void OrderBook::PublishLevelDeltas() {
+  if (delta_sink_ == nullptr || pending_deltas_.empty()) return;
+  delta_sink_->OnLevelDeltas(pending_deltas_);
+  pending_deltas_.clear();
+}
+
 Quantity OrderBook::DepthAt(OrderSide side, Price price) const {
   auto& book_side = side == OrderSide::kBuy ? bids_ : asks_;
   auto it = book_side.find(price);
@@ -43,65 +185,344 @@ Quantity OrderBook::DepthAt(OrderSide side, Price price) const {
   return it->second.aggregate_qty;
 }
 
+std::vector<LevelSummary> OrderBook::TopLevels(OrderSide side,
+                                              std::size_t depth) const {
+  std::vector<LevelSummary> levels;
+  auto collect = [&](auto begin, auto end) {
+    for (auto it = begin; it != end && levels.size() < depth; ++it) {
+      levels.emplace_back(LevelSummary{.price = it->first,
+                                       .qty = it->second.aggregate_qty,
+                                       .orders = it->second.orders.size()});
+    }
+  };
+  if (side == OrderSide::kBuy) {
+    collect(bids_.rbegin(), bids_.rend());
+  } else {
+    collect(asks_.begin(), asks_.end());
+  }
+  return levels;
+}
+
+namespace {
+// Mirrors of the libstdc++ node layouts, used only for their sizes
+struct MapNodeModel {
+  int color;
+  void* parent;
+  void* left;
+  void* right;
+  BookSide::value_type value;
+};
+struct ListNodeModel {
+  void* next;
+  void* prev;
+  Order value;
+};
+struct HashNodeModel {
+  void* next;
+  OrderIndex::value_type value;
+};
+struct UserNodeModel {
+  void* next;
+  UserIndex::value_type value;
+};
+
+// glibc malloc adds an 8-byte header, aligns to 16 and never returns a chunk
+// smaller than 32 bytes
+constexpr std::size_t MallocChunkBytes(std::size_t request) {
+  const std::size_t chunk = (request + 8 + 15) & ~std::size_t{15};
+  return chunk < 32 ? 32 : chunk;
+}
+}  // namespace
+
+BookMemoryStats OrderBook::MemoryStats() const {
+  BookMemoryStats stats;
+  stats.levels = bids_.size() + asks_.size();
+  stats.level_node_bytes =
+      stats.levels * MallocChunkBytes(sizeof(MapNodeModel));
+  stats.orders = order_id_index_.size();
+  stats.order_node_bytes =
+      stats.orders * MallocChunkBytes(sizeof(ListNodeModel));
+  stats.index_entries = order_id_index_.size();
+  stats.index_node_bytes =
+      stats.index_entries * MallocChunkBytes(sizeof(HashNodeModel));
+  stats.index_buckets = order_id_index_.bucket_count();
+  // A table with a single bucket uses storage inside the container
+  stats.index_bucket_bytes =
+      stats.index_buckets <= 1
+          ? 0
+          : MallocChunkBytes(stats.index_buckets * sizeof(void*));
+  stats.user_index_bytes =
+      user_orders_.size() * MallocChunkBytes(sizeof(UserNodeModel)) +
+      (user_orders_.bucket_count() <= 1
+           ? 0
+           : MallocChunkBytes(user_orders_.bucket_count() * sizeof(void*)));
+  stats.stop_orders = stop_index_.size();
+  stats.stop_bytes =
+      (buy_stops_.size() + sell_stops_.size()) *
+          MallocChunkBytes(sizeof(MapNodeModel)) +
+      stats.stop_orders * (MallocChunkBytes(sizeof(ListNodeModel)) +
+                           MallocChunkBytes(sizeof(HashNodeModel))) +
+      (stop_index_.bucket_count() <= 1
+           ? 0
+           : MallocChunkBytes(stop_index_.bucket_count() * sizeof(void*))) +
+      user_stops_.size() * MallocChunkBytes(sizeof(UserNodeModel)) +
+      (user_stops_.bucket_count() <= 1
+           ? 0
+           : MallocChunkBytes(user_stops_.bucket_count() * sizeof(void*)));
+  stats.scratch_bytes =
+      pending_deltas_.capacity() == 0
+          ? 0
+          : MallocChunkBytes(pending_deltas_.capacity() * sizeof(LevelDelta));
+  return stats;
+}
+
 std::optional<Price> OrderBook::BestBid() const {
   if (bids_.empty()) return std::nullopt;
   return bids_.rbegin()->first;
 }
 
+OrderId OrderBook::LastOrderId() const { return OrderId{order_id_}; }
+
 std::optional<Price> OrderBook::BestAsk() const {
   if (asks_.empty()) return std::nullopt;
   return asks_.begin()->first;
 }
 
+namespace {
+// Moves whatever an iceberg shows beyond its display size into its hidden
+// reserve. Ordinary orders are left alone.
+void HideReserve(Order& order) {
+  if (order.display_qty == Quantity{0} || order.qty <= order.display_qty) {
+    return;
+  }
+  order.hidden_qty += Quantity{order.qty.v - order.display_qty.v};
+  order.qty = order.display_qty;
+}
+
+// Pushes `handle` onto the front of `user_id`'s list in `lists`
+void LinkToUser(UserIndex& lists, UserId user_id, Handle& handle) {
+  Handle*& head = lists[user_id];
+  handle.user_next = head;
+  if (head != nullptr) head->user_pprev = &handle.user_next;
+  handle.user_pprev = &head;
+  head = &handle;
+}
+
+// Takes `handle` off `user_id`'s list and drops the list once it is empty
+void UnlinkFromUser(UserIndex& lists, UserId user_id, Handle& handle) {
+  *handle.user_pprev = handle.user_next;
+  if (handle.user_next != nullptr) {
+    handle.user_next->user_pprev = handle.user_pprev;
+  } else {
+    // Only the last order of a list can leave it empty
+    auto user_it = lists.find(user_id);
+    if (user_it->second == nullptr) lists.erase(user_it);
+  }
+}
+}  // namespace
+
 void OrderBook::AddOrderToBook(OrderSide side, BookSide* book_side, Price value,
                                const Order& order) {
   auto [level_it, inserted] = book_side->try_emplace(
       value, Level{.aggregate_qty = Quantity{0}, .orders = {}});
+  if (inserted && metrics_ != nullptr) metrics_->levels_created.Add();
 
   Level& level = level_it->second;
 
   level.orders.emplace_back(order);
   auto order_it = std::prev(level.orders.end());
+  HideReserve(*order_it);
 
-  level.aggregate_qty += order.qty;
+  level.aggregate_qty += order_it->qty;
+  RecordLevelDelta(level, side, value);
+  EmitOrderMessage(OrderMessageType::kAdd, *order_it, order_it->qty);
 
-  order_id_index_.emplace(
-      order.id,
-      Handle{.side = side, .level_it = level_it, .order_it = order_it});
+  ORDERBOOK_TRACE_SPAN("IndexInsert");
+  Handle& handle =
+      order_id_index_
+          .emplace(order.id, Handle{.side = side,
+                                    .level_it = level_it,
+                                    .order_it = order_it})
+          .first->second;
+  LinkToUser(user_orders_, order.creator_id, handle);
+}
+
+void OrderBook::EraseIndexEntry(OrderIndex::iterator handle_it,
+                                UserId user_id) {
+  UnlinkFromUser(user_orders_, user_id, handle_it->second);
+  order_id_index_.erase(handle_it);
+}
+
+void OrderBook::RemoveResting(OrderIndex::iterator handle_it) {
+  Handle& handle = handle_it->second;
+  auto level_it = handle.level_it;
+  Level& level = level_it->second;
+  const UserId user_id = handle.order_it->creator_id;
+
+  level.aggregate_qty -= handle.order_it->qty;
+  EmitOrderMessage(OrderMessageType::kDelete, *handle.order_it,
+                   handle.order_it->qty);
+  level.orders.erase(handle.order_it);
+  RecordLevelDelta(level, handle.side, level_it->first);
+  if (level.orders.empty()) {
+    ORDERBOOK_TRACE_SPAN("LevelErase");
+    BookSide* book_side = (handle.side == OrderSide::kBuy) ? &bids_ : &asks_;
+    book_side->erase(level_it);
+    CountLevelErased();
+  }
+
+  ORDERBOOK_TRACE_SPAN("IndexErase");
+  EraseIndexEntry(handle_it, user_id);
+}
+
+void OrderBook::RetireFront(Level& level) {
+  Order& front = level.orders.front();
+  if (front.hidden_qty != Quantity{0}) {
+    // The next slice joins the back of the queue. Splicing the node keeps
+    // the index entry's iterator valid, so nothing is allocated or rehashed.
+    ORDERBOOK_TRACE_SPAN("Replenish");
+    const Quantity slice = front.hidden_qty < front.display_qty
+                               ? front.hidden_qty
+                               : front.display_qty;
+    front.hidden_qty -= slice;
+    front.qty = slice;
+    level.aggregate_qty += slice;
+    level.orders.splice(level.orders.end(), level.orders,
+                        level.orders.begin());
+    EmitOrderMessage(OrderMessageType::kAdd, front, slice);
+    return;
+  }
+  ORDERBOOK_TRACE_SPAN("IndexErase");
+  auto handle_it = order_id_index_.find(front.id);
+  auto order_it = handle_it->second.order_it;
+  EraseIndexEntry(handle_it, front.creator_id);
+  level.orders.erase(order_it);
 }
 
 // Fills against the front order in level, updates book and trade log
 void OrderBook::Reduce(Level& level, Quantity& unfilled_qty, const Order& order,
-                       std::vector<Trade>& trades) {
+                       MatchResult& result) {
+  ORDERBOOK_TRACE_SPAN("Reduce");
   Order& first_in_level = level.orders.front();
+  // The only cost prevention adds to an ordinary fill is this compare
+  if (first_in_level.creator_id == order.creator_id &&
+      self_trade_prevention_ != SelfTradePrevention::kNone) [[unlikely]] {
+    PreventSelfTrade(level, unfilled_qty, order, result);
+    return;
+  }
+  const OrderSide maker_side = first_in_level.side;
+  const Price maker_price = first_in_level.price.value();
+  last_trade_price_ = maker_price;
+  if (maker_price < print_low_) print_low_ = maker_price;
+  if (maker_price > print_high_) print_high_ = maker_price;
   Quantity fill_amount =
       first_in_level.qty < unfilled_qty ? first_in_level.qty : unfilled_qty;
 
   first_in_level.qty -= fill_amount;
   level.aggregate_qty -= fill_amount;
   unfilled_qty -= fill_amount;
+  EmitOrderMessage(OrderMessageType::kExecute, first_in_level, fill_amount);
 
-  trades.emplace_back(Trade{
+  result.trades.emplace_back(Trade{
       .maker_id = first_in_level.creator_id,
       .taker_id = order.creator_id,
       .match_id = MatchId{++match_id_},
       .order_id = order.id,
       .qty = fill_amount,
-      .price = first_in_level.price.value(),
+      .price = maker_price,
+  });
+
+  if (first_in_level.qty == Quantity{0}) RetireFront(level);
+
+  RecordLevelDelta(level, maker_side, maker_price);
+}
+
+void OrderBook::PreventSelfTrade(Level& level, Quantity& unfilled_qty,
+                                 const Order& order, MatchResult& result) {
+  ORDERBOOK_TRACE_SPAN("PreventSelfTrade");
+  Order& resting = level.orders.front();
+  const OrderSide resting_side = resting.side;
+  const Price resting_price = resting.price.value();
+  const Quantity qty = resting.qty < unfilled_qty ? resting.qty : unfilled_qty;
+  const SelfTradePrevention mode = self_trade_prevention_;
+  result.prevented.emplace_back(PreventedTrade{
+      .user_id = order.creator_id,
+      .order_id = order.id,
+      .resting_order_id = resting.id,
+      .qty = qty,
+      .price = resting_price,
+      .action = mode,
   });
 
-  if (first_in_level.qty == Quantity{0}) {
-    Handle& handle = order_id_index_.at(first_in_level.id);
-    auto order_it = handle.order_it;
-    order_id_index_.erase(first_in_level.id);
-    level.orders.erase(order_it);
+  if (mode == SelfTradePrevention::kDecrement) {
+    resting.qty -= qty;
+    level.aggregate_qty -= qty;
+    unfilled_qty -= qty;
+    EmitOrderMessage(OrderMessageType::kReduce, resting, qty);
+    if (resting.qty == Quantity{0}) RetireFront(level);
+    RecordLevelDelta(level, resting_side, resting_price);
+  } else if (mode != SelfTradePrevention::kCancelNewest) {
+    // The resting order goes whole, an iceberg's reserve included
+    level.aggregate_qty -= resting.qty;
+    EmitOrderMessage(OrderMessageType::kDelete, resting, resting.qty);
+    resting.hidden_qty = Quantity{0};
+    RetireFront(level);
+    RecordLevelDelta(level, resting_side, resting_price);
+  }
+  if (mode == SelfTradePrevention::kCancelNewest ||
+      mode == SelfTradePrevention::kCancelBoth) {
+    // Ends the match with what is left of the taker marked as cancelled
+    result.unfilled = order;
+    result.unfilled->qty = unfilled_qty;
+    result.taker_cancelled = true;
+    unfilled_qty = Quantity{0};
   }
 }
 
+bool OrderBook::CanFillCompletely(OrderSide side, Price limit, Quantity qty,
+                                  UserId user_id) const {
+  // Counts down what is still missing, so summing deep levels can't overflow
+  Quantity missing = qty;
+  bool blocked = false;
+  auto covers = [&](const Level& level) {
+    if (self_trade_prevention_ == SelfTradePrevention::kNone) {
+      if (level.aggregate_qty >= missing) return true;
+      missing -= level.aggregate_qty;
+      return false;
+    }
+    // Cancel-oldest moves the user's own orders out of the way; every other
+    // mode would stop or shrink the order at the first one it meets
+    for (const Order& resting : level.orders) {
+      if (resting.creator_id == user_id) {
+        if (self_trade_prevention_ == SelfTradePrevention::kCancelOldest) {
+          continue;
+        }
+        blocked = true;
+        return true;
+      }
+      if (resting.qty >= missing) return true;
+      missing -= resting.qty;
+    }
+    return false;
+  };
+  if (side == OrderSide::kBuy) {
+    for (auto it = asks_.begin(); it != asks_.end() && it->first <= limit;
+         ++it) {
+      if (covers(it->second)) return !blocked;
+    }
+  } else {
+    for (auto it = bids_.rbegin(); it != bids_.rend() && it->first >= limit;
+         ++it) {
+      if (covers(it->second)) return !blocked;
+    }
+  }
+  return false;
+}
+
 MatchResult OrderBook::Match(OrderSide side, Price best_price,
                              const Order& order, bool is_market) {
-  std::vector<Trade> trades{};
-  std::optional<Order> unfilled{};
+  ORDERBOOK_TRACE_SPAN("Match");
+  MatchResult result{};
 
   BookSide* other_side = (side == OrderSide::kBuy) ? &asks_ : &bids_;
 
@@ -116,30 +537,66 @@ MatchResult OrderBook::Match(OrderSide side, Price best_price,
       if ((is_market || will_accept) && next_best.has_value()) {
         level = &other_side->at(next_best.value());
 
-        Reduce(*level, unfilled_qty, order, trades);
+        Reduce(*level, unfilled_qty, order, result);
         if (level->orders.empty()) {
+          ORDERBOOK_TRACE_SPAN("LevelErase");
           other_side->erase(next_best.value());
+          CountLevelErased();
         }
         continue;
       } else {
-        unfilled = order;
-        unfilled->qty = unfilled_qty;
+        result.unfilled = order;
+        result.unfilled->qty = unfilled_qty;
         break;
       }
     }
 
-    Reduce(*level, unfilled_qty, order, trades);
+    Reduce(*level, unfilled_qty, order, result);
     if (level->orders.empty()) {
+      ORDERBOOK_TRACE_SPAN("LevelErase");
       other_side->erase(best_price);
+      CountLevelErased();
     }
   }
 
-  return MatchResult{.trades = trades,
-                     .unfilled = unfilled,
-                     .filled_all = unfilled_qty == Quantity{0}};
+  result.filled_all = unfilled_qty == Quantity{0} && !result.taker_cancelled;
+  return result;
 }
 
-AddResult OrderBook::AddMarket(UserId user_id, OrderSide side, Quantity qty) {
+AddResult OrderBook::ExecuteMarket(const Order& order) {
+  auto best_value = (order.side == OrderSide::kBuy) ? BestAsk() : BestBid();
+  if (!best_value.has_value()) {
+    return tl::unexpected<RejectReason>(RejectReason::kEmptyBookForMarket);
+  }
+
+  MatchResult cross_match = Match(order.side, best_value.value(), order, true);
+
+#ifndef NDEBUG
+  Verify();
+#endif
+
+  // Whatever the opposite side could not fill is dropped
+  AddResultPayload result{
+      .order_id = order.id,
+      .status = OrderStatus::kImmediateFill,
+      .immediate_trades = std::move(cross_match.trades),
+      .remaining_qty = Quantity{0},
+      .triggered_trades = std::vector<Trade>{},
+      .prevented_trades = std::move(cross_match.prevented),
+  };
+  if (cross_match.unfilled.has_value()) {
+    // A market never rests, so one that self-trade prevention left untraded
+    // is still a partial fill, and a cancelled taker has nothing left
+    result.status = OrderStatus::kPartialFill;
+    if (!cross_match.taker_cancelled) {
+      result.remaining_qty = cross_match.unfilled->qty;
+    }
+  }
+  return result;
+}
+
+AddResult OrderBook::AddMarketImpl(UserId user_id, OrderSide side,
+                                   Quantity qty) {
   if (qty == Quantity{0}) {
     return tl::unexpected<RejectReason>(RejectReason::kBadQty);
   }
@@ -150,53 +607,77 @@ AddResult OrderBook::AddMarket(UserId user_id, OrderSide side, Quantity qty) {
                             .qty = qty,
                             .price = std::nullopt,
                             .tif = std::nullopt};
+  AddResult result = ExecuteMarket(order);
+  EmitMarketOrderEvent(order);
+  if (result.has_value()) ReleaseTriggeredStops(*result);
+  PublishLevelDeltas();
+  return result;
+}
+
+AddResultPayload OrderBook::ExecuteLimit(const Order& order) {
+  const OrderSide side = order.side;
+  const Price price = order.price.value();
+  auto* book_side = (side == OrderSide::kBuy) ? &bids_ : &asks_;
   auto best_value = (side == OrderSide::kBuy) ? BestAsk() : BestBid();
-  if (!best_value.has_value()) {
-    EmitMarketOrderEvent(order);
-    return tl::unexpected<RejectReason>(RejectReason::kEmptyBookForMarket);
-  }
 
   MatchResult cross_match{};
-  if (side == OrderSide::kBuy) {
-    cross_match = Match(side, best_value.value(), order, true);
-  } else if (side == OrderSide::kSell) {
-    cross_match = Match(side, best_value.value(), order, true);
+  if (side == OrderSide::kBuy && best_value.has_value() &&
+      price >= best_value.value()) {
+    cross_match = Match(side, best_value.value(), order, false);
+  } else if (side == OrderSide::kSell && best_value.has_value() &&
+             price <= best_value.value()) {
+    cross_match = Match(side, best_value.value(), order, false);
   }
 
+  // A fill-or-kill that got here fills completely, so it never has one
+  bool discard_remainder = order.tif != TimeInForce::kGoodTillCancel ||
+                           cross_match.taker_cancelled;
+  AddResultPayload result{
+      .order_id = order.id,
+      .status = OrderStatus::kAwaitingFill,
+      .immediate_trades = std::move(cross_match.trades),
+      .remaining_qty = discard_remainder ? Quantity{0} : order.qty,
+      .triggered_trades = std::vector<Trade>{},
+      .prevented_trades = std::move(cross_match.prevented),
+  };
   if (cross_match.unfilled.has_value()) {
-    EmitMarketOrderEvent(order);
-    return AddResultPayload{
-        .order_id = order.id,
-        .status = OrderStatus::kPartialFill,
-        .immediate_trades = cross_match.trades,
-        .remaining_qty = cross_match.unfilled->qty,
-    };
+    if (!discard_remainder) {
+      AddOrderToBook(side, book_side, price, cross_match.unfilled.value());
+      result.remaining_qty = cross_match.unfilled->qty;
+    }
+    // Only self-trade prevention can leave a crossing order untraded
+    result.status = result.immediate_trades.empty()
+                        ? OrderStatus::kAwaitingFill
+                        : OrderStatus::kPartialFill;
   } else if (cross_match.filled_all) {
-    EmitMarketOrderEvent(order);
-    return AddResultPayload{
-        .order_id = order.id,
-        .status = OrderStatus::kImmediateFill,
-        .immediate_trades = cross_match.trades,
-        .remaining_qty = Quantity{0},
-    };
+    result.status = OrderStatus::kImmediateFill;
+    result.remaining_qty = Quantity{0};
+  } else if (!discard_remainder) {
+    AddOrderToBook(side, book_side, price, order);
   }
 
 #ifndef NDEBUG
   Verify();
 #endif
 
-  EmitMarketOrderEvent(order);
-  return tl::unexpected<RejectReason>(RejectReason::kEmptyBookForMarket);
+  return result;
 }
 
-AddResult OrderBook::AddLimit(UserId user_id, OrderSide side, Price price,
-                              Quantity qty, TimeInForce tif) {
+AddResult OrderBook::AddLimitImpl(UserId user_id, OrderSide side, Price price,
+                                  Quantity qty, TimeInForce tif,
+                                  Quantity display_qty) {
   if (qty == Quantity{0}) {
     return tl::unexpected<RejectReason>(RejectReason::kBadQty);
   }
   if (price == Price{0}) {
     return tl::unexpected<RejectReason>(RejectReason::kBadPrice);
   }
+  // Decided before an id is taken or anything is written, so a killed order
+  // leaves no trace in the book, the feeds or the journal
+  if (tif == TimeInForce::kFillOrKill &&
+      !CanFillCompletely(side, price, qty, user_id)) {
+    return tl::unexpected<RejectReason>(RejectReason::kInsufficientLiquidity);
+  }
 
   auto const& order = Order{
       .id = OrderId{++order_id_},
@@ -205,98 +686,509 @@ AddResult OrderBook::AddLimit(UserId user_id, OrderSide side, Price price,
       .qty = qty,
       .price = price,
       .tif = tif,
+      .display_qty = display_qty,
   };
+  AddResultPayload result = ExecuteLimit(order);
+  EmitLimitOrderEvent(order);
+  ReleaseTriggeredStops(result);
+  PublishLevelDeltas();
+  return result;
+}
 
-  auto* book_side = (side == OrderSide::kBuy) ? &bids_ : &asks_;
-  auto best_value = (side == OrderSide::kBuy) ? BestAsk() : BestBid();
+bool OrderBook::StopTriggered(OrderSide side, Price stop_price) const {
+  // Nothing has traded yet, so nothing can have been reached
+  if (last_trade_price_ == Price{0}) return false;
+  return side == OrderSide::kBuy ? last_trade_price_ >= stop_price
+                                 : last_trade_price_ <= stop_price;
+}
 
-  MatchResult cross_match{};
-  if (side == OrderSide::kBuy && best_value.has_value() &&
-      order.price >= best_value.value()) {
-    cross_match = Match(side, best_value.value(), order, false);
-  } else if (side == OrderSide::kSell && best_value.has_value() &&
-             order.price <= best_value.value()) {
-    cross_match = Match(side, best_value.value(), order, false);
+void OrderBook::RemoveStop(OrderIndex::iterator handle_it) {
+  Handle& handle = handle_it->second;
+  Level& level = handle.level_it->second;
+  UnlinkFromUser(user_stops_, handle.order_it->creator_id, handle);
+  level.aggregate_qty -= handle.order_it->qty;
+  level.orders.erase(handle.order_it);
+  if (level.orders.empty()) {
+    ((handle.side == OrderSide::kBuy) ? buy_stops_ : sell_stops_)
+        .erase(handle.level_it);
   }
+  stop_index_.erase(handle_it);
+}
 
-  bool discard_remainder = tif == TimeInForce::kImmediateOrCancel;
-  if (cross_match.unfilled.has_value()) {
-    if (!discard_remainder) {
-      AddOrderToBook(side, book_side, price, cross_match.unfilled.value());
+// No waiting stop has been reached between calls, so only the lowest buy
+// stop and the highest sell stop can have been by the prints since. A sweep
+// can print on both sides of a stop and end past it, so each is checked
+// against the highest and lowest print rather than the last one. Checking
+// them is O(1) however many stops wait. Every release may trade and widen
+// the range again, so both ends are looked at afresh each time; buys go
+// before sells if both have been reached.
+void OrderBook::ReleaseTriggeredStops(AddResultPayload& result) {
+  while (true) {
+    BookSide::iterator level_it;
+    if (!buy_stops_.empty() && print_high_ >= buy_stops_.begin()->first) {
+      level_it = buy_stops_.begin();
+    } else if (!sell_stops_.empty() &&
+               print_low_ <= std::prev(sell_stops_.end())->first) {
+      level_it = std::prev(sell_stops_.end());
+    } else {
+      print_low_ = kNoPrintLow;
+      print_high_ = Price{0};
+      return;
+    }
+
+    ORDERBOOK_TRACE_SPAN("ReleaseStop");
+    const Order order = level_it->second.orders.front();
+    RemoveStop(stop_index_.find(order.id));
+    if (metrics_ != nullptr) metrics_->stops_triggered.Add();
+
+    // A stop-market that finds the other side empty has nothing to do
+    AddResult released = order.price.has_value() ? ExecuteLimit(order)
+                                                 : ExecuteMarket(order);
+    if (released.has_value()) {
+      result.triggered_trades.insert(result.triggered_trades.end(),
+                                     released->immediate_trades.begin(),
+                                     released->immediate_trades.end());
+      result.prevented_trades.insert(result.prevented_trades.end(),
+                                     released->prevented_trades.begin(),
+                                     released->prevented_trades.end());
     }
-    EmitLimitOrderEvent(order);
-    return AddResultPayload{
-        .order_id = order.id,
-        .status = OrderStatus::kPartialFill,
-        .immediate_trades = cross_match.trades,
-        .remaining_qty =
-            discard_remainder ? Quantity{0} : cross_match.unfilled->qty,
-    };
-  } else if (cross_match.filled_all) {
-    EmitLimitOrderEvent(order);
-    return AddResultPayload{
-        .order_id = order.id,
-        .status = OrderStatus::kImmediateFill,
-        .immediate_trades = cross_match.trades,
-        .remaining_qty = Quantity{0},
-    };
   }
+}
 
-  if (!discard_remainder) {
-    AddOrderToBook(side, book_side, price, order);
+AddResult OrderBook::AddStopImpl(UserId user_id, OrderSide side,
+                                 Price stop_price, Quantity qty,
+                                 std::optional<Price> limit_price) {
+  if (qty == Quantity{0}) {
+    return tl::unexpected<RejectReason>(RejectReason::kBadQty);
+  }
+  if (stop_price == Price{0} ||
+      (limit_price.has_value() && limit_price.value() == Price{0})) {
+    return tl::unexpected<RejectReason>(RejectReason::kBadPrice);
   }
 
-#ifndef NDEBUG
-  Verify();
-#endif
+  // A stop-limit becomes a GTC limit, a plain stop a market order
+  auto const& order = Order{
+      .id = OrderId{++order_id_},
+      .creator_id = user_id,
+      .side = side,
+      .qty = qty,
+      .price = limit_price,
+      .tif = limit_price.has_value()
+                 ? std::optional(TimeInForce::kGoodTillCancel)
+                 : std::nullopt,
+  };
 
-  EmitLimitOrderEvent(order);
-  return AddResultPayload{
+  AddResult result = AddResultPayload{
       .order_id = order.id,
       .status = OrderStatus::kAwaitingFill,
       .immediate_trades = std::vector<Trade>{},
-      .remaining_qty = discard_remainder ? Quantity{0} : Quantity{order.qty},
+      .remaining_qty = qty,
+      .triggered_trades = std::vector<Trade>{},
+      .prevented_trades = std::vector<PreventedTrade>{},
   };
+  if (StopTriggered(side, stop_price)) {
+    result = order.price.has_value() ? ExecuteLimit(order)
+                                     : ExecuteMarket(order);
+  } else {
+    BookSide& stops = (side == OrderSide::kBuy) ? buy_stops_ : sell_stops_;
+    auto level_it =
+        stops.try_emplace(stop_price, Level{.aggregate_qty = Quantity{0},
+                                            .orders = {}})
+            .first;
+    Level& level = level_it->second;
+    level.orders.emplace_back(order);
+    level.aggregate_qty += qty;
+    Handle& handle =
+        stop_index_
+            .emplace(order.id,
+                     Handle{.side = side,
+                            .level_it = level_it,
+                            .order_it = std::prev(level.orders.end())})
+            .first->second;
+    LinkToUser(user_stops_, user_id, handle);
+  }
+
+  EmitStopOrderEvent(order, stop_price);
+  if (result.has_value()) ReleaseTriggeredStops(*result);
+  PublishLevelDeltas();
+  return result;
 }
 
-bool OrderBook::Cancel(OrderId id) {
+bool OrderBook::CancelImpl(OrderId id) {
   EmitCancelEvent(id);
   auto handle_it = order_id_index_.find(id);
   if (handle_it == order_id_index_.end()) {
-    return false;
+    // Not in the book, but it may be a stop waiting for its trigger
+    auto stop_it = stop_index_.find(id);
+    if (stop_it == stop_index_.end()) return false;
+    RemoveStop(stop_it);
+    return true;
+  }
+  RemoveResting(handle_it);
+#ifndef NDEBUG
+  Verify();
+#endif
+
+  PublishLevelDeltas();
+  return true;
+}
+
+std::size_t OrderBook::CancelAllForUserImpl(UserId user_id,
+                                            std::optional<OrderSide> side) {
+  EmitCancelAllEvent(user_id, side);
+  auto user_it = user_orders_.find(user_id);
+  std::size_t cancelled = 0;
+  if (user_it != user_orders_.end()) {
+    Handle* handle = user_it->second;
+    while (handle != nullptr) {
+      // Read before the order is removed, which unlinks it
+      Handle* next = handle->user_next;
+      if (!side.has_value() || handle->side == side.value()) {
+        RemoveResting(order_id_index_.find(handle->order_it->id));
+        ++cancelled;
+      }
+      handle = next;
+    }
+  }
+  auto stops_it = user_stops_.find(user_id);
+  if (stops_it != user_stops_.end()) {
+    Handle* handle = stops_it->second;
+    while (handle != nullptr) {
+      Handle* next = handle->user_next;
+      if (!side.has_value() || handle->side == side.value()) {
+        RemoveStop(stop_index_.find(handle->order_it->id));
+        ++cancelled;
+      }
+      handle = next;
+    }
+  }
+
+#ifndef NDEBUG
+  Verify();
+#endif
+
+  PublishLevelDeltas();
+  return cancelled;
+}
+
+AddResult OrderBook::ModifyImpl(OrderId id, Quantity qty, Price price) {
+  if (qty == Quantity{0}) {
+    return tl::unexpected<RejectReason>(RejectReason::kBadQty);
+  }
+  if (price == Price{0}) {
+    return tl::unexpected<RejectReason>(RejectReason::kBadPrice);
+  }
+  EmitModifyEvent(id, qty, price);
+  auto handle_it = order_id_index_.find(id);
+  if (handle_it == order_id_index_.end()) {
+    return tl::unexpected<RejectReason>(RejectReason::kUnknownOrder);
   }
   Handle& handle = handle_it->second;
-  auto& level_it = handle.level_it;
-  Level& level = level_it->second;
+  const OrderSide side = handle.side;
+  const Price old_price = handle.level_it->first;
+  Level& old_level = handle.level_it->second;
+  Order& order = *handle.order_it;
 
-  level.aggregate_qty -= handle.order_it->qty;
-  level.orders.erase(handle.order_it);
-  if (level.orders.empty()) {
-    BookSide* book_side = (handle.side == OrderSide::kBuy) ? &bids_ : &asks_;
-    book_side->erase(level_it);
+  // `qty` is the new open quantity, an iceberg's hidden reserve included
+  const Quantity open = order.qty + order.hidden_qty;
+  if (price == old_price) {
+    // The book is not crossed, so the order still can't trade here
+    if (qty < open) {
+      // Hidden quantity goes first, so a reduction only shows on the feed
+      // once it eats into the shown slice
+      Quantity removed{open.v - qty.v};
+      const Quantity from_hidden =
+          order.hidden_qty < removed ? order.hidden_qty : removed;
+      order.hidden_qty -= from_hidden;
+      removed -= from_hidden;
+      if (removed != Quantity{0}) {
+        order.qty -= removed;
+        old_level.aggregate_qty -= removed;
+        EmitOrderMessage(OrderMessageType::kReduce, order, removed);
+      }
+    } else if (open < qty) {
+      EmitOrderMessage(OrderMessageType::kDelete, order, order.qty);
+      old_level.aggregate_qty -= order.qty;
+      order.qty += Quantity{qty.v - open.v};
+      HideReserve(order);
+      old_level.aggregate_qty += order.qty;
+      old_level.orders.splice(old_level.orders.end(), old_level.orders,
+                              handle.order_it);
+      EmitOrderMessage(OrderMessageType::kAdd, order, order.qty);
+    }
+    RecordLevelDelta(old_level, side, price);
+#ifndef NDEBUG
+    Verify();
+#endif
+    PublishLevelDeltas();
+    return AddResultPayload{
+        .order_id = id,
+        .status = OrderStatus::kAwaitingFill,
+        .immediate_trades = std::vector<Trade>{},
+        .remaining_qty = qty,
+        .triggered_trades = std::vector<Trade>{},
+        .prevented_trades = std::vector<PreventedTrade>{},
+    };
+  }
+
+  // The list node is moved out and back in rather than freed and allocated
+  // again, and the index entry is updated in place
+  EmitOrderMessage(OrderMessageType::kDelete, order, order.qty);
+  old_level.aggregate_qty -= order.qty;
+  RecordLevelDelta(old_level, side, old_price);
+  std::list<Order> detached;
+  detached.splice(detached.end(), old_level.orders, handle.order_it);
+  if (old_level.orders.empty()) {
+    ORDERBOOK_TRACE_SPAN("LevelErase");
+    ((side == OrderSide::kBuy) ? bids_ : asks_).erase(handle.level_it);
+    CountLevelErased();
+  }
+  // Like any arriving limit, the whole quantity may trade
+  order.qty = qty;
+  order.hidden_qty = Quantity{0};
+  order.price = price;
+
+  auto best_value = (side == OrderSide::kBuy) ? BestAsk() : BestBid();
+  MatchResult cross_match{};
+  if (best_value.has_value() && (side == OrderSide::kBuy
+                                     ? price >= best_value.value()
+                                     : price <= best_value.value())) {
+    cross_match = Match(side, best_value.value(), order, false);
+  }
+
+  const Quantity remaining =
+      cross_match.filled_all || cross_match.taker_cancelled
+          ? Quantity{0}
+          : cross_match.unfilled.value_or(order).qty;
+  if (remaining == Quantity{0}) {
+    ORDERBOOK_TRACE_SPAN("IndexErase");
+    EraseIndexEntry(handle_it, order.creator_id);
+  } else {
+    order.qty = remaining;
+    HideReserve(order);
+    BookSide& book_side = (side == OrderSide::kBuy) ? bids_ : asks_;
+    auto [level_it, inserted] = book_side.try_emplace(
+        price, Level{.aggregate_qty = Quantity{0}, .orders = {}});
+    if (inserted && metrics_ != nullptr) metrics_->levels_created.Add();
+    Level& level = level_it->second;
+    level.orders.splice(level.orders.end(), detached, handle.order_it);
+    level.aggregate_qty += order.qty;
+    handle.level_it = level_it;
+    RecordLevelDelta(level, side, price);
+    EmitOrderMessage(OrderMessageType::kAdd, order, order.qty);
   }
 
-  order_id_index_.erase(handle_it);
 #ifndef NDEBUG
   Verify();
 #endif
 
-  return true;
+  OrderStatus status = OrderStatus::kAwaitingFill;
+  if (cross_match.filled_all) {
+    status = OrderStatus::kImmediateFill;
+  } else if (!cross_match.trades.empty()) {
+    status = OrderStatus::kPartialFill;
+  }
+  AddResultPayload result{
+      .order_id = id,
+      .status = status,
+      .immediate_trades = std::move(cross_match.trades),
+      .remaining_qty = remaining,
+      .triggered_trades = std::vector<Trade>{},
+      .prevented_trades = std::move(cross_match.prevented),
+  };
+  ReleaseTriggeredStops(result);
+  PublishLevelDeltas();
+  return result;
 }
 
-FixedWidth OrderBook::ToHash() {
-  BookSide const& bids = bids_;
-  BookSide const& asks = asks_;
+namespace {
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+LatencyKind AddOutcome(const AddResult& result, bool is_market) {
+  if (!result.has_value()) {
+    return is_market ? LatencyKind::kMarketRejected
+                     : LatencyKind::kLimitRejected;
+  }
+  switch (result->status) {
+    case OrderStatus::kImmediateFill:
+      return is_market ? LatencyKind::kMarketFilled : LatencyKind::kLimitFilled;
+    case OrderStatus::kPartialFill:
+      return is_market ? LatencyKind::kMarketPartial
+                       : LatencyKind::kLimitPartial;
+    case OrderStatus::kAwaitingFill:
+      // Only limits rest, so never file a market under them
+      return is_market ? LatencyKind::kMarketPartial
+                       : LatencyKind::kLimitRested;
+    case OrderStatus::kRejected:
+      break;
+  }
+  return is_market ? LatencyKind::kMarketRejected : LatencyKind::kLimitRejected;
+}
+#endif
+}  // namespace
+
+// The public entry points only add timing and counting around the matching
+// paths
+AddResult OrderBook::AddLimit(UserId user_id, OrderSide side, Price price,
+                              Quantity qty, TimeInForce tif) {
+  ORDERBOOK_TRACE_SPAN("AddLimit");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  auto result = AddLimitImpl(user_id, side, price, qty, tif);
+  latency_.Record(AddOutcome(result, false), TscClock::Now() - start);
+#else
+  auto result = AddLimitImpl(user_id, side, price, qty, tif);
+#endif
+  if (metrics_ != nullptr) CountAdd(metrics_->limit_orders, result);
+  return result;
+}
+
+AddResult OrderBook::AddIceberg(UserId user_id, OrderSide side, Price price,
+                                Quantity qty, Quantity display_qty) {
+  ORDERBOOK_TRACE_SPAN("AddIceberg");
+  if (display_qty == Quantity{0}) {
+    AddResult result = tl::unexpected<RejectReason>(RejectReason::kBadQty);
+    if (metrics_ != nullptr) CountAdd(metrics_->limit_orders, result);
+    return result;
+  }
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  auto result = AddLimitImpl(user_id, side, price, qty,
+                             TimeInForce::kGoodTillCancel, display_qty);
+  latency_.Record(AddOutcome(result, false), TscClock::Now() - start);
+#else
+  auto result = AddLimitImpl(user_id, side, price, qty,
+                             TimeInForce::kGoodTillCancel, display_qty);
+#endif
+  if (metrics_ != nullptr) CountAdd(metrics_->limit_orders, result);
+  return result;
+}
+
+AddResult OrderBook::AddMarket(UserId user_id, OrderSide side, Quantity qty) {
+  ORDERBOOK_TRACE_SPAN("AddMarket");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  auto result = AddMarketImpl(user_id, side, qty);
+  latency_.Record(AddOutcome(result, true), TscClock::Now() - start);
+#else
+  auto result = AddMarketImpl(user_id, side, qty);
+#endif
+  if (metrics_ != nullptr) CountAdd(metrics_->market_orders, result);
+  return result;
+}
+
+AddResult OrderBook::AddStop(UserId user_id, OrderSide side, Price stop_price,
+                             Quantity qty, std::optional<Price> limit_price) {
+  ORDERBOOK_TRACE_SPAN("AddStop");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  auto result = AddStopImpl(user_id, side, stop_price, qty, limit_price);
+  latency_.Record(LatencyKind::kStop, TscClock::Now() - start);
+#else
+  auto result = AddStopImpl(user_id, side, stop_price, qty, limit_price);
+#endif
+  if (metrics_ != nullptr) CountAdd(metrics_->stop_orders, result);
+  return result;
+}
+
+bool OrderBook::Cancel(OrderId order_id) {
+  ORDERBOOK_TRACE_SPAN("Cancel");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  bool hit = CancelImpl(order_id);
+  latency_.Record(hit ? LatencyKind::kCancelHit : LatencyKind::kCancelMiss,
+                  TscClock::Now() - start);
+#else
+  bool hit = CancelImpl(order_id);
+#endif
+  if (metrics_ != nullptr) {
+    (hit ? metrics_->cancels_hit : metrics_->cancels_miss).Add();
+    RefreshGauges();
+  }
+  return hit;
+}
+
+std::size_t OrderBook::CancelAllForUser(UserId user_id,
+                                        std::optional<OrderSide> side) {
+  ORDERBOOK_TRACE_SPAN("CancelAllForUser");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  std::size_t cancelled = CancelAllForUserImpl(user_id, side);
+  latency_.Record(LatencyKind::kCancelAll, TscClock::Now() - start);
+#else
+  std::size_t cancelled = CancelAllForUserImpl(user_id, side);
+#endif
+  if (metrics_ != nullptr) {
+    metrics_->mass_cancels.Add();
+    metrics_->cancels_hit.Add(cancelled);
+    RefreshGauges();
+  }
+  return cancelled;
+}
+
+AddResult OrderBook::Modify(OrderId order_id, Quantity qty, Price price) {
+  ORDERBOOK_TRACE_SPAN("Modify");
+#ifdef ORDERBOOK_LATENCY_HISTOGRAMS
+  const uint64_t start = TscClock::Now();
+  auto result = ModifyImpl(order_id, qty, price);
+  latency_.Record(LatencyKind::kModify, TscClock::Now() - start);
+#else
+  auto result = ModifyImpl(order_id, qty, price);
+#endif
+  if (metrics_ != nullptr) CountAdd(metrics_->modifies, result);
+  return result;
+}
+
+void OrderBook::SetSelfTradePrevention(SelfTradePrevention mode) {
+  EmitSelfTradePreventionEvent(mode);
+  self_trade_prevention_ = mode;
+}
+
+LatencySnapshot OrderBook::SnapshotLatency() const {
+  return latency_.Snapshot();
+}
+
+void OrderBook::ResetLatency() { latency_.Reset(); }
+
+void OrderBook::Apply(const OrderBookEvent& event) {
+  std::visit(
+      [this](const auto& e) {
+        using T = std::decay_t<decltype(e)>;
+        if constexpr (std::is_same_v<T, AddLimitOrderEvent>) {
+          static_cast<void>(
+              AddLimit(e.creator_id, e.side, e.price.value_or(Price{0}), e.qty,
+                       e.tif.value_or(TimeInForce::kGoodTillCancel)));
+        } else if constexpr (std::is_same_v<T, AddMarketOrderEvent>) {
+          static_cast<void>(AddMarket(e.creator_id, e.side, e.qty));
+        } else if constexpr (std::is_same_v<T, CancelOrderEvent>) {
+          Cancel(e.order_id);
+        } else if constexpr (std::is_same_v<T, ModifyOrderEvent>) {
+          static_cast<void>(Modify(e.order_id, e.qty, e.price));
+        } else if constexpr (std::is_same_v<T, CancelAllOrdersEvent>) {
+          CancelAllForUser(e.user_id, e.side);
+        } else if constexpr (std::is_same_v<T, AddIcebergOrderEvent>) {
+          static_cast<void>(
+              AddIceberg(e.creator_id, e.side, e.price, e.qty, e.display_qty));
+        } else if constexpr (std::is_same_v<T, AddStopOrderEvent>) {
+          static_cast<void>(AddStop(e.creator_id, e.side, e.stop_price, e.qty,
+                                    e.limit_price));
+        } else if constexpr (std::is_same_v<T, SetSelfTradePreventionEvent>) {
+          SetSelfTradePrevention(e.mode);
+        }
+      },
+      event);
+}
+
+FixedWidth HashBook(const BookSide& bids, const BookSide& asks) {
   FixedWidth seed = HASH_SEED;
 
-  for (auto [price, level] : bids) {
-    for (auto order : level.orders) {
+  for (const auto& [price, level] : bids) {
+    for (const auto& order : level.orders) {
       HashOrder(seed, order);
     }
     HashCombine(seed, level.aggregate_qty.v);
   }
-  for (auto [price, level] : asks) {
-    for (auto order : level.orders) {
+  for (const auto& [price, level] : asks) {
+    for (const auto& order : level.orders) {
       HashOrder(seed, order);
     }
     HashCombine(seed, level.aggregate_qty.v);
@@ -305,8 +1197,10 @@ FixedWidth OrderBook::ToHash() {
   return seed;
 }
 
+FixedWidth OrderBook::ToHash() { return HashBook(bids_, asks_); }
+
 #ifndef NDEBUG
-void VerifyAggregateQtyPerLevel(BookSide book_side) {
+void VerifyAggregateQtyPerLevel(const BookSide& book_side) {
   for (auto const& [price, level] : book_side) {
     Quantity level_qty_sum{};
 
@@ -319,14 +1213,33 @@ void VerifyAggregateQtyPerLevel(BookSide book_side) {
   }
 }
 
-void VerifyNoEmptyLevelsOrEmptyOrders(BookSide book_side) {
+void VerifyNoEmptyLevelsOrEmptyOrders(const BookSide& book_side) {
   for (auto const& [price, level] : book_side) {
     assert(!level.orders.empty());
 
     for (auto const order : level.orders) {
       assert(order.qty != Quantity{0});
+      // A hidden reserve only ever backs an iceberg's shown slice
+      assert(order.hidden_qty == Quantity{0} ||
+             (order.display_qty != Quantity{0} &&
+              order.qty <= order.display_qty));
+    }
+  }
+}
+
+// Every list is non-empty and holds only its user's orders. Returns how many
+// orders are linked.
+std::size_t VerifyUserLists(const UserIndex& lists) {
+  std::size_t linked = 0;
+  for (const auto& [user, head] : lists) {
+    assert(head != nullptr);
+    for (const Handle* handle = head; handle != nullptr;
+         handle = handle->user_next) {
+      assert(handle->order_it->creator_id == user);
+      ++linked;
     }
   }
+  return linked;
 }
 
 void OrderBook::Verify() const {
@@ -335,6 +1248,21 @@ void OrderBook::Verify() const {
 
   VerifyNoEmptyLevelsOrEmptyOrders(bids_);
   VerifyNoEmptyLevelsOrEmptyOrders(asks_);
+
+  // Every resting order is on exactly its owner's list
+  assert(VerifyUserLists(user_orders_) == order_id_index_.size());
+
+  // And so is every waiting stop, on a list of its own
+  assert(VerifyUserLists(user_stops_) == stop_index_.size());
+  VerifyAggregateQtyPerLevel(buy_stops_);
+  VerifyAggregateQtyPerLevel(sell_stops_);
+  std::size_t stops = 0;
+  for (const BookSide* stop_side : {&buy_stops_, &sell_stops_}) {
+    for (const auto& [stop_price, level] : *stop_side) {
+      stops += level.orders.size();
+    }
+  }
+  assert(stops == stop_index_.size());
 }
 #endif
 }  // namespace order_book_v1
@@ -0,0 +1,363 @@
+#include "../include/shm_transport.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <new>
+#include <thread>
+#include <utility>
+
+namespace order_book_v1 {
+namespace {
+constexpr uint32_t kShmMagic = 0x4F42314D;  // "OB1M"
+constexpr std::size_t kLayoutSize = sizeof(ShmChannelLayout);
+
+std::string ShmPath(std::string_view name) {
+  return std::string("/dev/shm/").append(name);
+}
+
+void* MapFd(int fd) {
+  void* addr =
+      mmap(nullptr, kLayoutSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  return addr == MAP_FAILED ? nullptr : addr;
+}
+}  // namespace
+
+tl::expected<ShmMapping, ShmError> ShmMapping::Create(std::string_view name) {
+  std::string path = ShmPath(name);
+  int fd = open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) return tl::unexpected<ShmError>(ShmError::kOpenFailed);
+
+  if (ftruncate(fd, static_cast<off_t>(kLayoutSize)) != 0) {
+    close(fd);
+    unlink(path.c_str());
+    return tl::unexpected<ShmError>(ShmError::kResizeFailed);
+  }
+  void* addr = MapFd(fd);
+  close(fd);
+  if (addr == nullptr) {
+    unlink(path.c_str());
+    return tl::unexpected<ShmError>(ShmError::kMapFailed);
+  }
+
+  ShmMapping mapping;
+  mapping.layout_ = new (addr) ShmChannelLayout{};
+  mapping.path_ = std::move(path);
+  mapping.owner_ = true;
+  mapping.layout_->magic.store(kShmMagic, std::memory_order_release);
+  return mapping;
+}
+
+tl::expected<ShmMapping, ShmError> ShmMapping::Open(std::string_view name) {
+  std::string path = ShmPath(name);
+  int fd = open(path.c_str(), O_RDWR);
+  if (fd < 0) return tl::unexpected<ShmError>(ShmError::kOpenFailed);
+
+  struct stat st {};
+  if (fstat(fd, &st) != 0 ||
+      static_cast<std::size_t>(st.st_size) != kLayoutSize) {
+    close(fd);
+    return tl::unexpected<ShmError>(ShmError::kBadLayout);
+  }
+  void* addr = MapFd(fd);
+  close(fd);
+  if (addr == nullptr) return tl::unexpected<ShmError>(ShmError::kMapFailed);
+
+  ShmMapping mapping;
+  mapping.layout_ = static_cast<ShmChannelLayout*>(addr);
+  mapping.path_ = std::move(path);
+  if (mapping.layout_->magic.load(std::memory_order_acquire) != kShmMagic) {
+    return tl::unexpected<ShmError>(ShmError::kBadLayout);
+  }
+  return mapping;
+}
+
+ShmMapping::ShmMapping(ShmMapping&& other) noexcept
+    : layout_(std::exchange(other.layout_, nullptr)),
+      path_(std::move(other.path_)),
+      owner_(std::exchange(other.owner_, false)) {}
+
+ShmMapping& ShmMapping::operator=(ShmMapping&& other) noexcept {
+  if (this != &other) {
+    Release();
+    layout_ = std::exchange(other.layout_, nullptr);
+    path_ = std::move(other.path_);
+    owner_ = std::exchange(other.owner_, false);
+  }
+  return *this;
+}
+
+ShmMapping::~ShmMapping() { Release(); }
+
+void ShmMapping::Release() {
+  if (layout_ == nullptr) return;
+  munmap(layout_, kLayoutSize);
+  if (owner_) unlink(path_.c_str());
+  layout_ = nullptr;
+  owner_ = false;
+}
+
+ShmChannelLayout* ShmMapping::layout() const { return layout_; }
+
+tl::expected<ShmClient, ShmError> ShmClient::Create(std::string_view name) {
+  auto mapping = ShmMapping::Create(name);
+  if (!mapping.has_value()) return tl::unexpected<ShmError>(mapping.error());
+
+  ShmClient client;
+  client.mapping_ = std::move(mapping.value());
+  client.requests_ =
+      ShmRingWriter<ShmRequest>(&client.mapping_.layout()->requests);
+  client.responses_ =
+      ShmRingReader<ShmResponse>(&client.mapping_.layout()->responses);
+  return client;
+}
+
+std::optional<uint64_t> ShmClient::Submit(ShmRequest request) {
+  request.client_seq = next_seq_;
+  if (!requests_.TryPush(request)) return std::nullopt;
+  return next_seq_++;
+}
+
+std::optional<uint64_t> ShmClient::SubmitLimit(UserId user_id, OrderSide side,
+                                               Price price, Quantity qty,
+                                               TimeInForce tif) {
+  return Submit(ShmRequest{.client_seq = 0,
+                           .type = ShmRequestType::kLimit,
+                           .side = side,
+                           .tif = tif,
+                           .user_id = user_id,
+                           .price = price,
+                           .qty = qty,
+                           .order_id = OrderId{0},
+                           .display_qty = Quantity{0}});
+}
+
+std::optional<uint64_t> ShmClient::SubmitMarket(UserId user_id, OrderSide side,
+                                                Quantity qty) {
+  return Submit(ShmRequest{.client_seq = 0,
+                           .type = ShmRequestType::kMarket,
+                           .side = side,
+                           .tif = TimeInForce::kImmediateOrCancel,
+                           .user_id = user_id,
+                           .price = Price{0},
+                           .qty = qty,
+                           .order_id = OrderId{0},
+                           .display_qty = Quantity{0}});
+}
+
+std::optional<uint64_t> ShmClient::SubmitCancel(OrderId order_id) {
+  return Submit(ShmRequest{.client_seq = 0,
+                           .type = ShmRequestType::kCancel,
+                           .side = OrderSide::kBuy,
+                           .tif = TimeInForce::kGoodTillCancel,
+                           .user_id = UserId{0},
+                           .price = Price{0},
+                           .qty = Quantity{0},
+                           .order_id = order_id,
+                           .display_qty = Quantity{0}});
+}
+
+std::optional<uint64_t> ShmClient::SubmitIceberg(UserId user_id,
+                                                 OrderSide side, Price price,
+                                                 Quantity qty,
+                                                 Quantity display_qty) {
+  return Submit(ShmRequest{.client_seq = 0,
+                           .type = ShmRequestType::kIceberg,
+                           .side = side,
+                           .tif = TimeInForce::kGoodTillCancel,
+                           .user_id = user_id,
+                           .price = price,
+                           .qty = qty,
+                           .order_id = OrderId{0},
+                           .display_qty = display_qty});
+}
+
+bool ShmClient::PollResponse(ShmResponse& out) {
+  return responses_.TryPop(out);
+}
+
+ShmServer::ShmServer(OrderBook* book) : book_(book) {
+  book_->SetOrderMessageSink(this);
+}
+
+tl::expected<std::size_t, ShmError> ShmServer::Attach(std::string_view name) {
+  auto mapping = ShmMapping::Open(name);
+  if (!mapping.has_value()) return tl::unexpected<ShmError>(mapping.error());
+
+  Channel channel;
+  channel.mapping = std::move(mapping.value());
+  channel.requests =
+      ShmRingReader<ShmRequest>(&channel.mapping.layout()->requests);
+  channel.responses =
+      ShmRingWriter<ShmResponse>(&channel.mapping.layout()->responses);
+  channels_.emplace_back(std::move(channel));
+  return channels_.size() - 1;
+}
+
+std::size_t ShmServer::PollOnce() {
+  std::size_t handled = 0;
+  ShmRequest request{};
+  for (std::size_t i = 0; i < channels_.size(); ++i) {
+    while (!channels_[i].dropped && channels_[i].requests.TryPop(request)) {
+      Handle(i, request);
+      ++handled;
+      if (cancel_dropped_) CancelDroppedOrders();
+    }
+  }
+  return handled;
+}
+
+void ShmServer::Run(const std::atomic<bool>& stop) {
+  while (!stop.load(std::memory_order_relaxed)) {
+    // Yielding only when idle keeps the busy path syscall-free while still
+    // letting a client on the same core run
+    if (PollOnce() == 0) std::this_thread::yield();
+  }
+}
+
+void ShmServer::Send(std::size_t channel, const ShmResponse& response) {
+  Channel& target = channels_[channel];
+  if (target.dropped) return;
+  if (!target.responses.TryPush(response)) {
+    target.dropped = true;
+    cancel_dropped_ = true;
+  }
+}
+
+void ShmServer::CancelDroppedOrders() {
+  cancel_dropped_ = false;
+  std::vector<OrderId> orphans;
+  for (const auto& [order_id, resting] : resting_) {
+    if (channels_[resting.channel].dropped) orphans.push_back(order_id);
+  }
+  // Each cancel erases its entry from resting_ through OnOrderMessage
+  for (OrderId order_id : orphans) book_->Cancel(order_id);
+}
+
+void ShmServer::Handle(std::size_t channel, const ShmRequest& request) {
+  current_channel_ = channel;
+  current_seq_ = request.client_seq;
+  current_order_id_ = OrderId{book_->LastOrderId().v + 1};
+
+  switch (request.type) {
+    case ShmRequestType::kLimit:
+      HandleAdd(channel, request,
+                book_->AddLimit(request.user_id, request.side, request.price,
+                                request.qty, request.tif));
+      break;
+    case ShmRequestType::kMarket:
+      HandleAdd(channel, request,
+                book_->AddMarket(request.user_id, request.side, request.qty));
+      break;
+    case ShmRequestType::kIceberg:
+      HandleAdd(channel, request,
+                book_->AddIceberg(request.user_id, request.side, request.price,
+                                  request.qty, request.display_qty));
+      break;
+    case ShmRequestType::kCancel: {
+      auto it = resting_.find(request.order_id);
+      bool owned = it != resting_.end() && it->second.channel == channel;
+      bool cancelled = owned && book_->Cancel(request.order_id);
+      Send(channel, ShmResponse{.client_seq = request.client_seq,
+                                .type = cancelled
+                                            ? ShmResponseType::kCancelAck
+                                            : ShmResponseType::kCancelReject,
+                                .status = OrderStatus::kAwaitingFill,
+                                .reason = cancelled
+                                              ? RejectReason{}
+                                              : RejectReason::kUnknownOrder,
+                                .order_id = request.order_id,
+                                .price = Price{0},
+                                .qty = Quantity{0}});
+      break;
+    }
+  }
+  EraseEmptied();
+}
+
+void ShmServer::HandleAdd(std::size_t channel, const ShmRequest& request,
+                          const AddResult& result) {
+  if (!result.has_value()) {
+    Send(channel, ShmResponse{.client_seq = request.client_seq,
+                              .type = ShmResponseType::kReject,
+                              .status = OrderStatus::kRejected,
+                              .reason = result.error(),
+                              .order_id = OrderId{0},
+                              .price = request.price,
+                              .qty = request.qty});
+    return;
+  }
+
+  Send(channel, ShmResponse{.client_seq = request.client_seq,
+                            .type = ShmResponseType::kAck,
+                            .status = result->status,
+                            .reason = RejectReason{},
+                            .order_id = result->order_id,
+                            .price = request.price,
+                            .qty = result->remaining_qty});
+  for (const auto& trade : result->immediate_trades) {
+    Send(channel, ShmResponse{.client_seq = request.client_seq,
+                              .type = ShmResponseType::kFill,
+                              .status = result->status,
+                              .reason = RejectReason{},
+                              .order_id = trade.order_id,
+                              .price = trade.price,
+                              .qty = trade.qty});
+  }
+}
+
+void ShmServer::EraseEmptied() {
+  if (!emptied_.has_value()) return;
+  resting_.erase(*emptied_);
+  emptied_.reset();
+}
+
+// Tracks orders placed through a channel and reports maker-side fills to it.
+// An order belongs to the channel whose request created it. Later adds for
+// the same id, such as an iceberg's next slice, keep that channel even when
+// another channel's order caused them.
+void ShmServer::OnOrderMessage(const OrderMessage& message) {
+  if (message.type != OrderMessageType::kAdd ||
+      emptied_ != message.order_id) {
+    EraseEmptied();
+  }
+  switch (message.type) {
+    case OrderMessageType::kAdd: {
+      auto it = resting_.find(message.order_id);
+      if (it != resting_.end()) {
+        it->second.remaining = message.qty;
+        emptied_.reset();
+      } else if (message.order_id == current_order_id_) {
+        resting_.emplace(message.order_id,
+                         RestingOrder{.channel = current_channel_,
+                                      .client_seq = current_seq_,
+                                      .remaining = message.qty});
+      }
+      break;
+    }
+    case OrderMessageType::kExecute:
+    case OrderMessageType::kReduce: {
+      auto it = resting_.find(message.order_id);
+      if (it == resting_.end()) break;
+      if (message.type == OrderMessageType::kExecute) {
+        Send(it->second.channel,
+             ShmResponse{.client_seq = it->second.client_seq,
+                         .type = ShmResponseType::kFill,
+                         .status = OrderStatus::kAwaitingFill,
+                         .reason = RejectReason{},
+                         .order_id = message.order_id,
+                         .price = message.price,
+                         .qty = message.qty});
+      }
+      it->second.remaining -= message.qty;
+      if (it->second.remaining == Quantity{0}) emptied_ = message.order_id;
+      break;
+    }
+    case OrderMessageType::kDelete:
+      resting_.erase(message.order_id);
+      break;
+  }
+}
+}  // namespace order_book_v1
@@ -0,0 +1,126 @@
+#include "../include/simulation.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace order_book_v1 {
+namespace {
+// Events a thread generates for one book before moving to its next one, and
+// how often pacing looks at the clock
+constexpr uint64_t kBatch = 1024;
+
+struct BookStream {
+  explicit BookStream(const MultiBookConfig& config, std::size_t book,
+                      std::ostream* segment)
+      : flow(config.flow, BookSeed(config.seed, book)), journal(segment) {}
+
+  RandomFlow flow;
+  EventLog journal;
+  uint64_t written = 0;
+};
+
+void RunThread(const MultiBookConfig& config,
+               const std::vector<std::ostream*>& segments, std::size_t first,
+               std::size_t stride) {
+  std::vector<BookStream> books;
+  for (std::size_t b = first; b < segments.size(); b += stride) {
+    books.emplace_back(config, b, segments[b]);
+  }
+  const double rate = static_cast<double>(config.target_rate) *
+                      static_cast<double>(books.size()) /
+                      static_cast<double>(segments.size());
+
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t total = 0;
+  bool more = true;
+  while (more) {
+    more = false;
+    for (BookStream& book : books) {
+      uint64_t batch = kBatch;
+      if (config.events_per_book > 0) {
+        batch = std::min(batch, config.events_per_book - book.written);
+      }
+      for (uint64_t i = 0; i < batch; ++i) {
+        book.journal.AppendEvent(book.flow.Next());
+      }
+      book.written += batch;
+      total += batch;
+      more = more || config.events_per_book == 0 ||
+             book.written < config.events_per_book;
+
+      if (rate > 0) {
+        const auto due = std::chrono::duration<double>(
+            static_cast<double>(total) / rate);
+        std::this_thread::sleep_until(
+            start + std::chrono::duration_cast<std::chrono::nanoseconds>(due));
+      }
+    }
+  }
+  for (BookStream& book : books) book.journal.dst_stream()->flush();
+}
+}  // namespace
+
+RandomFlow::RandomFlow(const RandomFlowConfig& config, uint64_t seed)
+    : config_(config), rng_(seed) {
+  live_.reserve(kMaxLive);
+}
+
+OrderBookEvent RandomFlow::Next() {
+  const OrderSide side =
+      (rng_.Next() & 1) == 0 ? OrderSide::kBuy : OrderSide::kSell;
+  const uint32_t action = rng_.Between(0, 99);
+  const UserId user{rng_.Between(0, 1000)};
+
+  if (action <= 50 || (action > 80 && live_.empty())) {
+    const Quantity qty{rng_.Between(config_.min_qty, config_.max_qty)};
+    const Price price{rng_.Between(config_.min_price, config_.max_price)};
+    const auto tif = rng_.Between(0, 9) < 8 ? TimeInForce::kGoodTillCancel
+                                            : TimeInForce::kImmediateOrCancel;
+    if (qty.v > 0 && price.v > 0) {
+      const OrderId id{++next_order_id_};
+      if (live_.size() < kMaxLive) {
+        live_.emplace_back(id);
+      } else {
+        live_[rng_.Between(0, kMaxLive - 1)] = id;
+      }
+    }
+    return AddLimitOrderEvent{
+        .creator_id = user, .side = side, .qty = qty, .price = price,
+        .tif = tif};
+  }
+  if (action <= 80) {
+    const Quantity qty{rng_.Between(config_.min_qty, config_.max_qty)};
+    if (qty.v > 0) ++next_order_id_;
+    return AddMarketOrderEvent{.creator_id = user, .side = side, .qty = qty};
+  }
+  const auto idx = rng_.Between(0, static_cast<uint32_t>(live_.size() - 1));
+  const OrderId target = live_[idx];
+  live_[idx] = live_.back();
+  live_.pop_back();
+  return CancelOrderEvent{.order_id = target};
+}
+
+OrderId RandomFlow::predicted_order_id() const {
+  return OrderId{next_order_id_};
+}
+
+uint64_t BookSeed(uint64_t seed, std::size_t book) {
+  SplitMix64 mix(seed ^ (uint64_t{book} * 0xD1B54A32D192ED03ULL));
+  return mix.Next();
+}
+
+void RunMultiBookSimulation(const MultiBookConfig& config,
+                            const std::vector<std::ostream*>& segments) {
+  const std::size_t threads =
+      std::clamp<std::size_t>(config.threads, 1, std::max<std::size_t>(
+                                                     segments.size(), 1));
+  std::vector<std::thread> workers;
+  for (std::size_t t = 1; t < threads; ++t) {
+    workers.emplace_back(RunThread, std::cref(config), std::cref(segments), t,
+                         threads);
+  }
+  RunThread(config, segments, 0, threads);
+  for (auto& worker : workers) worker.join();
+}
+}  // namespace order_book_v1
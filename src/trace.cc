@@ -0,0 +1,103 @@
+#include "../include/trace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "../include/tsc_clock.h"
+
+namespace order_book_v1 {
+namespace {
+struct TraceRegistry {
+  std::mutex mutex;
+  // Rings outlive their threads so spans from finished workers can still be
+  // exported
+  std::vector<std::unique_ptr<TraceRing>> rings;
+};
+
+TraceRegistry& Registry() {
+  static TraceRegistry registry;
+  return registry;
+}
+
+TraceRing& ThreadRing() {
+  thread_local TraceRing* ring = [] {
+    auto& registry = Registry();
+    std::lock_guard lock(registry.mutex);
+    auto tid = static_cast<uint32_t>(registry.rings.size() + 1);
+    registry.rings.emplace_back(std::make_unique<TraceRing>(tid));
+    return registry.rings.back().get();
+  }();
+  return *ring;
+}
+
+// Span names are literals chosen by this code base, but escape them anyway so
+// the output is always valid JSON
+void WriteJsonString(std::ostream& os, const char* text) {
+  os << '"';
+  for (const char* c = text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      os << '\\' << *c;
+    } else if (static_cast<unsigned char>(*c) >= 0x20) {
+      os << *c;
+    }
+  }
+  os << '"';
+}
+}  // namespace
+
+void Tracer::Record(const char* name, uint64_t start, uint64_t end) {
+  ThreadRing().Push(TraceEvent{.name = name, .start = start, .end = end});
+}
+
+void Tracer::Clear() {
+  auto& registry = Registry();
+  std::lock_guard lock(registry.mutex);
+  for (auto& ring : registry.rings) ring->Clear();
+}
+
+void Tracer::WriteChromeTrace(std::ostream& os) {
+  auto& registry = Registry();
+  std::lock_guard lock(registry.mutex);
+
+  uint64_t origin = std::numeric_limits<uint64_t>::max();
+  for (const auto& ring : registry.rings) {
+    // Parents are pushed after their children, so the oldest entry is not
+    // necessarily the earliest start
+    for (std::size_t i = 0; i < ring->size(); ++i) {
+      origin = std::min(origin, ring->at(i).start);
+    }
+  }
+  const double ticks_per_us = TscClock::Calibrate() * 1000.0;
+
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& ring : registry.rings) {
+    for (std::size_t i = 0; i < ring->size(); ++i) {
+      const TraceEvent& event = ring->at(i);
+      if (!first) os << ',';
+      first = false;
+      os << "\n{\"name\":";
+      WriteJsonString(os, event.name);
+      const double ts =
+          static_cast<double>(event.start - origin) / ticks_per_us;
+      const double dur =
+          static_cast<double>(event.end - event.start) / ticks_per_us;
+      os << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid()
+         << ",\"ts\":" << ts << ",\"dur\":" << dur << '}';
+    }
+  }
+  os << "\n]}\n";
+  os.flags(flags);
+  os.precision(precision);
+}
+}  // namespace order_book_v1
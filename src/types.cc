@@ -21,6 +21,30 @@ std::ostream& operator<<(std::ostream& os, TimeInForce const tif) {
     case TimeInForce::kImmediateOrCancel:
       os << "IOC";
       break;
+    case TimeInForce::kFillOrKill:
+      os << "FOK";
+      break;
+  }
+  return os;
+}
+
+std::ostream& operator<<(std::ostream& os, SelfTradePrevention const mode) {
+  switch (mode) {
+    case SelfTradePrevention::kNone:
+      os << "NONE";
+      break;
+    case SelfTradePrevention::kCancelNewest:
+      os << "NEWEST";
+      break;
+    case SelfTradePrevention::kCancelOldest:
+      os << "OLDEST";
+      break;
+    case SelfTradePrevention::kCancelBoth:
+      os << "BOTH";
+      break;
+    case SelfTradePrevention::kDecrement:
+      os << "DECREMENT";
+      break;
   }
   return os;
 }
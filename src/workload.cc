@@ -0,0 +1,173 @@
+#include "../include/workload.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace order_book_v1 {
+namespace {
+constexpr double kMaxBranchingRatio = 0.99;
+
+// Exponential with mean 1, from a uniform in [0, 1)
+double UnitExponential(SplitMix64& rng) {
+  return -std::log1p(-rng.NextDouble());
+}
+}  // namespace
+
+void WorkloadGenerator::LiveTracker::OnOrderMessage(
+    const OrderMessage& message) {
+  switch (message.type) {
+    case OrderMessageType::kAdd:
+      ++generator_.stats_.rested;
+      generator_.AddLive(message.order_id, message.qty);
+      break;
+    case OrderMessageType::kExecute:
+    case OrderMessageType::kReduce: {
+      auto it = generator_.live_index_.find(message.order_id);
+      if (it == generator_.live_index_.end()) break;
+      it->second.remaining -= message.qty;
+      if (it->second.remaining == Quantity{0}) {
+        generator_.RemoveLive(message.order_id);
+      }
+      break;
+    }
+    case OrderMessageType::kDelete:
+      generator_.RemoveLive(message.order_id);
+      break;
+  }
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadConfig& config)
+    : config_(config),
+      rng_(config.seed),
+      tracker_(*this),
+      mid_(config.initial_mid) {
+  config_.branching_ratio =
+      std::clamp(config_.branching_ratio, 0.0, kMaxBranchingRatio);
+  config_.user_count = std::max<uint32_t>(config_.user_count, 1);
+  config_.min_qty = std::max<Underlying>(config_.min_qty, 1);
+  config_.max_qty = std::max(config_.max_qty, config_.min_qty);
+  book_.SetOrderMessageSink(&tracker_);
+
+  user_cdf_.resize(config_.user_count);
+  double total = 0;
+  for (uint32_t k = 0; k < config_.user_count; ++k) {
+    total += 1.0 / std::pow(static_cast<double>(k + 1),
+                            config_.user_zipf_exponent);
+    user_cdf_[k] = total;
+  }
+  for (double& c : user_cdf_) c /= total;
+}
+
+WorkloadEvent WorkloadGenerator::Next() {
+  WorkloadEvent out{.time_ns = DrawArrival(), .event = {}};
+  const OrderSide side =
+      (rng_.Next() & 1) == 0 ? OrderSide::kBuy : OrderSide::kSell;
+  const auto live = static_cast<double>(live_.size());
+  const bool is_market = rng_.NextDouble() < config_.market_share;
+  const bool is_cancel =
+      !is_market &&
+      rng_.NextDouble() * (live + static_cast<double>(config_.target_resting)) <
+          live;
+
+  if (is_cancel) {
+    const auto slot = rng_.Between(0, static_cast<uint32_t>(live_.size() - 1));
+    out.event = CancelOrderEvent{.order_id = live_[slot]};
+    ++stats_.cancels;
+  } else if (is_market) {
+    out.event = AddMarketOrderEvent{
+        .creator_id = DrawUser(), .side = side, .qty = DrawQty()};
+    ++stats_.markets;
+  } else {
+    const auto tif = rng_.NextDouble() < config_.ioc_share
+                         ? TimeInForce::kImmediateOrCancel
+                         : TimeInForce::kGoodTillCancel;
+    out.event = AddLimitOrderEvent{.creator_id = DrawUser(),
+                                   .side = side,
+                                   .qty = DrawQty(),
+                                   .price = DrawPrice(side),
+                                   .tif = tif};
+    ++stats_.limits;
+  }
+  book_.Apply(out.event);
+
+  if (rng_.NextDouble() < config_.mid_step_probability) {
+    if ((rng_.Next() & 1) == 0) {
+      ++mid_;
+    } else if (mid_ > 2) {
+      --mid_;
+    }
+  }
+  return out;
+}
+
+Quantity WorkloadGenerator::DrawQty() {
+  const double draw =
+      static_cast<double>(config_.min_qty) *
+      std::pow(1.0 - rng_.NextDouble(), -1.0 / config_.size_alpha);
+  return Quantity{
+      draw >= static_cast<double>(config_.max_qty)
+          ? config_.max_qty
+          : std::max(config_.min_qty, static_cast<Underlying>(draw))};
+}
+
+UserId WorkloadGenerator::DrawUser() {
+  auto it = std::upper_bound(user_cdf_.begin(), user_cdf_.end(),
+                             rng_.NextDouble());
+  const auto k = std::min<std::size_t>(
+      static_cast<std::size_t>(it - user_cdf_.begin()), user_cdf_.size() - 1);
+  return UserId{static_cast<Underlying>(k + 1)};
+}
+
+Price WorkloadGenerator::DrawPrice(OrderSide side) {
+  const auto offset = static_cast<Underlying>(config_.price_offset_mean *
+                                              UnitExponential(rng_)) +
+                      1;
+  if (side == OrderSide::kSell) return Price{mid_ + offset};
+  return Price{offset < mid_ ? mid_ - offset : 1};
+}
+
+// Ogata thinning. Between events the intensity only decays, so its value
+// right after the last event bounds it until the next candidate.
+uint64_t WorkloadGenerator::DrawArrival() {
+  const double jump = config_.branching_ratio * config_.decay_rate;
+  while (true) {
+    const double bound = config_.base_rate + excitation_;
+    const double wait = UnitExponential(rng_) / bound;
+    time_s_ += wait;
+    excitation_ *= std::exp(-config_.decay_rate * wait);
+    if (rng_.NextDouble() * bound <= config_.base_rate + excitation_) {
+      excitation_ += jump;
+      return static_cast<uint64_t>(time_s_ * 1e9);
+    }
+  }
+}
+
+void WorkloadGenerator::AddLive(OrderId order_id, Quantity qty) {
+  live_index_.emplace(order_id,
+                      LiveOrder{.slot = live_.size(), .remaining = qty});
+  live_.emplace_back(order_id);
+}
+
+void WorkloadGenerator::RemoveLive(OrderId order_id) {
+  auto it = live_index_.find(order_id);
+  if (it == live_index_.end()) return;
+  const std::size_t slot = it->second.slot;
+  live_index_.erase(it);
+  if (slot + 1 != live_.size()) {
+    live_[slot] = live_.back();
+    live_index_.at(live_[slot]).slot = slot;
+  }
+  live_.pop_back();
+}
+
+std::vector<OrderBookEvent> GenerateWorkload(const WorkloadConfig& config,
+                                             std::size_t count) {
+  WorkloadGenerator generator(config);
+  std::vector<OrderBookEvent> events;
+  events.reserve(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    events.emplace_back(generator.Next().event);
+  }
+  return events;
+}
+}  // namespace order_book_v1
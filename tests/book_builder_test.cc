@@ -0,0 +1,163 @@
+#include "book_builder.h"
+
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "metrics.h"
+#include "order_message.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+void RunRandomWorkload(OrderBook& ob, uint32_t seed, int steps) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<Underlying> price_rn(1, 30);
+  std::uniform_int_distribution<Underlying> qty_rn(1, 20);
+  std::uniform_int_distribution<Underlying> user_rn(0, 50);
+  std::uniform_int_distribution<int> action_rn(0, 9);
+  std::vector<OrderId> ids;
+
+  for (int i = 0; i < steps; ++i) {
+    OrderSide side = rng() % 2 == 0 ? OrderSide::kBuy : OrderSide::kSell;
+    int action = action_rn(rng);
+    if (action == 1) {
+      const Quantity qty{qty_rn(rng)};
+      auto r = ob.AddIceberg(UserId{user_rn(rng)}, side, Price{price_rn(rng)},
+                             qty, Quantity{1 + qty.v / 4});
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (action < 6) {
+      auto r = ob.AddLimit(UserId{user_rn(rng)}, side, Price{price_rn(rng)},
+                           Quantity{qty_rn(rng)},
+                           action == 0 ? TimeInForce::kImmediateOrCancel
+                                       : TimeInForce::kGoodTillCancel);
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (action == 6) {
+      // Half of them stop-limits with the limit at the stop price
+      const Price stop{price_rn(rng)};
+      auto r = ob.AddStop(UserId{user_rn(rng)}, side, stop,
+                          Quantity{qty_rn(rng)},
+                          rng() % 2 == 0 ? std::optional(stop) : std::nullopt);
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (action < 8) {
+      auto r = ob.AddMarket(UserId{user_rn(rng)}, side, Quantity{qty_rn(rng)});
+    } else if (ids.empty()) {
+      continue;
+    } else if (i % 500 == 499) {
+      ob.CancelAllForUser(UserId{user_rn(rng)});
+    } else if (action == 8) {
+      ob.Cancel(ids[rng() % ids.size()]);
+    } else {
+      auto r = ob.Modify(ids[rng() % ids.size()], Quantity{qty_rn(rng)},
+                         Price{price_rn(rng)});
+    }
+  }
+}
+
+// Sell-side message at price 10, enough for the single-order scenarios below
+OrderMessage MakeMessage(OrderMessageType type, OrderId id, Quantity qty) {
+  return OrderMessage{.type = type,
+                      .side = OrderSide::kSell,
+                      .tif = TimeInForce::kGoodTillCancel,
+                      .reserved = 0,
+                      .order_id = id,
+                      .user_id = UserId{0},
+                      .price = Price{10},
+                      .qty = qty};
+}
+}  // namespace
+
+TEST(BookBuilder, RebuiltHashMatchesSource) {
+  // Arrange
+  OrderBook ob;
+  BookBuilder builder;
+  ob.SetOrderMessageSink(&builder);
+
+  // Act
+  RunRandomWorkload(ob, 11, 5000);
+
+  // Assert
+  EXPECT_EQ(builder.ToHash(), ob.ToHash());
+  EXPECT_EQ(builder.BestBid(), ob.BestBid());
+  EXPECT_EQ(builder.BestAsk(), ob.BestAsk());
+}
+
+TEST(BookBuilder, RebuiltHashMatchesUnderSelfTradePrevention) {
+  for (auto mode :
+       {SelfTradePrevention::kCancelNewest, SelfTradePrevention::kCancelOldest,
+        SelfTradePrevention::kCancelBoth, SelfTradePrevention::kDecrement}) {
+    // Arrange
+    OrderBook ob;
+    BookBuilder builder;
+    BookMetrics metrics;
+    ob.SetOrderMessageSink(&builder);
+    ob.SetMetrics(&metrics);
+    ob.SetSelfTradePrevention(mode);
+
+    // Act
+    RunRandomWorkload(ob, 31, 5000);
+
+    // Assert
+    EXPECT_GT(metrics.self_trades_prevented.Load(), 0) << mode;
+    EXPECT_EQ(builder.ToHash(), ob.ToHash()) << mode;
+  }
+}
+
+TEST(BookBuilder, BinaryFeedRoundTrip) {
+  // Arrange
+  OrderBook ob;
+  std::stringstream feed;
+  BinaryOrderMessageWriter writer{&feed};
+  ob.SetOrderMessageSink(&writer);
+  RunRandomWorkload(ob, 23, 5000);
+
+  // Act
+  BookBuilder builder;
+  OrderMessage message{};
+  std::size_t n_messages = 0;
+  while (ReadOrderMessage(feed, message)) {
+    EXPECT_TRUE(builder.Apply(message));
+    ++n_messages;
+  }
+
+  // Assert
+  EXPECT_GT(n_messages, 0);
+  EXPECT_EQ(builder.ToHash(), ob.ToHash());
+}
+
+TEST(BookBuilder, ExecuteRemovesFilledOrder) {
+  // Arrange
+  BookBuilder builder;
+  builder.Apply(MakeMessage(OrderMessageType::kAdd, OrderId{1}, Quantity{5}));
+
+  // Act
+  bool partial = builder.Apply(
+      MakeMessage(OrderMessageType::kExecute, OrderId{1}, Quantity{2}));
+  Quantity depth_after_partial = builder.DepthAt(OrderSide::kSell, Price{10});
+  bool full = builder.Apply(
+      MakeMessage(OrderMessageType::kExecute, OrderId{1}, Quantity{3}));
+
+  // Assert
+  EXPECT_TRUE(partial);
+  EXPECT_TRUE(full);
+  EXPECT_EQ(depth_after_partial, Quantity{3});
+  EXPECT_EQ(builder.OrderCount(), 0);
+  EXPECT_FALSE(builder.BestAsk().has_value());
+}
+
+TEST(BookBuilder, UnknownOrderIsRejected) {
+  // Arrange
+  BookBuilder builder;
+
+  // Act
+  bool result = builder.Apply(
+      MakeMessage(OrderMessageType::kDelete, OrderId{42}, Quantity{0}));
+
+  // Assert
+  EXPECT_FALSE(result);
+}
+}  // namespace order_book_v1
@@ -0,0 +1,128 @@
+#include "book_scheduler.h"
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_log.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+OrderBookEvent RandomEvent(std::mt19937& rng, uint32_t next_order_id) {
+  OrderSide side = rng() % 2 == 0 ? OrderSide::kBuy : OrderSide::kSell;
+  Quantity qty{static_cast<Underlying>(rng() % 20 + 1)};
+  switch (rng() % 4) {
+    case 0:
+      return AddMarketOrderEvent{
+          .creator_id = UserId{1}, .side = side, .qty = qty};
+    case 1:
+      return CancelOrderEvent{
+          .order_id = OrderId{static_cast<Underlying>(rng() % next_order_id)}};
+    default:
+      return AddLimitOrderEvent{
+          .creator_id = UserId{2},
+          .side = side,
+          .qty = qty,
+          .price = Price{static_cast<Underlying>(rng() % 30 + 1)},
+          .tif = TimeInForce::kGoodTillCancel,
+      };
+  }
+}
+}  // namespace
+
+TEST(BookScheduler, MigrationsPreserveEventOrder) {
+  // Arrange
+  constexpr std::size_t kBooks = 4;
+  std::ostringstream log;
+  BookScheduler scheduler{
+      SchedulerConfig{.threads = 2, .migration_log = &log}};
+  std::vector<BookId> ids;
+  std::vector<OrderBook> expected(kBooks);
+  for (std::size_t i = 0; i < kBooks; ++i) {
+    ids.emplace_back(scheduler.AddBook());
+  }
+  scheduler.Start();
+  std::mt19937 rng(5);
+
+  // Act
+  // Keep moving books between threads while events are still flowing
+  for (uint32_t round = 0; round < 20; ++round) {
+    for (uint32_t i = 0; i < 200; ++i) {
+      std::size_t b = rng() % kBooks;
+      OrderBookEvent event = RandomEvent(rng, round * 200 + i + 1);
+      scheduler.Submit(ids[b], event);
+      expected[b].Apply(event);
+    }
+    BookId moving = ids[round % kBooks];
+    scheduler.Migrate(moving, (scheduler.OwnerOf(moving) + 1) % 2);
+  }
+  scheduler.Drain();
+
+  // Assert
+  for (std::size_t b = 0; b < kBooks; ++b) {
+    EXPECT_EQ(scheduler.book(ids[b]).ToHash(), expected[b].ToHash());
+  }
+  EXPECT_FALSE(scheduler.migrations().empty());
+  EXPECT_NE(log.str().find("MIGRATE book="), std::string::npos);
+}
+
+TEST(BookScheduler, RebalanceMovesBookOffBusiestThread) {
+  // Arrange
+  // Round-robin puts books 0 and 2 on thread 0, books 1 and 3 on thread 1
+  BookScheduler scheduler{SchedulerConfig{.threads = 2}};
+  std::vector<BookId> ids;
+  for (int i = 0; i < 4; ++i) ids.emplace_back(scheduler.AddBook());
+  scheduler.Start();
+  std::mt19937 rng(9);
+
+  for (uint32_t i = 0; i < 1000; ++i) {
+    scheduler.Submit(ids[0], RandomEvent(rng, i + 1));
+    if (i % 2 == 0) scheduler.Submit(ids[2], RandomEvent(rng, i + 1));
+    if (i % 100 == 0) scheduler.Submit(ids[1], RandomEvent(rng, i + 1));
+  }
+  scheduler.Drain();
+
+  // Act
+  bool migrated = scheduler.Rebalance();
+  scheduler.Submit(ids[2], RandomEvent(rng, 1));
+  scheduler.Drain();
+
+  // Assert
+  // Book 2 carries roughly half the gap between the threads
+  ASSERT_TRUE(migrated);
+  while (scheduler.migrations().empty()) std::this_thread::yield();
+  auto migrations = scheduler.migrations();
+  ASSERT_EQ(migrations.size(), 1);
+  EXPECT_EQ(migrations[0].book, ids[2]);
+  EXPECT_EQ(migrations[0].from_thread, 0);
+  EXPECT_EQ(migrations[0].to_thread, 1);
+  EXPECT_EQ(scheduler.OwnerOf(ids[2]), 1);
+}
+
+TEST(BookScheduler, BalancedThreadsAreLeftAlone) {
+  // Arrange
+  BookScheduler scheduler{SchedulerConfig{.threads = 2}};
+  BookId b0 = scheduler.AddBook();
+  BookId b1 = scheduler.AddBook();
+  scheduler.Start();
+  std::mt19937 rng(1);
+  for (uint32_t i = 0; i < 100; ++i) {
+    scheduler.Submit(b0, RandomEvent(rng, i + 1));
+    scheduler.Submit(b1, RandomEvent(rng, i + 1));
+  }
+  scheduler.Drain();
+
+  // Act
+  bool migrated = scheduler.Rebalance();
+
+  // Assert
+  EXPECT_FALSE(migrated);
+}
+}  // namespace order_book_v1
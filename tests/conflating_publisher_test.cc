@@ -0,0 +1,142 @@
+#include "conflating_publisher.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "level_delta.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+class MirrorSink : public LevelDeltaSink {
+ public:
+  void OnLevelDeltas(std::span<const LevelDelta> deltas) override {
+    ++batches;
+    updates += deltas.size();
+    for (const auto& delta : deltas) {
+      auto key = std::make_pair(delta.side, delta.price.v);
+      if (delta.removed) {
+        mirror.erase(key);
+      } else {
+        mirror[key] = delta.aggregate_qty;
+      }
+    }
+  }
+
+  std::size_t batches = 0;
+  std::size_t updates = 0;
+  std::map<std::pair<OrderSide, Underlying>, Quantity> mirror;
+};
+
+LevelDelta Delta(Underlying price, Underlying qty) {
+  return LevelDelta{.side = OrderSide::kBuy,
+                    .price = Price{price},
+                    .aggregate_qty = Quantity{qty},
+                    .removed = qty == 0};
+}
+}  // namespace
+
+TEST(ConflatingPublisher, EventWindowKeepsLatestLevelState) {
+  // Arrange
+  MirrorSink sink;
+  ConflatingPublisher publisher{&sink, ConflationConfig{.max_events = 3}};
+  LevelDelta d1 = Delta(10, 5);
+  LevelDelta d2 = Delta(10, 7);
+  LevelDelta d3 = Delta(10, 2);
+
+  // Act
+  publisher.OnLevelDeltas({&d1, 1});
+  publisher.OnLevelDeltas({&d2, 1});
+  std::size_t batches_before_window = sink.batches;
+  publisher.OnLevelDeltas({&d3, 1});
+
+  // Assert
+  EXPECT_EQ(batches_before_window, 0);
+  EXPECT_EQ(sink.batches, 1);
+  EXPECT_EQ(sink.updates, 1);
+  EXPECT_EQ((sink.mirror[{OrderSide::kBuy, 10}]), Quantity{2});
+  EXPECT_EQ(publisher.dropped_updates(), 2);
+  EXPECT_EQ(publisher.published_updates(), 1);
+}
+
+TEST(ConflatingPublisher, FullBufferForcesPublish) {
+  // Arrange
+  MirrorSink sink;
+  ConflatingPublisher publisher{
+      &sink, ConflationConfig{.max_events = 100, .capacity = 2}};
+  LevelDelta deltas[] = {Delta(1, 1), Delta(2, 1), Delta(3, 1)};
+
+  // Act
+  publisher.OnLevelDeltas(deltas);
+
+  // Assert
+  // The third level doesn't fit, so the first two are published to make room
+  EXPECT_EQ(sink.batches, 1);
+  EXPECT_EQ(sink.updates, 2);
+  publisher.Flush();
+  EXPECT_EQ(sink.updates, 3);
+}
+
+TEST(ConflatingPublisher, PollPublishesAfterDelay) {
+  // Arrange
+  MirrorSink sink;
+  ConflatingPublisher publisher{
+      &sink, ConflationConfig{.max_delay = std::chrono::seconds{1}}};
+  LevelDelta d1 = Delta(10, 5);
+  publisher.OnLevelDeltas({&d1, 1});
+
+  // Act
+  publisher.Poll(ConflatingPublisher::Clock::now());
+  std::size_t batches_before_delay = sink.batches;
+  publisher.Poll(ConflatingPublisher::Clock::now() + std::chrono::seconds{2});
+
+  // Assert
+  EXPECT_EQ(batches_before_delay, 0);
+  EXPECT_EQ(sink.batches, 1);
+}
+
+TEST(ConflatingPublisher, ConflatedMirrorMatchesBook) {
+  // Arrange
+  MirrorSink sink;
+  ConflatingPublisher publisher{
+      &sink, ConflationConfig{.max_events = 16, .capacity = 8}};
+  OrderBook ob;
+  ob.SetLevelDeltaSink(&publisher);
+
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<Underlying> price_rn(1, 25);
+  std::uniform_int_distribution<Underlying> qty_rn(1, 10);
+  std::vector<OrderId> ids;
+
+  // Act
+  for (int i = 0; i < 3000; ++i) {
+    OrderSide side = rng() % 2 == 0 ? OrderSide::kBuy : OrderSide::kSell;
+    if (rng() % 4 != 0) {
+      auto r = ob.AddLimit(UserId{0}, side, Price{price_rn(rng)},
+                           Quantity{qty_rn(rng)}, TimeInForce::kGoodTillCancel);
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (!ids.empty()) {
+      ob.Cancel(ids[rng() % ids.size()]);
+    }
+  }
+  publisher.Flush();
+
+  // Assert
+  for (Underlying p = 1; p <= 25; ++p) {
+    for (OrderSide side : {OrderSide::kBuy, OrderSide::kSell}) {
+      auto it = sink.mirror.find({side, p});
+      Quantity mirrored = it == sink.mirror.end() ? Quantity{0} : it->second;
+      EXPECT_EQ(ob.DepthAt(side, Price{p}), mirrored);
+    }
+  }
+  EXPECT_GT(publisher.dropped_updates(), 0);
+}
+}  // namespace order_book_v1
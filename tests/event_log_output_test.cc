@@ -1,4 +1,6 @@
 #include <optional>
+#include <sstream>
+#include <string>
 
 #include "event_log_test.h"
 
@@ -45,4 +47,104 @@ TEST_F(EventLogTest, InvalidLimitOrderEvent) {
   AssertOutput(expected);
   AssertEventSeq(1);
 }
+
+TEST_F(EventLogTest, ParseRoundTripsEveryEventType) {
+  // Arrange
+  ArrangeEvents({AddLimitOrderEvent{
+                     UserId{6},
+                     OrderSide::kSell,
+                     Quantity{2},
+                     Price{10},
+                     TimeInForce::kImmediateOrCancel,
+                 },
+                 AddLimitOrderEvent{
+                     UserId{8},
+                     OrderSide::kBuy,
+                     Quantity{4},
+                     Price{11},
+                     TimeInForce::kFillOrKill,
+                 },
+                 AddMarketOrderEvent{
+                     UserId{7},
+                     OrderSide::kBuy,
+                     Quantity{5},
+                 },
+                 CancelOrderEvent{
+                     OrderId{3},
+                 },
+                 ModifyOrderEvent{
+                     OrderId{4},
+                     Quantity{9},
+                     Price{12},
+                 },
+                 CancelAllOrdersEvent{
+                     UserId{6},
+                     std::nullopt,
+                 },
+                 CancelAllOrdersEvent{
+                     UserId{7},
+                     OrderSide::kSell,
+                 },
+                 AddIcebergOrderEvent{
+                     UserId{8},
+                     OrderSide::kBuy,
+                     Quantity{100},
+                     Price{9},
+                     Quantity{10},
+                 },
+                 AddStopOrderEvent{
+                     UserId{9},
+                     OrderSide::kSell,
+                     Quantity{4},
+                     Price{8},
+                     std::nullopt,
+                 },
+                 AddStopOrderEvent{
+                     UserId{9},
+                     OrderSide::kBuy,
+                     Quantity{4},
+                     Price{12},
+                     Price{13},
+                 },
+                 SetSelfTradePreventionEvent{
+                     SelfTradePrevention::kCancelBoth,
+                 },
+                 SetSelfTradePreventionEvent{
+                     SelfTradePrevention::kDecrement,
+                 }});
+  std::istringstream in(buf_.str());
+  std::ostringstream out;
+  EventLog relog{&out};
+
+  // Act
+  std::string line;
+  uint32_t expected_seq = 0;
+  while (std::getline(in, line)) {
+    auto record = ParseEvent(line);
+    ASSERT_TRUE(record.has_value()) << line;
+    EXPECT_EQ(record->event_seq, expected_seq++);
+    relog.AppendEvent(record->event);
+  }
+
+  // Assert
+  EXPECT_EQ(out.str(), buf_.str());
+}
+
+TEST_F(EventLogTest, ParseRejectsMalformedLines) {
+  // Assert
+  EXPECT_FALSE(ParseEvent("").has_value());
+  EXPECT_FALSE(ParseEvent("0 INVALID_LIMIT_ORDER").has_value());
+  EXPECT_FALSE(ParseEvent("0 ADDLIMIT 6 BUY 2 10").has_value());
+  EXPECT_FALSE(ParseEvent("0 ADDLIMIT 6 LONG 2 10 GTC").has_value());
+  EXPECT_FALSE(ParseEvent("0 ADDMARKET 7 BUY -5").has_value());
+  EXPECT_FALSE(ParseEvent("0 CANCEL 3 4").has_value());
+  EXPECT_FALSE(ParseEvent("x CANCEL 3").has_value());
+  EXPECT_FALSE(ParseEvent("0 MODIFY 3 4").has_value());
+  EXPECT_FALSE(ParseEvent("0 CANCELALL 6 LONG").has_value());
+  EXPECT_FALSE(ParseEvent("0 CANCELALL 6 BUY 1").has_value());
+  EXPECT_FALSE(ParseEvent("0 ADDSTOP 1 BUY 4 12 X").has_value());
+  EXPECT_FALSE(ParseEvent("0 ADDSTOP 1 BUY 4 12 13 14").has_value());
+  EXPECT_FALSE(ParseEvent("0 SETSTP").has_value());
+  EXPECT_FALSE(ParseEvent("0 SETSTP OLDEST 1").has_value());
+}
 }  // namespace order_book_v1
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <latency_histogram.h>
+#include <orderbook.h>
+
+#include <cstdint>
+
+namespace order_book_v1 {
+TEST(LatencyHistogram, SmallValuesHaveExactBuckets) {
+  for (uint64_t v = 0; v < LatencyHistogram::kSubBuckets; ++v) {
+    EXPECT_EQ(LatencyHistogram::BucketOf(v), v);
+    EXPECT_EQ(LatencyHistogram::BucketUpperBound(v), v);
+  }
+}
+
+TEST(LatencyHistogram, BucketsBoundRelativeError) {
+  for (uint64_t v : {8ULL, 9ULL, 15ULL, 16ULL, 100ULL, 1'000ULL, 123'456ULL,
+                     1ULL << 40, ~0ULL}) {
+    auto bucket = LatencyHistogram::BucketOf(v);
+    ASSERT_LT(bucket, LatencyHistogram::kBuckets);
+    uint64_t upper = LatencyHistogram::BucketUpperBound(bucket);
+    EXPECT_GE(upper, v);
+    EXPECT_LE(upper - v, v / LatencyHistogram::kSubBuckets);
+    if (v != ~0ULL) {
+      EXPECT_LE(bucket, LatencyHistogram::BucketOf(v + 1));
+    }
+  }
+  EXPECT_EQ(LatencyHistogram::BucketOf(~0ULL), LatencyHistogram::kBuckets - 1);
+}
+
+TEST(LatencyHistogram, Percentiles) {
+  LatencyHistogram h;
+  EXPECT_EQ(h.ValueAtPercentile(50), 0);
+
+  for (uint64_t v = 1; v <= 100; ++v) h.Record(v);
+  h.Record(10'000);
+
+  EXPECT_EQ(h.count(), 101);
+  EXPECT_EQ(h.max(), 10'000);
+  uint64_t p50 = h.ValueAtPercentile(50);
+  EXPECT_GE(p50, 51);
+  EXPECT_LE(p50, 51 + 51 / 8);
+  EXPECT_EQ(h.ValueAtPercentile(100), 10'000);
+  EXPECT_EQ(h.ValueAtPercentile(0), 1);
+}
+
+TEST(LatencyHistogram, ResetAndMerge) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.Record(5);
+  b.Record(500);
+  b.Record(7);
+
+  a.Merge(b);
+  EXPECT_EQ(a.count(), 3);
+  EXPECT_EQ(a.max(), 500);
+  EXPECT_EQ(a.ValueAtPercentile(50), 7);
+
+  a.Reset();
+  EXPECT_EQ(a.count(), 0);
+  EXPECT_EQ(a.max(), 0);
+  EXPECT_EQ(a.ValueAtPercentile(99), 0);
+}
+
+TEST(LatencyHistogram, OrderBookRecordsByOutcome) {
+  if (!LatencyHistogramsEnabled()) {
+    GTEST_SKIP() << "built without ORDERBOOK_LATENCY_HISTOGRAMS";
+  }
+  constexpr auto kGtc = TimeInForce::kGoodTillCancel;
+  OrderBook ob;
+  auto rest = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                          kGtc);
+  ASSERT_TRUE(rest.has_value());
+  auto filled =
+      ob.AddLimit(UserId{2}, OrderSide::kBuy, Price{10}, Quantity{2}, kGtc);
+  auto partial =
+      ob.AddLimit(UserId{2}, OrderSide::kBuy, Price{10}, Quantity{4}, kGtc);
+  auto rejected =
+      ob.AddLimit(UserId{2}, OrderSide::kBuy, Price{0}, Quantity{4}, kGtc);
+  auto market = ob.AddMarket(UserId{3}, OrderSide::kBuy, Quantity{1});
+  ASSERT_TRUE(filled.has_value());
+  EXPECT_EQ(filled->status, OrderStatus::kImmediateFill);
+  ASSERT_TRUE(partial.has_value());
+  EXPECT_EQ(partial->status, OrderStatus::kPartialFill);
+  EXPECT_FALSE(rejected.has_value());
+  EXPECT_FALSE(market.has_value());
+  ob.Cancel(OrderId{999});
+  ob.CancelAllForUser(UserId{2});
+
+  auto snapshot = ob.SnapshotLatency();
+  EXPECT_EQ(snapshot[LatencyKind::kLimitRested].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kLimitFilled].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kLimitPartial].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kLimitRejected].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kMarketRejected].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kCancelMiss].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kCancelHit].count(), 0);
+  EXPECT_EQ(snapshot[LatencyKind::kCancelAll].count(), 1);
+
+  ob.ResetLatency();
+  EXPECT_EQ(ob.SnapshotLatency()[LatencyKind::kLimitRested].count(), 0);
+}
+
+TEST(LatencyHistogram, UntradedMarketIsNotCountedAsRested) {
+  if (!LatencyHistogramsEnabled()) {
+    GTEST_SKIP() << "built without ORDERBOOK_LATENCY_HISTOGRAMS";
+  }
+  OrderBook ob;
+  ob.SetSelfTradePrevention(SelfTradePrevention::kCancelNewest);
+  auto rest = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                          TimeInForce::kGoodTillCancel);
+  ASSERT_TRUE(rest.has_value());
+
+  auto market = ob.AddMarket(UserId{1}, OrderSide::kBuy, Quantity{3});
+
+  ASSERT_TRUE(market.has_value());
+  EXPECT_TRUE(market->immediate_trades.empty());
+  EXPECT_EQ(market->status, OrderStatus::kPartialFill);
+  auto snapshot = ob.SnapshotLatency();
+  EXPECT_EQ(snapshot[LatencyKind::kMarketPartial].count(), 1);
+  EXPECT_EQ(snapshot[LatencyKind::kLimitRested].count(), 1);
+}
+}  // namespace order_book_v1
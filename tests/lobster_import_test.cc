@@ -0,0 +1,130 @@
+#include <event_log.h>
+#include <gtest/gtest.h>
+#include <lobster_import.h>
+#include <orderbook.h>
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace order_book_v1 {
+namespace {
+std::vector<std::string> Lines(const std::string& text) {
+  std::vector<std::string> lines;
+  std::istringstream in(text);
+  for (std::string line; std::getline(in, line);) lines.push_back(line);
+  return lines;
+}
+
+OrderBook Replay(const std::string& journal) {
+  OrderBook book;
+  for (const auto& line : Lines(journal)) {
+    auto record = ParseEvent(line);
+    EXPECT_TRUE(record.has_value()) << line;
+    if (record.has_value()) book.Apply(record->event);
+  }
+  return book;
+}
+}  // namespace
+
+TEST(ExternalOrderMap, MatchesUnorderedMapUnderChurn) {
+  ExternalOrderMap map;
+  std::unordered_map<uint64_t, Underlying> reference;
+  uint64_t state = 1;
+  for (Underlying i = 1; i <= 200'000; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    // Keys clustered like exchange ids, so probe runs collide and shift
+    const uint64_t key = (state >> 40) % 50'000;
+    if ((state >> 20) % 3 == 0) {
+      map.Erase(key);
+      reference.erase(key);
+    } else {
+      map.Insert({.external_id = key,
+                  .order_id = OrderId{i},
+                  .remaining = Quantity{1},
+                  .price = Price{1},
+                  .side = OrderSide::kBuy});
+      reference[key] = i;
+    }
+  }
+  ASSERT_EQ(map.size(), reference.size());
+  for (uint64_t key = 0; key < 50'000; ++key) {
+    auto* entry = map.Find(key);
+    auto it = reference.find(key);
+    ASSERT_EQ(entry != nullptr, it != reference.end()) << key;
+    if (entry != nullptr) {
+      EXPECT_EQ(entry->order_id.v, it->second);
+    }
+  }
+  EXPECT_LE(map.size() * 2, map.capacity());
+}
+
+TEST(LobsterImport, MapsMessagesToJournalEvents) {
+  std::ostringstream journal_text;
+  EventLog journal(&journal_text);
+  LobsterImporter importer(journal);
+
+  std::istringstream in(
+      "34200.01,1,9001,100,1000000,1\n"   // bid 100 @ 100.0000, id 1
+      "34200.02,1,9002,50,1001000,-1\n"   // ask 50 @ 100.1000, id 2
+      "34200.03,1,9003,30,1000000,1\n"    // bid 30 behind 9001, id 3
+      "34200.04,4,9001,40,1000000,1\n"    // 40 of 9001 trade, market id 4
+      "34200.05,2,9003,10,1000000,1\n"    // 9003 drops to 20 in place
+      "34200.06,3,9002,50,1001000,-1\n"   // ask deleted
+      "34200.07,5,0,7,1000500,-1\n"       // hidden execution
+      "34200.08,3,4242,5,999000,1\r\n"    // order from before the file
+      "garbage\n"
+      "34200.09,3,9003,20,1000000,1");     // no trailing newline
+  importer.ImportStream(in);
+
+  EXPECT_EQ(Lines(journal_text.str()),
+            (std::vector<std::string>{
+                "0 ADDLIMIT 0 BUY 100 1000000 GTC",
+                "1 ADDLIMIT 0 SELL 50 1001000 GTC",
+                "2 ADDLIMIT 0 BUY 30 1000000 GTC",
+                "3 ADDMARKET 0 SELL 40",
+                "4 MODIFY 3 20 1000000",
+                "5 CANCEL 2",
+                "6 CANCEL 3",
+            }));
+
+  const LobsterImportStats& stats = importer.stats();
+  EXPECT_EQ(stats.lines, 10);
+  EXPECT_EQ(stats.submits, 3);
+  EXPECT_EQ(stats.executions, 1);
+  EXPECT_EQ(stats.partial_cancels, 1);
+  EXPECT_EQ(stats.deletes, 2);
+  EXPECT_EQ(stats.skipped_no_order, 1);
+  EXPECT_EQ(stats.skipped_unknown_order, 1);
+  EXPECT_EQ(stats.malformed, 1);
+  EXPECT_EQ(stats.events_written, 7);
+  EXPECT_EQ(importer.open_orders(), 1);
+
+  // Replayed on a fresh book the predicted ids line up: only what is left of
+  // 9001 still rests
+  OrderBook book = Replay(journal_text.str());
+  EXPECT_EQ(book.BestBid(), Price{1'000'000});
+  EXPECT_EQ(book.DepthAt(OrderSide::kBuy, Price{1'000'000}), Quantity{60});
+  EXPECT_EQ(book.BestAsk(), std::nullopt);
+}
+
+TEST(LobsterImport, LinesSpanningReadBlocks) {
+  std::string input;
+  for (int i = 0; i < 60'000; ++i) {
+    input += "34200.000000001,1," + std::to_string(i + 1) + ",1," +
+             std::to_string(1'000'000 + i) + ",1\n";
+  }
+  ASSERT_GT(input.size(), std::size_t{1} << 21);
+
+  std::ostringstream journal_text;
+  EventLog journal(&journal_text);
+  LobsterImporter importer(journal);
+  std::istringstream in(input);
+  importer.ImportStream(in);
+  EXPECT_EQ(importer.stats().submits, 60'000);
+  EXPECT_EQ(importer.stats().malformed, 0);
+  EXPECT_EQ(importer.open_orders(), 60'000);
+}
+}  // namespace order_book_v1
@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <metrics.h>
+#include <orderbook.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace order_book_v1 {
+namespace {
+constexpr auto kGtc = TimeInForce::kGoodTillCancel;
+
+std::string TempPath(const char* stem) {
+  return std::string("/tmp/orderbook_") + stem + "_" +
+         std::to_string(getpid());
+}
+
+std::string Scrape(const std::string& socket_path) {
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, socket_path.c_str(), socket_path.size() + 1);
+  if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) !=
+      0) {
+    close(fd);
+    return "";
+  }
+  const std::string request = "GET /metrics HTTP/1.0\r\n\r\n";
+  EXPECT_EQ(write(fd, request.data(), request.size()),
+            static_cast<ssize_t>(request.size()));
+  std::string response;
+  char buf[512];
+  for (ssize_t n; (n = read(fd, buf, sizeof(buf))) > 0;) {
+    response.append(buf, static_cast<std::size_t>(n));
+  }
+  close(fd);
+  return response;
+}
+}  // namespace
+
+TEST(Metrics, BlocksDoNotShareCacheLines) {
+  EXPECT_EQ(alignof(BookMetrics), kCacheLineSize);
+  EXPECT_EQ(sizeof(BookMetrics) % kCacheLineSize, 0);
+}
+
+TEST(Metrics, OrderBookCountsEveryOutcome) {
+  BookMetrics metrics;
+  OrderBook ob;
+  ob.SetMetrics(&metrics);
+
+  auto a = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                       kGtc);
+  auto b = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{11}, Quantity{5},
+                       kGtc);
+  auto c = ob.AddLimit(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{5}, kGtc);
+  ASSERT_TRUE(a.has_value() && b.has_value() && c.has_value());
+  EXPECT_EQ(metrics.levels_created.Load(), 3);
+  EXPECT_EQ(metrics.resting_orders.Load(), 3);
+  EXPECT_EQ(metrics.peak_levels.Load(), 3);
+
+  auto sweep = ob.AddMarket(UserId{2}, OrderSide::kBuy, Quantity{7});
+  ASSERT_TRUE(sweep.has_value());
+  EXPECT_EQ(metrics.fills.Load(), 2);
+  EXPECT_EQ(metrics.levels_destroyed.Load(), 1);
+
+  EXPECT_TRUE(ob.Cancel(c->order_id));
+  EXPECT_FALSE(ob.Cancel(c->order_id));
+  auto bad_qty =
+      ob.AddLimit(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{0}, kGtc);
+  auto empty = ob.AddMarket(UserId{2}, OrderSide::kSell, Quantity{1});
+  EXPECT_FALSE(bad_qty.has_value());
+  EXPECT_FALSE(empty.has_value());
+
+  EXPECT_EQ(metrics.limit_orders.Load(), 4);
+  EXPECT_EQ(metrics.market_orders.Load(), 2);
+  EXPECT_EQ(metrics.cancels_hit.Load(), 1);
+  EXPECT_EQ(metrics.cancels_miss.Load(), 1);
+  EXPECT_EQ(metrics.rejects[static_cast<std::size_t>(RejectReason::kBadQty)]
+                .Load(),
+            1);
+  EXPECT_EQ(metrics
+                .rejects[static_cast<std::size_t>(
+                    RejectReason::kEmptyBookForMarket)]
+                .Load(),
+            1);
+  EXPECT_EQ(metrics.levels_destroyed.Load(), 2);
+  EXPECT_EQ(metrics.resting_orders.Load(), 1);
+  EXPECT_EQ(metrics.peak_levels.Load(), 3);
+}
+
+TEST(Metrics, MassCancelCountsItsOrdersAsCancelHits) {
+  BookMetrics metrics;
+  OrderBook ob;
+  ob.SetMetrics(&metrics);
+  for (Underlying price = 5; price < 8; ++price) {
+    auto bid = ob.AddLimit(UserId{1}, OrderSide::kBuy, Price{price},
+                           Quantity{1}, kGtc);
+    ASSERT_TRUE(bid.has_value());
+  }
+
+  EXPECT_EQ(ob.CancelAllForUser(UserId{1}), 3);
+  EXPECT_EQ(ob.CancelAllForUser(UserId{1}), 0);
+
+  EXPECT_EQ(metrics.mass_cancels.Load(), 2);
+  EXPECT_EQ(metrics.cancels_hit.Load(), 3);
+  EXPECT_EQ(metrics.cancels_miss.Load(), 0);
+  EXPECT_EQ(metrics.resting_orders.Load(), 0);
+}
+
+TEST(Metrics, RegistryAggregatesBooks) {
+  MetricsRegistry registry;
+  OrderBook first;
+  OrderBook second;
+  first.SetMetrics(&registry.Register());
+  second.SetMetrics(&registry.Register());
+  auto a =
+      first.AddLimit(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{1}, kGtc);
+  auto b =
+      second.AddLimit(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{1}, kGtc);
+  auto c =
+      second.AddLimit(UserId{1}, OrderSide::kBuy, Price{6}, Quantity{1}, kGtc);
+
+  MetricsSnapshot snapshot = registry.Aggregate();
+  EXPECT_EQ(snapshot.books, 2);
+  EXPECT_EQ(snapshot.limit_orders, 3);
+  EXPECT_EQ(snapshot.resting_orders, 3);
+  EXPECT_EQ(snapshot.peak_levels, 2);
+
+  std::ostringstream os;
+  snapshot.WritePrometheus(os);
+  EXPECT_NE(os.str().find("orderbook_orders_total{type=\"limit\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(os.str().find("# TYPE orderbook_resting_orders gauge\n"),
+            std::string::npos);
+}
+
+TEST(Metrics, ExporterWritesFileAndServesSocket) {
+  MetricsRegistry registry;
+  OrderBook ob;
+  ob.SetMetrics(&registry.Register());
+
+  const std::string file_path = TempPath("metrics.prom");
+  const std::string socket_path = TempPath("metrics.sock");
+  MetricsExporter exporter(registry,
+                           {.interval = std::chrono::milliseconds(10),
+                            .file_path = file_path,
+                            .socket_path = socket_path});
+  ASSERT_TRUE(exporter.Start().has_value());
+
+  auto add = ob.AddLimit(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{1},
+                         kGtc);
+  ASSERT_TRUE(add.has_value());
+
+  std::string response = Scrape(socket_path);
+  EXPECT_EQ(response.rfind("HTTP/1.0 200 OK\r\n", 0), 0);
+  EXPECT_NE(response.find("orderbook_resting_orders 1\n"), std::string::npos);
+
+  exporter.Stop();
+  std::ifstream file(file_path);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  EXPECT_NE(contents.str().find("orderbook_orders_total{type=\"limit\"} 1\n"),
+            std::string::npos);
+  std::remove(file_path.c_str());
+  EXPECT_NE(access(socket_path.c_str(), F_OK), 0);
+}
+}  // namespace order_book_v1
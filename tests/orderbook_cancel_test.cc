@@ -65,4 +65,110 @@ TEST_F(OrderBookTest, CancelFullyTradedOrderFails) {
   EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{0});
   EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{0});
 }
+
+TEST_F(OrderBookTest, CancelAllForUserLeavesOtherUsers) {
+  // Arrange
+  auto b1 = AddLimitOk(UserId{1}, OrderSide::kBuy, Price{5}, Quantity{5},
+                       TimeInForce::kGoodTillCancel);
+  auto b2 = AddLimitOk(UserId{2}, OrderSide::kBuy, Price{5}, Quantity{3},
+                       TimeInForce::kGoodTillCancel);
+  auto b3 = AddLimitOk(UserId{1}, OrderSide::kBuy, Price{4}, Quantity{5},
+                       TimeInForce::kGoodTillCancel);
+  auto a1 = AddLimitOk(UserId{1}, OrderSide::kSell, Price{9}, Quantity{5},
+                       TimeInForce::kGoodTillCancel);
+  auto a2 = AddLimitOk(UserId{2}, OrderSide::kSell, Price{9}, Quantity{2},
+                       TimeInForce::kGoodTillCancel);
+
+  // Act
+  std::size_t bids_cancelled = ob_.CancelAllForUser(UserId{1}, OrderSide::kBuy);
+  Quantity ask_depth = ob_.DepthAt(OrderSide::kSell, Price{9});
+  std::size_t rest_cancelled = ob_.CancelAllForUser(UserId{1});
+
+  // Assert
+  EXPECT_EQ(bids_cancelled, 2);
+  EXPECT_EQ(ask_depth, Quantity{7});
+  EXPECT_EQ(rest_cancelled, 1);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{5}), Quantity{3});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{4}), Quantity{0});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{9}), Quantity{2});
+  EXPECT_EQ(ob_.CancelAllForUser(UserId{1}), 0);
+  EXPECT_FALSE(ob_.Cancel(b1->order_id));
+  EXPECT_FALSE(ob_.Cancel(b3->order_id));
+  EXPECT_FALSE(ob_.Cancel(a1->order_id));
+  EXPECT_TRUE(ob_.Cancel(b2->order_id));
+  EXPECT_TRUE(ob_.Cancel(a2->order_id));
+}
+
+TEST_F(OrderBookTest, CancelAllForUserSkipsFilledOrders) {
+  // Arrange
+  auto filled = AddLimitOk(UserId{1}, OrderSide::kSell, Price{10},
+                           Quantity{5}, TimeInForce::kGoodTillCancel);
+  auto resting = AddLimitOk(UserId{1}, OrderSide::kSell, Price{11},
+                            Quantity{5}, TimeInForce::kGoodTillCancel);
+  auto taker = AddMarketOk(UserId{2}, OrderSide::kBuy, Quantity{5});
+
+  // Act
+  std::size_t cancelled = ob_.CancelAllForUser(UserId{1});
+
+  // Assert
+  AssertAddResult(taker, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(cancelled, 1);
+  EXPECT_FALSE(ob_.Cancel(filled->order_id));
+  EXPECT_FALSE(ob_.Cancel(resting->order_id));
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+  EXPECT_EQ(ob_.CancelAllForUser(UserId{3}), 0);
+}
+
+TEST_F(OrderBookTest, CancelAllForUserCancelsWaitingStops) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{5}}});
+  auto buy_stop =
+      ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{10}, Quantity{2});
+  auto sell_stop =
+      ob_.AddStop(UserId{1}, OrderSide::kSell, Price{4}, Quantity{1});
+  auto other = ob_.AddStop(UserId{2}, OrderSide::kBuy, Price{10}, Quantity{1});
+  ASSERT_TRUE(buy_stop.has_value() && sell_stop.has_value() &&
+              other.has_value());
+
+  // Act
+  std::size_t cancelled = ob_.CancelAllForUser(UserId{1}, OrderSide::kBuy);
+  auto taker = AddMarketOk(UserId{3}, OrderSide::kBuy, Quantity{1});
+
+  // Assert
+  // Only the other user's stop is left to trigger on the print at 10
+  EXPECT_EQ(cancelled, 1);
+  ASSERT_EQ(taker->triggered_trades.size(), 1);
+  EXPECT_EQ(taker->triggered_trades[0].order_id, other->order_id);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{3});
+  EXPECT_EQ(ob_.MemoryStats().stop_orders, 1);
+  EXPECT_FALSE(ob_.Cancel(buy_stop->order_id));
+  EXPECT_EQ(ob_.CancelAllForUser(UserId{1}), 1);
+  EXPECT_EQ(ob_.MemoryStats().stop_orders, 0);
+}
+
+TEST_F(OrderBookTest, UserIndexOnlyHoldsUsersWithOrders) {
+  // Arrange
+  auto first = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{5}, Quantity{1},
+                          TimeInForce::kGoodTillCancel);
+  ob_.Cancel(first->order_id);
+  const std::size_t empty_bytes = ob_.MemoryStats().user_index_bytes;
+
+  // Act
+  // Every user leaves by a different path: cancel, fill and mass cancel
+  for (Underlying user = 1; user <= 300; ++user) {
+    auto bid = AddLimitOk(UserId{user}, OrderSide::kBuy, Price{5},
+                          Quantity{1}, TimeInForce::kGoodTillCancel);
+    if (user % 3 == 0) {
+      ob_.Cancel(bid->order_id);
+    } else if (user % 3 == 1) {
+      auto taker = AddMarketOk(UserId{0}, OrderSide::kSell, Quantity{1});
+    } else {
+      ob_.CancelAllForUser(UserId{user});
+    }
+  }
+
+  // Assert
+  EXPECT_EQ(ob_.BestBid(), std::nullopt);
+  EXPECT_EQ(ob_.MemoryStats().user_index_bytes, empty_bytes);
+}
 }  // namespace order_book_v1
@@ -0,0 +1,82 @@
+#include "orderbook_test.h"
+
+namespace order_book_v1 {
+TEST_F(OrderBookTest, AddIcebergShowsOnlyDisplayQty) {
+  // Act
+  auto result = ob_.AddIceberg(UserId{1}, OrderSide::kSell, Price{10},
+                               Quantity{100}, Quantity{10});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kAwaitingFill, Quantity{100}, 0);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{10});
+}
+
+TEST_F(OrderBookTest, AddIcebergReplenishesAtBackOfLevel) {
+  // Arrange
+  auto iceberg = ob_.AddIceberg(UserId{1}, OrderSide::kSell, Price{10},
+                                Quantity{30}, Quantity{10});
+  auto plain = AddLimitOk(UserId{2}, OrderSide::kSell, Price{10}, Quantity{5},
+                          TimeInForce::kGoodTillCancel);
+
+  // Act
+  auto first = AddMarketOk(UserId{3}, OrderSide::kBuy, Quantity{10});
+  Quantity depth_after_first = ob_.DepthAt(OrderSide::kSell, Price{10});
+  auto second = AddMarketOk(UserId{3}, OrderSide::kBuy, Quantity{5});
+  auto sweep = AddMarketOk(UserId{3}, OrderSide::kBuy, Quantity{25});
+
+  // Assert
+  ASSERT_TRUE(iceberg.has_value());
+  AssertAddResult(first, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(first->immediate_trades[0].maker_id, UserId{1});
+  // The next slice of 10 now queues behind the plain order
+  EXPECT_EQ(depth_after_first, Quantity{15});
+  AssertAddResult(second, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(second->immediate_trades[0].maker_id, UserId{2});
+  // Two slices of 10 are left; the taker's last 5 find nothing
+  AssertAddResult(sweep, OrderStatus::kPartialFill, Quantity{5}, 2);
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+  EXPECT_FALSE(ob_.Cancel(iceberg->order_id));
+}
+
+TEST_F(OrderBookTest, AddIcebergTradesFullQtyOnArrival) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{50}}});
+
+  // Act
+  auto result = ob_.AddIceberg(UserId{1}, OrderSide::kBuy, Price{10},
+                               Quantity{60}, Quantity{5});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kPartialFill, Quantity{10}, 1);
+  EXPECT_EQ(result->immediate_trades[0].qty, Quantity{50});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{5});
+}
+
+TEST_F(OrderBookTest, ModifyIcebergReducesHiddenFirst) {
+  // Arrange
+  auto iceberg = ob_.AddIceberg(UserId{1}, OrderSide::kBuy, Price{10},
+                                Quantity{30}, Quantity{10});
+  ASSERT_TRUE(iceberg.has_value());
+
+  // Act
+  auto hidden_only = ob_.Modify(iceberg->order_id, Quantity{15}, Price{10});
+  Quantity depth_after_hidden = ob_.DepthAt(OrderSide::kBuy, Price{10});
+  auto into_shown = ob_.Modify(iceberg->order_id, Quantity{4}, Price{10});
+
+  // Assert
+  AssertAddResult(hidden_only, OrderStatus::kAwaitingFill, Quantity{15}, 0);
+  EXPECT_EQ(depth_after_hidden, Quantity{10});
+  AssertAddResult(into_shown, OrderStatus::kAwaitingFill, Quantity{4}, 0);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{4});
+}
+
+TEST_F(OrderBookTest, AddIcebergWithZeroDisplayRejected) {
+  // Act
+  auto result = ob_.AddIceberg(UserId{1}, OrderSide::kBuy, Price{10},
+                               Quantity{30}, Quantity{0});
+
+  // Assert
+  EXPECT_EQ(result.error(), RejectReason::kBadQty);
+  EXPECT_EQ(ob_.BestBid(), std::nullopt);
+}
+}  // namespace order_book_v1
@@ -34,4 +34,45 @@ TEST_F(OrderBookTest, AddLimitRestMultipleBuySell) {
   EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{5});
   EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{1}), Quantity{10});
 }
+
+TEST_F(OrderBookTest, MemoryStatsEmptyBook) {
+  // Act
+  BookMemoryStats stats = ob_.MemoryStats();
+
+  // Assert
+  EXPECT_EQ(stats.levels, 0);
+  EXPECT_EQ(stats.orders, 0);
+  EXPECT_EQ(stats.level_node_bytes + stats.order_node_bytes +
+                stats.index_node_bytes,
+            0);
+  EXPECT_EQ(stats.bytes_per_order(), 0.0);
+}
+
+TEST_F(OrderBookTest, MemoryStatsScalesWithRestingOrders) {
+  // Arrange
+  ArrangeBidLevels({{Price{1}, Quantity{5}}, {Price{1}, Quantity{5}}});
+  ArrangeAskLevels({{Price{10}, Quantity{5}}});
+  BookMemoryStats before = ob_.MemoryStats();
+  auto result = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{2}, Quantity{5},
+                           TimeInForce::kGoodTillCancel);
+
+  // Act
+  BookMemoryStats after = ob_.MemoryStats();
+
+  // Assert
+  EXPECT_EQ(before.levels, 2);
+  EXPECT_EQ(before.orders, 3);
+  EXPECT_EQ(before.index_entries, 3);
+  EXPECT_EQ(after.levels, 3);
+  EXPECT_EQ(after.orders, 4);
+  EXPECT_EQ(after.level_node_bytes, before.level_node_bytes / 2 * 3);
+  EXPECT_EQ(after.order_node_bytes, before.order_node_bytes / 3 * 4);
+  // Every node is at least one pointer-sized link plus its payload
+  EXPECT_GT(after.order_node_bytes / after.orders, sizeof(Order));
+  EXPECT_GT(after.level_node_bytes / after.levels, sizeof(Level));
+  EXPECT_GE(after.index_buckets, after.index_entries);
+  EXPECT_EQ(after.pool_bytes, 0);
+  EXPECT_DOUBLE_EQ(after.bytes_per_order(),
+                   static_cast<double>(after.total_bytes()) / 4.0);
+}
 }  // namespace order_book_v1
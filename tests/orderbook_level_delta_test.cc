@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <map>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "level_delta.h"
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+class RecordingSink : public LevelDeltaSink {
+ public:
+  void OnLevelDeltas(std::span<const LevelDelta> deltas) override {
+    batches.emplace_back(deltas.begin(), deltas.end());
+    for (const auto& delta : deltas) {
+      auto key = std::make_pair(delta.side, delta.price.v);
+      if (delta.removed) {
+        mirror.erase(key);
+      } else {
+        mirror[key] = delta.aggregate_qty;
+      }
+    }
+  }
+
+  std::vector<std::vector<LevelDelta>> batches;
+  std::map<std::pair<OrderSide, Underlying>, Quantity> mirror;
+};
+}  // namespace
+
+class LevelDeltaTest : public testing::Test {
+ protected:
+  void SetUp() override { ob_.SetLevelDeltaSink(&sink_); }
+
+  OrderBook ob_;
+  RecordingSink sink_;
+};
+
+TEST_F(LevelDeltaTest, RestingLimitEmitsSingleDelta) {
+  // Act
+  auto result = ob_.AddLimit(UserId{0}, OrderSide::kBuy, Price{10},
+                             Quantity{5}, TimeInForce::kGoodTillCancel);
+
+  // Assert
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 1);
+  EXPECT_EQ(sink_.batches[0][0].side, OrderSide::kBuy);
+  EXPECT_EQ(sink_.batches[0][0].price, Price{10});
+  EXPECT_EQ(sink_.batches[0][0].aggregate_qty, Quantity{5});
+  EXPECT_FALSE(sink_.batches[0][0].removed);
+}
+
+TEST_F(LevelDeltaTest, CrossingMultipleLevelsEmitsOneBatch) {
+  // Arrange
+  auto a1 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{5},
+                         TimeInForce::kGoodTillCancel);
+  auto a2 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{15}, Quantity{10},
+                         TimeInForce::kGoodTillCancel);
+  sink_.batches.clear();
+
+  // Act
+  auto b3 = ob_.AddLimit(UserId{1}, OrderSide::kBuy, Price{15}, Quantity{8},
+                         TimeInForce::kGoodTillCancel);
+
+  // Assert
+  // B3 takes all of A1 (removing level 10) and 3 from A2 at level 15
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 2);
+  EXPECT_EQ(sink_.batches[0][0].price, Price{10});
+  EXPECT_TRUE(sink_.batches[0][0].removed);
+  EXPECT_EQ(sink_.batches[0][1].price, Price{15});
+  EXPECT_EQ(sink_.batches[0][1].aggregate_qty, Quantity{7});
+  EXPECT_FALSE(sink_.batches[0][1].removed);
+}
+
+TEST_F(LevelDeltaTest, FillsOnSameLevelAreCoalesced) {
+  // Arrange
+  for (int i = 0; i < 3; ++i) {
+    auto a = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{2},
+                          TimeInForce::kGoodTillCancel);
+  }
+  sink_.batches.clear();
+
+  // Act
+  auto result = ob_.AddMarket(UserId{1}, OrderSide::kBuy, Quantity{5});
+
+  // Assert
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 1);
+  EXPECT_EQ(sink_.batches[0][0].aggregate_qty, Quantity{1});
+}
+
+TEST_F(LevelDeltaTest, LevelTouchedAgainLaterInEventIsCoalesced) {
+  // Arrange
+  auto a1 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{2},
+                         TimeInForce::kGoodTillCancel);
+  auto a2 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{11}, Quantity{5},
+                         TimeInForce::kGoodTillCancel);
+  auto stop = ob_.AddStop(UserId{1}, OrderSide::kSell, Price{10}, Quantity{4},
+                          Price{10});
+  sink_.batches.clear();
+
+  // Act
+  auto result = ob_.AddMarket(UserId{2}, OrderSide::kBuy, Quantity{3});
+
+  // Assert
+  // The sweep empties 10 and dips into 11, then the released stop-limit
+  // rests at 10 again
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 2);
+  EXPECT_EQ(sink_.batches[0][0].price, Price{10});
+  EXPECT_EQ(sink_.batches[0][0].aggregate_qty, Quantity{4});
+  EXPECT_FALSE(sink_.batches[0][0].removed);
+  EXPECT_EQ(sink_.batches[0][1].price, Price{11});
+  EXPECT_EQ(sink_.batches[0][1].aggregate_qty, Quantity{4});
+}
+
+TEST_F(LevelDeltaTest, RecreatedLevelAfterOthersIsCoalesced) {
+  // Arrange
+  auto a1 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{1},
+                         TimeInForce::kGoodTillCancel);
+  auto a2 = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{11}, Quantity{1},
+                         TimeInForce::kGoodTillCancel);
+  auto stop = ob_.AddStop(UserId{1}, OrderSide::kSell, Price{11}, Quantity{4},
+                          Price{11});
+  sink_.batches.clear();
+
+  // Act
+  auto result = ob_.AddMarket(UserId{2}, OrderSide::kBuy, Quantity{2});
+
+  // Assert
+  // The sweep empties 10 and then 11, and the released stop-limit re-creates
+  // 11, whose first entry is not the batch's first
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 2);
+  EXPECT_EQ(sink_.batches[0][0].price, Price{10});
+  EXPECT_TRUE(sink_.batches[0][0].removed);
+  EXPECT_EQ(sink_.batches[0][1].price, Price{11});
+  EXPECT_EQ(sink_.batches[0][1].aggregate_qty, Quantity{4});
+  EXPECT_FALSE(sink_.batches[0][1].removed);
+}
+
+TEST_F(LevelDeltaTest, RequeuedSoleOrderEmitsSingleDelta) {
+  // Arrange
+  auto bid = ob_.AddLimit(UserId{0}, OrderSide::kBuy, Price{9}, Quantity{1},
+                          TimeInForce::kGoodTillCancel);
+  auto ask = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{2},
+                          TimeInForce::kGoodTillCancel);
+  sink_.batches.clear();
+
+  // Act
+  auto result = ob_.Modify(ask->order_id, Quantity{5}, Price{10});
+
+  // Assert
+  ASSERT_TRUE(result.has_value());
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 1);
+  EXPECT_EQ(sink_.batches[0][0].price, Price{10});
+  EXPECT_EQ(sink_.batches[0][0].aggregate_qty, Quantity{5});
+  EXPECT_FALSE(sink_.batches[0][0].removed);
+}
+
+TEST_F(LevelDeltaTest, CancelLastOrderRemovesLevel) {
+  // Arrange
+  auto result = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10},
+                             Quantity{5}, TimeInForce::kGoodTillCancel);
+  sink_.batches.clear();
+
+  // Act
+  ob_.Cancel(result->order_id);
+
+  // Assert
+  ASSERT_EQ(sink_.batches.size(), 1);
+  ASSERT_EQ(sink_.batches[0].size(), 1);
+  EXPECT_TRUE(sink_.batches[0][0].removed);
+  EXPECT_TRUE(sink_.mirror.empty());
+}
+
+TEST_F(LevelDeltaTest, NoChangeEmitsNothing) {
+  // Act
+  auto result1 = ob_.AddLimit(UserId{0}, OrderSide::kBuy, Price{10},
+                              Quantity{0}, TimeInForce::kGoodTillCancel);
+  auto result2 = ob_.AddMarket(UserId{0}, OrderSide::kBuy, Quantity{5});
+  ob_.Cancel(OrderId{999});
+
+  // Assert
+  EXPECT_TRUE(sink_.batches.empty());
+}
+
+TEST_F(LevelDeltaTest, SelfTradeCancellingTakerEmitsNothing) {
+  // Arrange
+  auto ask = ob_.AddLimit(UserId{0}, OrderSide::kSell, Price{10}, Quantity{5},
+                          TimeInForce::kGoodTillCancel);
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelNewest);
+  sink_.batches.clear();
+
+  // Act
+  auto result = ob_.AddMarket(UserId{0}, OrderSide::kBuy, Quantity{3});
+
+  // Assert
+  ASSERT_TRUE(result.has_value());
+  EXPECT_TRUE(sink_.batches.empty());
+}
+
+TEST_F(LevelDeltaTest, MirrorBookTracksSource) {
+  // Arrange
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<Underlying> price_rn(1, 20);
+  std::uniform_int_distribution<Underlying> qty_rn(1, 10);
+  std::uniform_int_distribution<int> action_rn(0, 9);
+  std::vector<OrderId> ids;
+
+  // Act
+  for (int i = 0; i < 2000; ++i) {
+    OrderSide side = rng() % 2 == 0 ? OrderSide::kBuy : OrderSide::kSell;
+    int action = action_rn(rng);
+    if (action < 6) {
+      auto r = ob_.AddLimit(UserId{0}, side, Price{price_rn(rng)},
+                            Quantity{qty_rn(rng)},
+                            TimeInForce::kGoodTillCancel);
+      if (r.has_value()) ids.emplace_back(r->order_id);
+    } else if (action < 8) {
+      auto r = ob_.AddMarket(UserId{0}, side, Quantity{qty_rn(rng)});
+    } else if (!ids.empty()) {
+      ob_.Cancel(ids[rng() % ids.size()]);
+    }
+  }
+
+  // Assert
+  std::size_t non_empty_levels = 0;
+  for (Underlying p = 1; p <= 20; ++p) {
+    for (OrderSide side : {OrderSide::kBuy, OrderSide::kSell}) {
+      Quantity depth = ob_.DepthAt(side, Price{p});
+      auto it = sink_.mirror.find({side, p});
+      Quantity mirrored = it == sink_.mirror.end() ? Quantity{0} : it->second;
+      EXPECT_EQ(depth, mirrored);
+      if (depth != Quantity{0}) ++non_empty_levels;
+    }
+  }
+  EXPECT_EQ(sink_.mirror.size(), non_empty_levels);
+}
+}  // namespace order_book_v1
@@ -149,4 +149,23 @@ TEST_F(OrderBookTest, AddLimitCrossingSellImmediateOrCancelDiscardsRemainder) {
   EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{8}), Quantity{0});
   EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{5}), Quantity{5});
 }
+
+TEST_F(OrderBookTest, AddLimitCrossingSellFillOrKillExactlyCovered) {
+  // Arrange
+  ArrangeBidLevels({{Price{5}, Quantity{5}},
+                    {Price{8}, Quantity{4}},
+                    {Price{9}, Quantity{3}}});
+
+  // Act
+  // Levels 9 and 8 hold exactly 7; level 5 is beyond the limit
+  auto result = AddLimitOk(UserId{0}, OrderSide::kSell, Price{8}, Quantity{7},
+                           TimeInForce::kFillOrKill);
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kImmediateFill, Quantity{0}, 2);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{9}), Quantity{0});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{8}), Quantity{0});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{5}), Quantity{5});
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+}
 }  // namespace order_book_v1
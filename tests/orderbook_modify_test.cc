@@ -0,0 +1,120 @@
+#include <cstddef>
+#include <sstream>
+#include <variant>
+
+#include "orderbook_test.h"
+
+namespace order_book_v1 {
+TEST_F(OrderBookTest, ModifyReduceKeepsQueuePosition) {
+  // Arrange
+  auto ids =
+      ArrangeAskLevels({{Price{10}, Quantity{5}}, {Price{10}, Quantity{5}}});
+
+  // Act
+  auto result = ob_.Modify(ids[0], Quantity{2}, Price{10});
+  auto taker = AddMarketOk(UserId{1}, OrderSide::kBuy, Quantity{2});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kAwaitingFill, Quantity{2}, 0);
+  EXPECT_EQ(result->order_id, ids[0]);
+  // The reduced order is still first in line
+  AssertAddResult(taker, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{5});
+  EXPECT_FALSE(ob_.Cancel(ids[0]));
+}
+
+TEST_F(OrderBookTest, ModifyIncreaseMovesToBackOfLevel) {
+  // Arrange
+  auto ids =
+      ArrangeAskLevels({{Price{10}, Quantity{5}}, {Price{10}, Quantity{5}}});
+
+  // Act
+  auto result = ob_.Modify(ids[0], Quantity{8}, Price{10});
+  auto taker = AddMarketOk(UserId{1}, OrderSide::kBuy, Quantity{5});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kAwaitingFill, Quantity{8}, 0);
+  // The second order now trades first
+  AssertAddResult(taker, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_FALSE(ob_.Cancel(ids[1]));
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{8});
+}
+
+TEST_F(OrderBookTest, ModifyPriceRequeuesAtNewLevel) {
+  // Arrange
+  auto ids =
+      ArrangeBidLevels({{Price{5}, Quantity{5}}, {Price{7}, Quantity{3}}});
+
+  // Act
+  auto result = ob_.Modify(ids[0], Quantity{4}, Price{7});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kAwaitingFill, Quantity{4}, 0);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{5}), Quantity{0});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{7}), Quantity{7});
+  auto top = ob_.TopLevels(OrderSide::kBuy, 5);
+  ASSERT_EQ(top.size(), 1);
+  EXPECT_EQ(top[0].orders, 2);
+}
+
+TEST_F(OrderBookTest, ModifyPriceThatCrossesTrades) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{3}}});
+  auto bids = ArrangeBidLevels({{Price{8}, Quantity{5}}});
+
+  // Act
+  auto result = ob_.Modify(bids[0], Quantity{5}, Price{10});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kPartialFill, Quantity{2}, 1);
+  EXPECT_EQ(result->immediate_trades[0].order_id, bids[0]);
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{8}), Quantity{0});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{2});
+  EXPECT_TRUE(ob_.Cancel(bids[0]));
+}
+
+TEST_F(OrderBookTest, ModifyRejects) {
+  // Arrange
+  auto ids = ArrangeBidLevels({{Price{5}, Quantity{5}}});
+
+  // Act & Assert
+  EXPECT_EQ(ob_.Modify(ids[0], Quantity{0}, Price{5}).error(),
+            RejectReason::kBadQty);
+  EXPECT_EQ(ob_.Modify(ids[0], Quantity{1}, Price{0}).error(),
+            RejectReason::kBadPrice);
+  EXPECT_EQ(ob_.Modify(OrderId{99}, Quantity{1}, Price{5}).error(),
+            RejectReason::kUnknownOrder);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{5}), Quantity{5});
+}
+
+TEST(OrderBookModify, JournalReplaysToSameBook) {
+  // Arrange
+  std::ostringstream journal;
+  OrderBook ob(&journal);
+  auto a = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                       TimeInForce::kGoodTillCancel);
+  auto b = ob.AddLimit(UserId{2}, OrderSide::kBuy, Price{8}, Quantity{6},
+                       TimeInForce::kGoodTillCancel);
+  ASSERT_TRUE(a.has_value() && b.has_value());
+
+  // Act
+  auto reduced = ob.Modify(a->order_id, Quantity{4}, Price{10});
+  auto crossed = ob.Modify(b->order_id, Quantity{6}, Price{10});
+  auto unknown = ob.Modify(OrderId{77}, Quantity{1}, Price{1});
+
+  // Assert
+  EXPECT_TRUE(reduced.has_value());
+  EXPECT_TRUE(crossed.has_value());
+  EXPECT_FALSE(unknown.has_value());
+  OrderBook replayed;
+  const auto events = ReplayJournal(journal.str(), replayed);
+  std::size_t modifies = 0;
+  for (const auto& event : events) {
+    if (std::holds_alternative<ModifyOrderEvent>(event)) ++modifies;
+  }
+  EXPECT_EQ(modifies, 3);
+  EXPECT_EQ(replayed.ToHash(), ob.ToHash());
+  EXPECT_EQ(replayed.DepthAt(OrderSide::kBuy, Price{10}), Quantity{2});
+}
+}  // namespace order_book_v1
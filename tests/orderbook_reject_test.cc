@@ -30,4 +30,33 @@ TEST_F(OrderBookTest, AddMarketWithEmptyBook) {
   EXPECT_EQ(result1.error(), RejectReason::kEmptyBookForMarket);
   EXPECT_EQ(result2.error(), RejectReason::kEmptyBookForMarket);
 }
+
+TEST_F(OrderBookTest, AddLimitFillOrKillWithoutEnoughLiquidity) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{5}}, {Price{12}, Quantity{5}}});
+  const FixedWidth before = ob_.ToHash();
+
+  // Act
+  // 10 is available, but only 5 of it at or below the limit
+  auto result = AddLimitError(UserId{1}, OrderSide::kBuy, Price{11},
+                              Quantity{10}, TimeInForce::kFillOrKill);
+
+  // Assert
+  EXPECT_EQ(result.error(), RejectReason::kInsufficientLiquidity);
+  EXPECT_EQ(ob_.ToHash(), before);
+  // The kill did not take an order id
+  auto next = AddLimitOk(UserId{1}, OrderSide::kBuy, Price{1}, Quantity{1},
+                         TimeInForce::kGoodTillCancel);
+  EXPECT_EQ(next->order_id, OrderId{3});
+}
+
+TEST_F(OrderBookTest, AddLimitFillOrKillSellAgainstEmptySide) {
+  // Act
+  auto result = AddLimitError(UserId{1}, OrderSide::kSell, Price{1},
+                              Quantity{1}, TimeInForce::kFillOrKill);
+
+  // Assert
+  EXPECT_EQ(result.error(), RejectReason::kInsufficientLiquidity);
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+}
 }  // namespace order_book_v1
@@ -0,0 +1,144 @@
+#include <sstream>
+
+#include "orderbook_test.h"
+
+namespace order_book_v1 {
+namespace {
+// Ask level at 10: five of user 0's own, then five of user 2's
+class SelfTradeTest : public OrderBookTest {
+ protected:
+  void SetUp() override {
+    own_ = ArrangeAskLevels({{Price{10}, Quantity{5}}})[0];
+    auto other = AddLimitOk(UserId{2}, OrderSide::kSell, Price{10},
+                            Quantity{5}, TimeInForce::kGoodTillCancel);
+  }
+
+  void ExpectPrevented(const AddResult& result, SelfTradePrevention action) {
+    ASSERT_TRUE(result.has_value());
+    ASSERT_EQ(result->prevented_trades.size(), 1);
+    const PreventedTrade& prevented = result->prevented_trades[0];
+    EXPECT_EQ(prevented.user_id, UserId{0});
+    EXPECT_EQ(prevented.order_id, result->order_id);
+    EXPECT_EQ(prevented.resting_order_id, own_);
+    EXPECT_EQ(prevented.qty, Quantity{5});
+    EXPECT_EQ(prevented.price, Price{10});
+    EXPECT_EQ(prevented.action, action);
+  }
+
+  OrderId own_;
+};
+}  // namespace
+
+TEST_F(SelfTradeTest, TradesWithItselfByDefault) {
+  // Act
+  auto result = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{10}, Quantity{8},
+                           TimeInForce::kGoodTillCancel);
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kImmediateFill, Quantity{0}, 2);
+  EXPECT_EQ(result->immediate_trades[0].maker_id, UserId{0});
+  EXPECT_TRUE(result->prevented_trades.empty());
+}
+
+TEST_F(SelfTradeTest, CancelNewestCancelsIncomingOrder) {
+  // Arrange
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelNewest);
+
+  // Act
+  auto result = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{10}, Quantity{8},
+                           TimeInForce::kGoodTillCancel);
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kAwaitingFill, Quantity{0}, 0);
+  ExpectPrevented(result, SelfTradePrevention::kCancelNewest);
+  EXPECT_EQ(ob_.BestBid(), std::nullopt);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{10});
+}
+
+TEST_F(SelfTradeTest, CancelOldestCancelsRestingOrderAndKeepsMatching) {
+  // Arrange
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelOldest);
+
+  // Act
+  auto result = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{10}, Quantity{8},
+                           TimeInForce::kGoodTillCancel);
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kPartialFill, Quantity{3}, 1);
+  EXPECT_EQ(result->immediate_trades[0].maker_id, UserId{2});
+  ExpectPrevented(result, SelfTradePrevention::kCancelOldest);
+  EXPECT_EQ(ob_.BestAsk(), std::nullopt);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{3});
+  EXPECT_FALSE(ob_.Cancel(own_));
+}
+
+TEST_F(SelfTradeTest, CancelBothCancelsEachSide) {
+  // Arrange
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelBoth);
+
+  // Act
+  auto result = AddMarketOk(UserId{0}, OrderSide::kBuy, Quantity{8});
+
+  // Assert
+  // A market that cannot trade is dropped rather than left awaiting a fill
+  AssertAddResult(result, OrderStatus::kPartialFill, Quantity{0}, 0);
+  ExpectPrevented(result, SelfTradePrevention::kCancelBoth);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{5});
+  EXPECT_FALSE(ob_.Cancel(own_));
+}
+
+TEST_F(SelfTradeTest, DecrementTakesSmallerQtyOffBoth) {
+  // Arrange
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kDecrement);
+
+  // Act
+  auto result = AddMarketOk(UserId{0}, OrderSide::kBuy, Quantity{8});
+
+  // Assert
+  AssertAddResult(result, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(result->immediate_trades[0].qty, Quantity{3});
+  ExpectPrevented(result, SelfTradePrevention::kDecrement);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{2});
+  EXPECT_FALSE(ob_.Cancel(own_));
+}
+
+TEST_F(SelfTradeTest, FillOrKillDoesNotCountOwnOrders) {
+  // Arrange
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelNewest);
+
+  // Act
+  auto killed = AddLimitError(UserId{0}, OrderSide::kBuy, Price{10},
+                              Quantity{5}, TimeInForce::kFillOrKill);
+  ob_.SetSelfTradePrevention(SelfTradePrevention::kCancelOldest);
+  auto filled = AddLimitOk(UserId{0}, OrderSide::kBuy, Price{10}, Quantity{5},
+                           TimeInForce::kFillOrKill);
+
+  // Assert
+  EXPECT_EQ(killed.error(), RejectReason::kInsufficientLiquidity);
+  AssertAddResult(filled, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_EQ(filled->immediate_trades[0].maker_id, UserId{2});
+}
+
+TEST(OrderBookSelfTrade, JournalReplaysToSameBook) {
+  // Arrange
+  std::ostringstream journal;
+  OrderBook ob(&journal);
+  auto own = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                         TimeInForce::kGoodTillCancel);
+  auto other = ob.AddLimit(UserId{2}, OrderSide::kSell, Price{10},
+                           Quantity{5}, TimeInForce::kGoodTillCancel);
+  ASSERT_TRUE(own.has_value() && other.has_value());
+
+  // Act
+  ob.SetSelfTradePrevention(SelfTradePrevention::kDecrement);
+  auto taker = ob.AddMarket(UserId{1}, OrderSide::kBuy, Quantity{7});
+
+  // Assert
+  ASSERT_TRUE(taker.has_value());
+  EXPECT_EQ(taker->prevented_trades.size(), 1);
+  OrderBook replayed;
+  ReplayJournal(journal.str(), replayed);
+  EXPECT_EQ(replayed.ToHash(), ob.ToHash());
+  EXPECT_EQ(replayed.DepthAt(OrderSide::kSell, Price{10}), Quantity{3});
+}
+}  // namespace order_book_v1
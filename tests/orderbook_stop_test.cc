@@ -0,0 +1,183 @@
+#include <cstddef>
+#include <sstream>
+#include <variant>
+
+#include "orderbook_test.h"
+
+namespace order_book_v1 {
+TEST_F(OrderBookTest, AddStopWaitsUntilTradeReachesStopPrice) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{5}},
+                    {Price{11}, Quantity{5}},
+                    {Price{12}, Quantity{5}}});
+  auto stop = ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{11}, Quantity{3});
+
+  // Act
+  auto below = AddMarketOk(UserId{2}, OrderSide::kBuy, Quantity{5});
+  auto at_stop = AddMarketOk(UserId{2}, OrderSide::kBuy, Quantity{1});
+
+  // Assert
+  AssertAddResult(stop, OrderStatus::kAwaitingFill, Quantity{3}, 0);
+  EXPECT_TRUE(below->triggered_trades.empty());
+  AssertAddResult(at_stop, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  ASSERT_EQ(at_stop->triggered_trades.size(), 1);
+  EXPECT_EQ(at_stop->triggered_trades[0].order_id, stop->order_id);
+  EXPECT_EQ(at_stop->triggered_trades[0].taker_id, UserId{1});
+  EXPECT_EQ(at_stop->triggered_trades[0].qty, Quantity{3});
+  EXPECT_EQ(at_stop->triggered_trades[0].price, Price{11});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{11}), Quantity{1});
+  EXPECT_FALSE(ob_.Cancel(stop->order_id));
+}
+
+TEST_F(OrderBookTest, StopLimitRestsAtLimitOnceTriggered) {
+  // Arrange
+  ArrangeBidLevels({{Price{9}, Quantity{2}}});
+  auto stop = ob_.AddStop(UserId{1}, OrderSide::kSell, Price{9}, Quantity{4},
+                          Price{8});
+
+  // Act
+  auto taker = AddMarketOk(UserId{2}, OrderSide::kSell, Quantity{2});
+
+  // Assert
+  ASSERT_TRUE(stop.has_value());
+  AssertAddResult(taker, OrderStatus::kImmediateFill, Quantity{0}, 1);
+  EXPECT_TRUE(taker->triggered_trades.empty());
+  EXPECT_EQ(ob_.BestAsk(), Price{8});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{8}), Quantity{4});
+  // It rests under the id it was given as a stop
+  EXPECT_TRUE(ob_.Cancel(stop->order_id));
+}
+
+TEST_F(OrderBookTest, StopsReleaseInTriggerThenTimeOrder) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{1}},
+                    {Price{11}, Quantity{2}},
+                    {Price{12}, Quantity{2}},
+                    {Price{13}, Quantity{9}}});
+  auto far = ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{12}, Quantity{1});
+  auto near = ob_.AddStop(UserId{2}, OrderSide::kBuy, Price{11}, Quantity{3});
+  auto near_later =
+      ob_.AddStop(UserId{3}, OrderSide::kBuy, Price{11}, Quantity{1});
+  ASSERT_TRUE(far.has_value() && near.has_value() && near_later.has_value());
+
+  // Act
+  auto taker = AddMarketOk(UserId{4}, OrderSide::kBuy, Quantity{2});
+
+  // Assert
+  // The taker prints at 11, which releases the stops there oldest first.
+  // The first of them trades up to 12, so the stop at 12 follows them.
+  AssertAddResult(taker, OrderStatus::kImmediateFill, Quantity{0}, 2);
+  const auto& triggered = taker->triggered_trades;
+  ASSERT_EQ(triggered.size(), 4);
+  EXPECT_EQ(triggered[0].order_id, near->order_id);
+  EXPECT_EQ(triggered[0].price, Price{11});
+  EXPECT_EQ(triggered[1].order_id, near->order_id);
+  EXPECT_EQ(triggered[1].price, Price{12});
+  EXPECT_EQ(triggered[2].order_id, near_later->order_id);
+  EXPECT_EQ(triggered[2].price, Price{13});
+  EXPECT_EQ(triggered[3].order_id, far->order_id);
+  EXPECT_EQ(triggered[3].price, Price{13});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{13}), Quantity{7});
+}
+
+TEST_F(OrderBookTest, SweepThroughStopTriggersItEvenIfItEndsPastIt) {
+  // Arrange
+  ArrangeBidLevels({{Price{100}, Quantity{5}}});
+  ArrangeAskLevels({{Price{105}, Quantity{1}}});
+  auto print = AddMarketOk(UserId{1}, OrderSide::kBuy, Quantity{1});
+  auto stop = ob_.AddStop(UserId{2}, OrderSide::kSell, Price{102}, Quantity{2});
+  ArrangeAskLevels({{Price{101}, Quantity{1}},
+                    {Price{103}, Quantity{1}},
+                    {Price{106}, Quantity{1}}});
+
+  // Act
+  auto sweep = AddMarketOk(UserId{3}, OrderSide::kBuy, Quantity{3});
+
+  // Assert
+  // The sweep prints at 101 on its way to 106, which reaches the stop
+  AssertAddResult(stop, OrderStatus::kAwaitingFill, Quantity{2}, 0);
+  AssertAddResult(sweep, OrderStatus::kImmediateFill, Quantity{0}, 3);
+  ASSERT_EQ(sweep->triggered_trades.size(), 1);
+  EXPECT_EQ(sweep->triggered_trades[0].order_id, stop->order_id);
+  EXPECT_EQ(sweep->triggered_trades[0].price, Price{100});
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{100}), Quantity{3});
+  EXPECT_EQ(ob_.MemoryStats().stop_orders, 0);
+}
+
+TEST_F(OrderBookTest, AddStopAlreadyTriggeredEntersImmediately) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{5}}});
+  auto print = AddMarketOk(UserId{1}, OrderSide::kBuy, Quantity{1});
+
+  // Act
+  auto stop = ob_.AddStop(UserId{2}, OrderSide::kBuy, Price{9}, Quantity{6},
+                          Price{10});
+
+  // Assert
+  AssertAddResult(stop, OrderStatus::kPartialFill, Quantity{2}, 1);
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kBuy, Price{10}), Quantity{2});
+}
+
+TEST_F(OrderBookTest, CancelledStopNeverTriggers) {
+  // Arrange
+  ArrangeAskLevels({{Price{10}, Quantity{5}}});
+  auto stop = ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{10}, Quantity{2});
+  ASSERT_TRUE(stop.has_value());
+
+  // Act
+  bool cancelled = ob_.Cancel(stop->order_id);
+  auto taker = AddMarketOk(UserId{2}, OrderSide::kBuy, Quantity{1});
+
+  // Assert
+  EXPECT_TRUE(cancelled);
+  EXPECT_TRUE(taker->triggered_trades.empty());
+  EXPECT_EQ(ob_.DepthAt(OrderSide::kSell, Price{10}), Quantity{4});
+  EXPECT_FALSE(ob_.Cancel(stop->order_id));
+}
+
+TEST_F(OrderBookTest, AddStopRejects) {
+  // Act & Assert
+  EXPECT_EQ(
+      ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{10}, Quantity{0}).error(),
+      RejectReason::kBadQty);
+  EXPECT_EQ(
+      ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{0}, Quantity{1}).error(),
+      RejectReason::kBadPrice);
+  EXPECT_EQ(ob_.AddStop(UserId{1}, OrderSide::kBuy, Price{10}, Quantity{1},
+                        Price{0})
+                .error(),
+            RejectReason::kBadPrice);
+  EXPECT_EQ(ob_.MemoryStats().stop_orders, 0);
+}
+
+TEST(OrderBookStop, JournalReplaysToSameBook) {
+  // Arrange
+  std::ostringstream journal;
+  OrderBook ob(&journal);
+  for (Underlying price = 10; price < 14; ++price) {
+    auto ask = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{price},
+                           Quantity{3}, TimeInForce::kGoodTillCancel);
+    ASSERT_TRUE(ask.has_value());
+  }
+  auto stop = ob.AddStop(UserId{2}, OrderSide::kBuy, Price{11}, Quantity{4});
+  auto stop_limit = ob.AddStop(UserId{3}, OrderSide::kBuy, Price{12},
+                               Quantity{5}, Price{12});
+  ASSERT_TRUE(stop.has_value() && stop_limit.has_value());
+
+  // Act
+  auto taker = ob.AddMarket(UserId{4}, OrderSide::kBuy, Quantity{4});
+
+  // Assert
+  ASSERT_TRUE(taker.has_value());
+  EXPECT_EQ(taker->triggered_trades.size(), 3);
+  OrderBook replayed;
+  const auto events = ReplayJournal(journal.str(), replayed);
+  std::size_t stops = 0;
+  for (const auto& event : events) {
+    if (std::holds_alternative<AddStopOrderEvent>(event)) ++stops;
+  }
+  EXPECT_EQ(stops, 2);
+  EXPECT_EQ(replayed.ToHash(), ob.ToHash());
+  EXPECT_EQ(replayed.DepthAt(OrderSide::kBuy, Price{12}), Quantity{4});
+}
+}  // namespace order_book_v1
@@ -1,9 +1,27 @@
 #include "orderbook_test.h"
 
 #include <cstddef>
+#include <sstream>
+#include <string>
 #include <vector>
 
 namespace order_book_v1 {
+std::vector<OrderBookEvent> ReplayJournal(const std::string& journal,
+                                          OrderBook& book) {
+  std::vector<OrderBookEvent> events;
+  std::istringstream in(journal);
+  for (std::string line; std::getline(in, line);) {
+    auto record = ParseEvent(line);
+    if (!record.has_value()) {
+      ADD_FAILURE() << "unparsable journal line: " << line;
+      continue;
+    }
+    book.Apply(record->event);
+    events.emplace_back(record->event);
+  }
+  return events;
+}
+
 std::vector<OrderId> OrderBookTest::ArrangeBidLevels(
     std::initializer_list<LevelSpec> levels) {
   std::vector<OrderId> ids{};
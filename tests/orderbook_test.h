@@ -5,13 +5,20 @@
 #include <orderbook.h>
 
 #include <initializer_list>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "types.h"
 
 namespace order_book_v1 {
 using LevelSpec = std::pair<Price, Quantity>;
 
+// Parses every line of `journal` and applies it to `book`, failing the test
+// on any line that does not parse. Returns the events in journal order.
+std::vector<OrderBookEvent> ReplayJournal(const std::string& journal,
+                                          OrderBook& book);
+
 class OrderBookTest : public testing::Test {
  protected:
   OrderBook ob_;
@@ -0,0 +1,237 @@
+#include "shm_transport.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "orderbook.h"
+#include "types.h"
+
+namespace order_book_v1 {
+namespace {
+std::string ChannelName(const char* suffix) {
+  return "orderbook_test_" + std::to_string(getpid()) + "_" + suffix;
+}
+
+std::vector<ShmResponse> DrainResponses(ShmClient& client) {
+  std::vector<ShmResponse> out;
+  ShmResponse response{};
+  while (client.PollResponse(response)) out.emplace_back(response);
+  return out;
+}
+}  // namespace
+
+TEST(ShmTransport, LimitOrderIsAcked) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto client = ShmClient::Create(ChannelName("ack"));
+  ASSERT_TRUE(client.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("ack")).has_value());
+
+  // Act
+  auto seq = client->SubmitLimit(UserId{1}, OrderSide::kBuy, Price{100},
+                                 Quantity{5}, TimeInForce::kGoodTillCancel);
+  std::size_t handled = server.PollOnce();
+  auto responses = DrainResponses(*client);
+
+  // Assert
+  ASSERT_TRUE(seq.has_value());
+  EXPECT_EQ(handled, 1);
+  ASSERT_EQ(responses.size(), 1);
+  EXPECT_EQ(responses[0].client_seq, *seq);
+  EXPECT_EQ(responses[0].type, ShmResponseType::kAck);
+  EXPECT_EQ(responses[0].status, OrderStatus::kAwaitingFill);
+  EXPECT_EQ(responses[0].qty, Quantity{5});
+  EXPECT_EQ(ob.BestBid(), Price{100});
+}
+
+TEST(ShmTransport, BadOrderIsRejected) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto client = ShmClient::Create(ChannelName("reject"));
+  ASSERT_TRUE(client.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("reject")).has_value());
+
+  // Act
+  auto seq = client->SubmitMarket(UserId{1}, OrderSide::kBuy, Quantity{5});
+  server.PollOnce();
+  auto responses = DrainResponses(*client);
+
+  // Assert
+  ASSERT_EQ(responses.size(), 1);
+  EXPECT_EQ(responses[0].client_seq, *seq);
+  EXPECT_EQ(responses[0].type, ShmResponseType::kReject);
+  EXPECT_EQ(responses[0].reason, RejectReason::kEmptyBookForMarket);
+}
+
+TEST(ShmTransport, FillsAreRoutedToBothSides) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto maker = ShmClient::Create(ChannelName("maker"));
+  auto taker = ShmClient::Create(ChannelName("taker"));
+  ASSERT_TRUE(maker.has_value());
+  ASSERT_TRUE(taker.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("maker")).has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("taker")).has_value());
+
+  auto maker_seq = maker->SubmitLimit(UserId{1}, OrderSide::kSell, Price{100},
+                                      Quantity{10},
+                                      TimeInForce::kGoodTillCancel);
+  server.PollOnce();
+  DrainResponses(*maker);
+
+  // Act
+  auto taker_seq = taker->SubmitMarket(UserId{2}, OrderSide::kBuy, Quantity{4});
+  server.PollOnce();
+  auto maker_responses = DrainResponses(*maker);
+  auto taker_responses = DrainResponses(*taker);
+
+  // Assert
+  ASSERT_EQ(maker_responses.size(), 1);
+  EXPECT_EQ(maker_responses[0].type, ShmResponseType::kFill);
+  EXPECT_EQ(maker_responses[0].client_seq, *maker_seq);
+  EXPECT_EQ(maker_responses[0].qty, Quantity{4});
+  EXPECT_EQ(maker_responses[0].price, Price{100});
+
+  ASSERT_EQ(taker_responses.size(), 2);
+  EXPECT_EQ(taker_responses[0].type, ShmResponseType::kAck);
+  EXPECT_EQ(taker_responses[0].status, OrderStatus::kImmediateFill);
+  EXPECT_EQ(taker_responses[1].type, ShmResponseType::kFill);
+  EXPECT_EQ(taker_responses[1].client_seq, *taker_seq);
+  EXPECT_EQ(taker_responses[1].qty, Quantity{4});
+}
+
+TEST(ShmTransport, CancelRequiresOwnership) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto owner = ShmClient::Create(ChannelName("owner"));
+  auto other = ShmClient::Create(ChannelName("other"));
+  ASSERT_TRUE(owner.has_value());
+  ASSERT_TRUE(other.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("owner")).has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("other")).has_value());
+
+  owner->SubmitLimit(UserId{1}, OrderSide::kBuy, Price{100}, Quantity{5},
+                     TimeInForce::kGoodTillCancel);
+  server.PollOnce();
+  OrderId id = DrainResponses(*owner).at(0).order_id;
+
+  // Act
+  other->SubmitCancel(id);
+  server.PollOnce();
+  auto other_responses = DrainResponses(*other);
+  owner->SubmitCancel(id);
+  server.PollOnce();
+  auto owner_responses = DrainResponses(*owner);
+
+  // Assert
+  ASSERT_EQ(other_responses.size(), 1);
+  EXPECT_EQ(other_responses[0].type, ShmResponseType::kCancelReject);
+  EXPECT_EQ(other_responses[0].reason, RejectReason::kUnknownOrder);
+  ASSERT_EQ(owner_responses.size(), 1);
+  EXPECT_EQ(owner_responses[0].type, ShmResponseType::kCancelAck);
+  EXPECT_FALSE(ob.BestBid().has_value());
+}
+
+TEST(ShmTransport, IcebergSlicesStayWithTheirOwner) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto owner = ShmClient::Create(ChannelName("iceberg"));
+  auto taker = ShmClient::Create(ChannelName("iceberg_taker"));
+  ASSERT_TRUE(owner.has_value());
+  ASSERT_TRUE(taker.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("iceberg")).has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("iceberg_taker")).has_value());
+  owner->SubmitIceberg(UserId{1}, OrderSide::kSell, Price{10}, Quantity{6},
+                       Quantity{2});
+  server.PollOnce();
+  OrderId iceberg = DrainResponses(*owner).at(0).order_id;
+
+  // Act
+  // Each market takes a whole slice, so the next one is shown while the
+  // taker's request is being handled
+  taker->SubmitMarket(UserId{2}, OrderSide::kBuy, Quantity{2});
+  taker->SubmitMarket(UserId{2}, OrderSide::kBuy, Quantity{2});
+  server.PollOnce();
+  auto owner_responses = DrainResponses(*owner);
+  auto taker_responses = DrainResponses(*taker);
+
+  // Assert
+  ASSERT_EQ(owner_responses.size(), 2);
+  for (const auto& response : owner_responses) {
+    EXPECT_EQ(response.type, ShmResponseType::kFill);
+    EXPECT_EQ(response.order_id, iceberg);
+    EXPECT_EQ(response.qty, Quantity{2});
+  }
+  ASSERT_EQ(taker_responses.size(), 4);
+  for (const auto& response : taker_responses) {
+    EXPECT_NE(response.order_id, iceberg);
+  }
+  EXPECT_EQ(ob.DepthAt(OrderSide::kSell, Price{10}), Quantity{2});
+}
+
+TEST(ShmTransport, ClientWithFullResponseRingIsDropped) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+  auto client = ShmClient::Create(ChannelName("slow"));
+  ASSERT_TRUE(client.has_value());
+  ASSERT_TRUE(server.Attach(ChannelName("slow")).has_value());
+  // One ack per order fills the response ring exactly
+  for (std::size_t i = 0; i < kShmRingCapacity; ++i) {
+    ASSERT_TRUE(client->SubmitLimit(UserId{1}, OrderSide::kBuy, Price{100},
+                                    Quantity{1}, TimeInForce::kGoodTillCancel)
+                    .has_value());
+  }
+  server.PollOnce();
+
+  // Act
+  client->SubmitLimit(UserId{1}, OrderSide::kBuy, Price{101}, Quantity{1},
+                      TimeInForce::kGoodTillCancel);
+  std::size_t overflowed = server.PollOnce();
+  client->SubmitCancel(OrderId{1});
+  std::size_t ignored = server.PollOnce();
+  auto responses = DrainResponses(*client);
+
+  // Assert
+  EXPECT_EQ(overflowed, 1);
+  EXPECT_EQ(ignored, 0);
+  EXPECT_EQ(responses.size(), kShmRingCapacity);
+  EXPECT_FALSE(ob.BestBid().has_value());
+}
+
+TEST(ShmTransport, AttachFailsForMissingChannel) {
+  // Arrange
+  OrderBook ob;
+  ShmServer server{&ob};
+
+  // Act
+  auto result = server.Attach(ChannelName("missing"));
+
+  // Assert
+  ASSERT_FALSE(result.has_value());
+  EXPECT_EQ(result.error(), ShmError::kOpenFailed);
+}
+
+TEST(ShmTransport, FullRequestRingRefusesSubmit) {
+  // Arrange
+  auto client = ShmClient::Create(ChannelName("full"));
+  ASSERT_TRUE(client.has_value());
+  for (std::size_t i = 0; i < kShmRingCapacity; ++i) {
+    ASSERT_TRUE(client->SubmitCancel(OrderId{1}).has_value());
+  }
+
+  // Act
+  auto seq = client->SubmitCancel(OrderId{1});
+
+  // Assert
+  EXPECT_FALSE(seq.has_value());
+}
+}  // namespace order_book_v1
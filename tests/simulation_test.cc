@@ -0,0 +1,83 @@
+#include <event_log.h>
+#include <gtest/gtest.h>
+#include <orderbook.h>
+#include <simulation.h>
+
+#include <cstddef>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace order_book_v1 {
+namespace {
+std::vector<std::string> Simulate(std::size_t books, std::size_t threads,
+                                  uint64_t events_per_book) {
+  std::vector<std::ostringstream> streams(books);
+  std::vector<std::ostream*> segments;
+  for (auto& stream : streams) segments.push_back(&stream);
+  RunMultiBookSimulation({.seed = 1234,
+                          .threads = threads,
+                          .events_per_book = events_per_book},
+                         segments);
+  std::vector<std::string> out;
+  for (auto& stream : streams) out.push_back(stream.str());
+  return out;
+}
+}  // namespace
+
+TEST(Simulation, SegmentsDoNotDependOnThreadCount) {
+  // Not a multiple of the batch size, so the last batch is partial
+  const auto one = Simulate(7, 1, 3'000);
+  EXPECT_EQ(Simulate(7, 3, 3'000), one);
+  EXPECT_EQ(Simulate(7, 16, 3'000), one);
+
+  for (std::size_t b = 1; b < one.size(); ++b) EXPECT_NE(one[b], one[0]);
+  std::istringstream first(one[0]);
+  std::size_t lines = 0;
+  for (std::string line; std::getline(first, line);) ++lines;
+  EXPECT_EQ(lines, 3'000);
+}
+
+TEST(Simulation, BookSeedsAreDistinct) {
+  EXPECT_NE(BookSeed(1, 0), BookSeed(1, 1));
+  EXPECT_NE(BookSeed(1, 0), BookSeed(2, 0));
+  EXPECT_NE(BookSeed(1, 1), BookSeed(0, 0));
+}
+
+// Predicted ids must be the ones the book assigns, or the cancels would miss
+TEST(Simulation, RandomFlowCancelsTargetIssuedOrders) {
+  RandomFlow flow({}, 99);
+  OrderBook book;
+  std::size_t adds = 0;
+  std::size_t cancels = 0;
+  for (int i = 0; i < 20'000; ++i) {
+    const OrderBookEvent event = flow.Next();
+    if (std::holds_alternative<CancelOrderEvent>(event)) {
+      ++cancels;
+      book.Apply(event);
+      continue;
+    }
+    const AddResult result = std::visit(
+        [&book](const auto& e) -> AddResult {
+          using T = std::decay_t<decltype(e)>;
+          if constexpr (std::is_same_v<T, AddLimitOrderEvent>) {
+            return book.AddLimit(e.creator_id, e.side, *e.price, e.qty,
+                                 *e.tif);
+          } else if constexpr (std::is_same_v<T, AddMarketOrderEvent>) {
+            return book.AddMarket(e.creator_id, e.side, e.qty);
+          } else {
+            return tl::unexpected<RejectReason>(RejectReason::kBadQty);
+          }
+        },
+        event);
+    if (result.has_value()) {
+      ++adds;
+      EXPECT_EQ(result->order_id, flow.predicted_order_id());
+    }
+  }
+  EXPECT_GT(adds, 10'000);
+  EXPECT_GT(cancels, 2'000);
+}
+}  // namespace order_book_v1
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <orderbook.h>
+#include <trace.h>
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace order_book_v1 {
+namespace {
+std::size_t CountOccurrences(const std::string& text, const std::string& what) {
+  std::size_t count = 0;
+  for (auto pos = text.find(what); pos != std::string::npos;
+       pos = text.find(what, pos + what.size())) {
+    ++count;
+  }
+  return count;
+}
+}  // namespace
+
+TEST(TraceRing, KeepsMostRecentSpansOnceFull) {
+  auto ring = std::make_unique<TraceRing>(1);
+  const std::size_t total = TraceRing::kCapacity + 10;
+  for (std::size_t i = 0; i < total; ++i) {
+    ring->Push(TraceEvent{.name = "x", .start = i, .end = i + 1});
+  }
+  EXPECT_EQ(ring->size(), TraceRing::kCapacity);
+  EXPECT_EQ(ring->dropped(), 10);
+  EXPECT_EQ(ring->at(0).start, 10);
+  EXPECT_EQ(ring->at(TraceRing::kCapacity - 1).start, total - 1);
+
+  ring->Clear();
+  EXPECT_EQ(ring->size(), 0);
+}
+
+TEST(Tracer, ExportsSpansFromEveryThread) {
+  Tracer::Clear();
+  Tracer::Start();
+  {
+    TraceSpan span("MainSpan");
+  }
+  std::thread worker([] { TraceSpan span("WorkerSpan"); });
+  worker.join();
+  Tracer::Stop();
+  {
+    TraceSpan span("AfterStop");
+  }
+
+  std::ostringstream os;
+  Tracer::WriteChromeTrace(os);
+  const std::string json = os.str();
+  EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+  EXPECT_EQ(CountOccurrences(json, "\"name\":\"MainSpan\""), 1);
+  EXPECT_EQ(CountOccurrences(json, "\"name\":\"WorkerSpan\""), 1);
+  EXPECT_EQ(CountOccurrences(json, "AfterStop"), 0);
+  EXPECT_EQ(CountOccurrences(json, "\"ph\":\"X\""), 2);
+
+  Tracer::Clear();
+  std::ostringstream empty;
+  Tracer::WriteChromeTrace(empty);
+  EXPECT_EQ(CountOccurrences(empty.str(), "\"ph\""), 0);
+}
+
+TEST(Tracer, OrderBookSpansNestUnderEntryPoints) {
+#ifndef ORDERBOOK_TRACING
+  GTEST_SKIP() << "built without ORDERBOOK_TRACING";
+#else
+  OrderBook ob;
+  Tracer::Clear();
+  Tracer::Start();
+  auto rest = ob.AddLimit(UserId{1}, OrderSide::kSell, Price{10}, Quantity{5},
+                          TimeInForce::kGoodTillCancel);
+  auto take = ob.AddMarket(UserId{2}, OrderSide::kBuy, Quantity{5});
+  Tracer::Stop();
+  ASSERT_TRUE(rest.has_value());
+  ASSERT_TRUE(take.has_value());
+
+  std::ostringstream os;
+  Tracer::WriteChromeTrace(os);
+  const std::string json = os.str();
+  Tracer::Clear();
+  for (const char* name : {"AddLimit", "IndexInsert", "AddMarket", "Match",
+                           "Reduce", "IndexErase", "LevelErase"}) {
+    EXPECT_EQ(CountOccurrences(json, "\"name\":\"" + std::string(name) + "\""),
+              1)
+        << name;
+  }
+#endif
+}
+}  // namespace order_book_v1
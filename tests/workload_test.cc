@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <orderbook.h>
+#include <workload.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <variant>
+#include <vector>
+
+namespace order_book_v1 {
+namespace {
+constexpr std::size_t kEvents = 30'000;
+// Smaller than the default so the debug book's invariant checks stay cheap
+constexpr WorkloadConfig kSmallBook{.target_resting = 500};
+}  // namespace
+
+TEST(Workload, SameSeedSameStream) {
+  WorkloadGenerator a({.seed = 7, .target_resting = 500});
+  WorkloadGenerator b({.seed = 7, .target_resting = 500});
+  OrderBook book_a;
+  OrderBook book_b;
+  for (std::size_t i = 0; i < 10'000; ++i) {
+    WorkloadEvent ea = a.Next();
+    WorkloadEvent eb = b.Next();
+    ASSERT_EQ(ea.time_ns, eb.time_ns);
+    ASSERT_EQ(ea.event.index(), eb.event.index());
+    book_a.Apply(ea.event);
+    book_b.Apply(eb.event);
+  }
+  EXPECT_EQ(book_a.ToHash(), book_b.ToHash());
+
+  WorkloadGenerator other({.seed = 8, .target_resting = 500});
+  OrderBook book_other;
+  for (std::size_t i = 0; i < 10'000; ++i) book_other.Apply(other.Next().event);
+  EXPECT_NE(book_a.ToHash(), book_other.ToHash());
+}
+
+// Replaying the stream on a fresh book gives the same ids the generator saw,
+// so every cancel hits a resting order
+TEST(Workload, CancelsHitRestingOrdersAndDominateAdds) {
+  WorkloadGenerator generator(kSmallBook);
+  OrderBook book;
+  std::size_t cancel_misses = 0;
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    WorkloadEvent e = generator.Next();
+    if (const auto* cancel = std::get_if<CancelOrderEvent>(&e.event)) {
+      if (!book.Cancel(cancel->order_id)) ++cancel_misses;
+    } else {
+      book.Apply(e.event);
+    }
+  }
+  EXPECT_EQ(cancel_misses, 0);
+
+  const WorkloadStats& stats = generator.stats();
+  EXPECT_EQ(stats.limits + stats.markets + stats.cancels, kEvents);
+  EXPECT_GE(static_cast<double>(stats.cancels),
+            0.9 * static_cast<double>(stats.rested));
+  EXPECT_GT(generator.live_orders(), kSmallBook.target_resting / 2);
+  EXPECT_LT(generator.live_orders(), kSmallBook.target_resting * 2);
+}
+
+TEST(Workload, PricesClusterAroundMid) {
+  WorkloadGenerator generator(kSmallBook);
+  std::size_t limits = 0;
+  std::size_t near = 0;
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    const Underlying mid = generator.mid();
+    WorkloadEvent e = generator.Next();
+    if (const auto* add = std::get_if<AddLimitOrderEvent>(&e.event)) {
+      ++limits;
+      const Underlying price = add->price->v;
+      const Underlying distance = price > mid ? price - mid : mid - price;
+      EXPECT_GE(distance, 1);
+      EXPECT_EQ(price < mid, add->side == OrderSide::kBuy);
+      if (distance <= 10) ++near;
+    }
+  }
+  // 1 + Exp(mean 4) <= 10 about 89% of the time
+  EXPECT_GT(static_cast<double>(near), 0.85 * static_cast<double>(limits));
+}
+
+TEST(Workload, SizesAndUsersAreHeavyTailed) {
+  WorkloadGenerator generator(kSmallBook);
+  std::vector<Underlying> sizes;
+  std::map<Underlying, std::size_t> per_user;
+  std::size_t orders = 0;
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    WorkloadEvent e = generator.Next();
+    std::visit(
+        [&](const auto& ev) {
+          using T = std::decay_t<decltype(ev)>;
+          if constexpr (std::is_same_v<T, AddLimitOrderEvent> ||
+                        std::is_same_v<T, AddMarketOrderEvent>) {
+            sizes.push_back(ev.qty.v);
+            ++per_user[ev.creator_id.v];
+            ++orders;
+          }
+        },
+        e.event);
+  }
+  std::sort(sizes.begin(), sizes.end());
+  EXPECT_EQ(sizes.front(), 1);
+  EXPECT_LE(sizes.back(), 10'000);
+  // Pareto with alpha 1.5 from 1: median about 1.6, P(size > 100) = 1e-3
+  EXPECT_LE(sizes[sizes.size() / 2], 2);
+  EXPECT_GT(sizes.back(), 100 * sizes[sizes.size() / 2]);
+
+  // Zipf with exponent 1.1 over 10k users: user 1 alone sends over 10%
+  EXPECT_GT(per_user[1], per_user[2]);
+  EXPECT_GT(per_user[2], per_user[10]);
+  EXPECT_GT(static_cast<double>(per_user[1]),
+            0.1 * static_cast<double>(orders));
+}
+
+// A Poisson stream has inter-arrival gaps with coefficient of variation 1;
+// self-excitation clusters events and pushes it well above
+TEST(Workload, ArrivalsAreBursty) {
+  WorkloadGenerator generator(kSmallBook);
+  std::vector<double> gaps;
+  uint64_t last = 0;
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    const uint64_t t = generator.Next().time_ns;
+    ASSERT_GE(t, last);
+    gaps.push_back(static_cast<double>(t - last));
+    last = t;
+  }
+  double mean = 0;
+  for (double g : gaps) mean += g;
+  mean /= static_cast<double>(gaps.size());
+  double var = 0;
+  for (double g : gaps) var += (g - mean) * (g - mean);
+  var /= static_cast<double>(gaps.size());
+  EXPECT_GT(std::sqrt(var) / mean, 1.5);
+
+  // Long-run rate is base_rate / (1 - branching_ratio) = 100k/s
+  const double rate =
+      static_cast<double>(kEvents) / (static_cast<double>(last) / 1e9);
+  EXPECT_GT(rate, 70'000);
+  EXPECT_LT(rate, 140'000);
+}
+}  // namespace order_book_v1
@@ -0,0 +1,283 @@
+#!/usr/bin/env python3
+"""Stores benchmark baselines and flags statistically significant regressions.
+
+Runs orderbook_benchmark and orderbook_replay_benchmark several times, keeps
+every repetition as a JSON baseline under <baseline-dir>/<machine>/<commit>.json
+and compares two baselines with Welch's t-interval on the difference of means.
+A metric regresses when the whole 95% interval lies above zero and the mean
+slowed down by at least --min-effect. Every metric is "lower is better" (ns).
+
+  bench_compare.py run --benchmark <bin> --replay <bin> [--compare]
+  bench_compare.py compare <base.json> <new.json>
+  bench_compare.py table <baseline.json>
+
+Uses only the Python standard library.
+"""
+
+import argparse
+import json
+import math
+import os
+import platform
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+REPO_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Two-sided 95% critical values of Student's t, by degrees of freedom
+T_95 = {
+    1: 12.706, 2: 4.303, 3: 3.182, 4: 2.776, 5: 2.571, 6: 2.447, 7: 2.365,
+    8: 2.306, 9: 2.262, 10: 2.228, 12: 2.179, 15: 2.131, 20: 2.086,
+    25: 2.060, 30: 2.042, 40: 2.021, 60: 2.000, 120: 1.980,
+}
+
+
+def t_critical(df):
+    """Largest tabulated value at or below df, which errs on the wide side."""
+    if df >= 120:
+        return 1.960 if df > 1000 else T_95[120]
+    return T_95[max(k for k in T_95 if k <= max(1, math.floor(df)))]
+
+
+def git(*args):
+    try:
+        return subprocess.run(["git", *args], check=True, capture_output=True,
+                              text=True, cwd=REPO_ROOT).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return ""
+
+
+def commit_key():
+    commit = git("rev-parse", "--short=12", "HEAD") or "unknown"
+    if git("status", "--porcelain", "--untracked-files=no"):
+        commit += "-dirty"
+    return commit
+
+
+def machine_key():
+    cpu = platform.processor() or platform.machine()
+    try:
+        with open("/proc/cpuinfo", encoding="utf-8") as f:
+            for line in f:
+                if line.startswith("model name"):
+                    cpu = line.split(":", 1)[1].strip()
+                    break
+    except OSError:
+        pass
+    raw = f"{platform.node()}-{cpu}-{os.cpu_count()}cpu"
+    return re.sub(r"[^A-Za-z0-9._-]+", "_", raw).strip("_")
+
+
+def run_google_benchmark(binary, repetitions, min_time, bench_filter):
+    """Returns {name: [ns per op, one per repetition]}."""
+    cmd = [binary, "--benchmark_format=json",
+           f"--benchmark_repetitions={repetitions}",
+           f"--benchmark_min_time={min_time}",
+           "--benchmark_report_aggregates_only=false"]
+    if bench_filter:
+        cmd.append(f"--benchmark_filter={bench_filter}")
+    out = subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+    metrics = {}
+    for b in json.loads(out)["benchmarks"]:
+        if b.get("run_type") != "iteration":
+            continue
+        # per_op is wall time per engine call; cases without it fall back to
+        # wall time per iteration
+        if "per_op" in b:
+            value = b["per_op"] * 1e9
+        else:
+            scale = {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}[b["time_unit"]]
+            value = b["real_time"] * scale
+        metrics.setdefault(b.get("run_name", b["name"]), []).append(value)
+    return metrics
+
+
+def parse_replay(text):
+    """Pulls ns/event and per-type percentiles out of the replay report."""
+    metrics = {}
+    in_table = False
+    for line in text.splitlines():
+        if line.startswith("throughput:"):
+            rate = float(line.split()[1])
+            metrics["replay/ns_per_event"] = 1e9 / rate
+        elif line.startswith("type"):
+            in_table = True
+        elif in_table and line.strip():
+            fields = line.split()
+            if int(fields[1]) == 0:
+                continue
+            metrics[f"replay/{fields[0]}/p50_ns"] = float(fields[2])
+            metrics[f"replay/{fields[0]}/p99_ns"] = float(fields[3])
+    return metrics
+
+
+def run_replay(binary, repetitions, events, seed):
+    metrics = {}
+    for _ in range(repetitions):
+        out = subprocess.run(
+            [binary, "--events", str(events), "--seed", str(seed)],
+            check=True, capture_output=True, text=True).stdout
+        for name, value in parse_replay(out).items():
+            metrics.setdefault(name, []).append(value)
+    return metrics
+
+
+def summarize(samples):
+    mean = statistics.fmean(samples)
+    stdev = statistics.stdev(samples) if len(samples) > 1 else 0.0
+    return mean, stdev
+
+
+def welch_interval(base, new):
+    """95% interval for mean(new) - mean(base)."""
+    (m1, s1), (m2, s2) = summarize(base), summarize(new)
+    n1, n2 = len(base), len(new)
+    v1, v2 = s1 * s1 / n1, s2 * s2 / n2
+    diff = m2 - m1
+    if v1 + v2 == 0:
+        return diff, diff
+    df = (v1 + v2) ** 2 / (
+        (v1 * v1 / (n1 - 1) if n1 > 1 else 0) +
+        (v2 * v2 / (n2 - 1) if n2 > 1 else 0) or 1e-300)
+    half = t_critical(df) * math.sqrt(v1 + v2)
+    return diff - half, diff + half
+
+
+def compare(base, new, min_effect, out=sys.stdout):
+    """Prints one row per shared metric and returns the regressed names."""
+    regressions = []
+    print(f"base: {base['commit']} ({base['timestamp']})\n"
+          f"new:  {new['commit']} ({new['timestamp']})\n", file=out)
+    header = f"{'metric':<48}{'base':>12}{'new':>12}{'change':>10}  95% CI"
+    print(header, file=out)
+    print("-" * (len(header) + 20), file=out)
+    for name in sorted(set(base["metrics"]) & set(new["metrics"])):
+        b, n = base["metrics"][name], new["metrics"][name]
+        mb, mn = statistics.fmean(b), statistics.fmean(n)
+        lo, hi = welch_interval(b, n)
+        change = (mn - mb) / mb if mb else 0.0
+        flag = ""
+        if lo > 0 and change >= min_effect:
+            flag = "  REGRESSION"
+            regressions.append(name)
+        elif hi < 0 and -change >= min_effect:
+            flag = "  improved"
+        ci = f"[{lo / mb * 100:+.1f}%, {hi / mb * 100:+.1f}%]" if mb else ""
+        print(f"{name:<48}{mb:>12.1f}{mn:>12.1f}{change * 100:>+9.1f}%  "
+              f"{ci}{flag}", file=out)
+    return regressions
+
+
+def table(baseline, out=sys.stdout):
+    """Mean and spread per metric, in the layout of docs/02_PERFORMANCE.md."""
+    print(f"commit {baseline['commit']} on {baseline['machine']}, "
+          f"{baseline['repetitions']} repetitions\n", file=out)
+    print("```", file=out)
+    for name in sorted(baseline["metrics"]):
+        mean, stdev = summarize(baseline["metrics"][name])
+        print(f"{name:<48}mean={mean:.1f}ns  stdev={stdev:.1f}ns", file=out)
+    print("```", file=out)
+
+
+def latest_other(directory, commit):
+    candidates = []
+    for entry in os.listdir(directory) if os.path.isdir(directory) else []:
+        if entry.endswith(".json") and entry != f"{commit}.json":
+            path = os.path.join(directory, entry)
+            candidates.append((os.path.getmtime(path), path))
+    return max(candidates)[1] if candidates else None
+
+
+def load(path):
+    with open(path, encoding="utf-8") as f:
+        return json.load(f)
+
+
+def cmd_run(args):
+    if args.repetitions < 2:
+        sys.exit("--repetitions must be at least 2 for confidence intervals")
+    metrics = {}
+    if args.benchmark:
+        metrics.update(run_google_benchmark(args.benchmark, args.repetitions,
+                                            args.min_time, args.filter))
+    if args.replay:
+        metrics.update(run_replay(args.replay, args.repetitions,
+                                  args.replay_events, args.replay_seed))
+    if not metrics:
+        sys.exit("Nothing to run: pass --benchmark and/or --replay")
+
+    commit, machine = commit_key(), machine_key()
+    baseline = {
+        "commit": commit,
+        "machine": machine,
+        "timestamp": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "repetitions": args.repetitions,
+        "metrics": metrics,
+    }
+    directory = os.path.join(args.baseline_dir, machine)
+    os.makedirs(directory, exist_ok=True)
+    path = os.path.join(directory, f"{commit}.json")
+    with open(path, "w", encoding="utf-8") as f:
+        json.dump(baseline, f, indent=1, sort_keys=True)
+    print(f"Stored {len(metrics)} metrics in {path}\n")
+    table(baseline)
+
+    if not args.compare:
+        return 0
+    previous = latest_other(directory, commit)
+    if previous is None:
+        print("\nNo earlier baseline for this machine to compare against")
+        return 0
+    print()
+    return 1 if compare(load(previous), baseline, args.min_effect) else 0
+
+
+def cmd_compare(args):
+    regressions = compare(load(args.base), load(args.new), args.min_effect)
+    return 1 if regressions else 0
+
+
+def cmd_table(args):
+    table(load(args.baseline))
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    run = sub.add_parser("run", help="run the suites and store a baseline")
+    run.add_argument("--benchmark", help="path to orderbook_benchmark")
+    run.add_argument("--replay", help="path to orderbook_replay_benchmark")
+    run.add_argument("--baseline-dir", default="bench_baselines")
+    run.add_argument("--repetitions", type=int, default=5)
+    run.add_argument("--min-time", default="0.2",
+                     help="--benchmark_min_time per repetition (seconds)")
+    run.add_argument("--filter", help="--benchmark_filter regex")
+    run.add_argument("--replay-events", type=int, default=1_000_000)
+    run.add_argument("--replay-seed", type=int, default=42)
+    run.add_argument("--compare", action="store_true",
+                     help="compare with this machine's latest other baseline")
+    run.add_argument("--min-effect", type=float, default=0.02,
+                     help="smallest slowdown reported as a regression")
+    run.set_defaults(func=cmd_run)
+
+    cmp = sub.add_parser("compare", help="compare two stored baselines")
+    cmp.add_argument("base")
+    cmp.add_argument("new")
+    cmp.add_argument("--min-effect", type=float, default=0.02)
+    cmp.set_defaults(func=cmd_compare)
+
+    tbl = sub.add_parser("table", help="print a summary table")
+    tbl.add_argument("baseline")
+    tbl.set_defaults(func=cmd_table)
+
+    args = parser.parse_args()
+    return args.func(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())